@@ -0,0 +1,185 @@
+// OBJ load throughput: a plain iostream parse (what OBJMesh::load used to
+// do) against OBJMesh::load at increasing thread counts.
+//
+//   obj_benchmark [file.obj] [runs] [threads...]
+//
+// Thread counts default to 1, 2, 4, ... up to the hardware thread count.
+// "scaling" is the speedup over the one-thread load, which takes the
+// serial path; files under 2 MB are always parsed serially.
+//
+// Without a file, a synthetic mesh (a 1500 x 1500 quad grid with uvs and
+// normals, about 280 MB) is written to the working directory first.
+// OBJMesh::load also uploads to the GPU, so a GL window is opened; vertex
+// cache optimization and normal generation are turned off to keep the
+// timings about parsing and building.
+#include <vgl/vgl.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  double secondsSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  void writeGrid(const std::string &path, int size)
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << "# synthetic " << size << " x " << size << " quad grid\n";
+    for (int z = 0; z <= size; ++z)
+      for (int x = 0; x <= size; ++x)
+      {
+        float h = 0.25f * std::sin(x * 0.05f) * std::cos(z * 0.07f);
+        out << "v " << x * 0.01f << ' ' << h << ' ' << z * 0.01f << '\n';
+        out << "vt " << float(x) / size << ' ' << float(z) / size << '\n';
+        out << "vn 0 1 0\n";
+      }
+
+    // Two materials so the parser also sees group switches
+    for (int z = 0; z < size; ++z)
+    {
+      out << (z % 2 ? "usemtl odd\n" : "usemtl even\n");
+      for (int x = 0; x < size; ++x)
+      {
+        int a = z * (size + 1) + x + 1;
+        int b = a + 1;
+        int c = a + size + 1;
+        int d = c + 1;
+        out << "f " << a << '/' << a << '/' << a << ' ' << c << '/' << c << '/' << c << ' ' << d << '/' << d << '/'
+            << d << ' ' << b << '/' << b << '/' << b << '\n';
+      }
+    }
+  }
+
+  // Line-by-line parse into attribute and index arrays, the way the loader
+  // worked before it parsed in place
+  size_t parseWithStreams(const std::string &path)
+  {
+    std::ifstream file(path);
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> uvs;
+    std::vector<int> corners;
+    std::string line, prefix, token;
+    while (std::getline(file, line))
+    {
+      std::istringstream stream(line);
+      stream >> prefix;
+      if (prefix == "v" || prefix == "vn")
+      {
+        glm::vec3 v;
+        stream >> v.x >> v.y >> v.z;
+        (prefix == "v" ? positions : normals).push_back(v);
+      }
+      else if (prefix == "vt")
+      {
+        glm::vec2 uv;
+        stream >> uv.x >> uv.y;
+        uvs.push_back(uv);
+      }
+      else if (prefix == "f")
+      {
+        while (stream >> token)
+        {
+          std::istringstream corner(token);
+          std::string index;
+          while (std::getline(corner, index, '/'))
+            corners.push_back(index.empty() ? 0 : std::stoi(index));
+        }
+      }
+    }
+    return positions.size() + corners.size();
+  }
+
+  template <typename Fn>
+  double best(int runs, Fn fn)
+  {
+    double seconds = 1e30;
+    for (int i = 0; i < runs; ++i)
+    {
+      auto start = Clock::now();
+      fn();
+      seconds = std::min(seconds, secondsSince(start));
+    }
+    return seconds;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::string path = argc > 1 ? argv[1] : "obj_benchmark_grid.obj";
+  int runs = argc > 2 ? std::max(1, std::atoi(argv[2])) : 3;
+
+  if (argc <= 1 && !std::ifstream(path))
+  {
+    std::printf("Writing %s...\n", path.c_str());
+    writeGrid(path, 1500);
+  }
+
+  std::ifstream probe(path, std::ios::binary | std::ios::ate);
+  if (!probe)
+  {
+    std::fprintf(stderr, "Cannot open %s\n", path.c_str());
+    return 1;
+  }
+  double megabytes = double(probe.tellg()) / (1024.0 * 1024.0);
+
+  GUI gui(320, 240, "OBJ load benchmark");
+
+  std::printf("%s: %.1f MB, best of %d runs\n\n", path.c_str(), megabytes, runs);
+  std::printf("%-22s %9s %9s %8s %8s\n", "", "seconds", "MB/s", "speedup", "scaling");
+
+  double baseline = best(runs, [&]() { parseWithStreams(path); });
+  std::printf("%-22s %9.3f %9.1f %8.2f\n", "iostream parse", baseline, megabytes / baseline, 1.0);
+
+  std::vector<unsigned int> threadCounts;
+  for (int i = 3; i < argc; ++i)
+    threadCounts.push_back(std::max(1, std::atoi(argv[i])));
+  if (threadCounts.empty())
+  {
+    unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; threads < hardware; threads *= 2)
+      threadCounts.push_back(threads);
+    threadCounts.push_back(hardware);
+  }
+
+  OBJLoadOptions options;
+  options.optimizeVertexCache = false;
+  options.generateNormals = false;
+  double serial = 0.0;
+  for (unsigned int threads : threadCounts)
+  {
+    options.threadCount = threads;
+    bool ok = true;
+    double seconds = best(runs, [&]()
+                          {
+      OBJMesh mesh;
+      ok = mesh.load(path, options) && ok; });
+    if (!ok)
+    {
+      std::fprintf(stderr, "OBJMesh::load failed on %s\n", path.c_str());
+      return 1;
+    }
+
+    if (threads == 1)
+      serial = seconds;
+
+    char label[32];
+    std::snprintf(label, sizeof(label), "load, %u thread%s", threads, threads == 1 ? "" : "s");
+    std::printf("%-22s %9.3f %9.1f %8.2f", label, seconds, megabytes / seconds, baseline / seconds);
+    if (serial > 0.0)
+      std::printf(" %8.2f", serial / seconds);
+    std::printf("\n");
+  }
+  return 0;
+}
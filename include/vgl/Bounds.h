@@ -0,0 +1,83 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <vgl/Mesh.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cfloat>
+#include <cstddef>
+
+// Axis-aligned box. Default constructed it is empty (min > max), and
+// expanding it by anything makes it that thing's bounds.
+struct AABB
+{
+  glm::vec3 min{FLT_MAX};
+  glm::vec3 max{-FLT_MAX};
+
+  bool isEmpty() const { return min.x > max.x; }
+  glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+  // Half the size along each axis
+  glm::vec3 getExtent() const { return (max - min) * 0.5f; }
+
+  void expand(const glm::vec3 &point)
+  {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+  void expand(const AABB &other)
+  {
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+  }
+
+  // Box around this box after transform (Arvo's method: no corners needed)
+  AABB transformed(const glm::mat4 &transform) const;
+
+  static AABB fromVertices(const Vertex *vertices, size_t count);
+};
+
+struct BoundingSphere
+{
+  glm::vec3 center{0.0f};
+  float radius = -1.0f; // negative = empty
+
+  bool isEmpty() const { return radius < 0.0f; }
+
+  // The radius grows by the largest axis scale, so it stays conservative
+  // under non-uniform scaling
+  BoundingSphere transformed(const glm::mat4 &transform) const;
+
+  // Centered on box, reaching the farthest vertex. Tighter than around(box).
+  static BoundingSphere fromVertices(const Vertex *vertices, size_t count, const AABB &box);
+  static BoundingSphere around(const AABB &box);
+};
+
+enum class Containment
+{
+  Outside,
+  Intersects,
+  Inside
+};
+
+// The six planes of a clip-space transform, normals pointing inward.
+// Tests are conservative: a volume near a frustum corner can be reported
+// as intersecting while actually outside, never the other way around.
+class Frustum
+{
+public:
+  Frustum() = default;
+  // projection * view gives a world-space frustum, projection * view * model
+  // one in model space
+  explicit Frustum(const glm::mat4 &clipFromSpace);
+
+  Containment test(const AABB &box) const;
+  Containment test(const BoundingSphere &sphere) const;
+
+  // left, right, bottom, top, near, far as (normal, distance)
+  const glm::vec4 &getPlane(int index) const { return m_planes[index]; }
+
+private:
+  std::array<glm::vec4, 6> m_planes{};
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <cstddef>
 
 class Camera {
 public:
@@ -45,19 +46,62 @@ public:
     return *this;
   }
 
-  // Matrices
-  glm::mat4 getViewMatrix() const {
-    return glm::lookAt(position, target, up);
-  }
+  // Matrices. Built on first use and cached until position, target, up,
+  // fov, the clip planes or the aspect change; the fields may be assigned
+  // directly, the cache compares against the values it was built from.
+  // The cache makes these getters unsafe to call on one Camera from
+  // several threads at once.
+  glm::mat4 getViewMatrix() const;
+  glm::mat4 getProjectionMatrix(float aspect) const;
+  glm::mat4 getViewProjectionMatrix(float aspect) const;
+  glm::mat4 getInverseViewMatrix() const;
+  glm::mat4 getInverseProjectionMatrix(float aspect) const;
+  glm::mat4 getInverseViewProjectionMatrix(float aspect) const;
 
-  glm::mat4 getProjectionMatrix(float aspect) const {
-    return glm::perspective(glm::radians(fov), aspect, nearPlane, farPlane);
-  }
+  // Batched projection for many points at once (labels, markers). Viewport
+  // coordinates are pixels with the origin at the top left, like mouse
+  // positions, and the aspect is taken from viewport. out[i].xy is where
+  // points[i] lands and out[i].z its depth along the view direction; points
+  // with z <= 0 are behind the camera and their xy is meaningless.
+  void project(const glm::vec3* points, size_t count, glm::vec3* out, glm::vec2 viewport) const;
+  // The reverse for viewport positions: normalized world-space directions
+  // of the rays from position through them (batched GUI::getMouseRay)
+  void unproject(const glm::vec2* pixels, size_t count, glm::vec3* out, glm::vec2 viewport) const;
 
   // For 2D/orthographic rendering
   glm::mat4 getOrthoMatrix(float width, float height) const {
     return glm::ortho(0.0f, width, 0.0f, height, -1.0f, 1.0f);
   }
+
+private:
+  // Inputs the cached matrices were built from; the view part and the
+  // projection part are checked separately, the products are rebuilt when
+  // either changed
+  struct MatrixCache {
+    glm::vec3 position{0.0f};
+    glm::vec3 target{0.0f};
+    glm::vec3 up{0.0f};
+    float fov = 0.0f;
+    float nearPlane = 0.0f;
+    float farPlane = 0.0f;
+    float aspect = 0.0f;
+    bool viewValid = false;
+    bool projectionValid = false;
+    bool productValid = false;
+
+    glm::mat4 view{1.0f};
+    glm::mat4 inverseView{1.0f};
+    glm::mat4 projection{1.0f};
+    glm::mat4 inverseProjection{1.0f};
+    glm::mat4 viewProjection{1.0f};
+    glm::mat4 inverseViewProjection{1.0f};
+  };
+
+  const MatrixCache& updateView() const;
+  const MatrixCache& updateProjection(float aspect) const;
+  const MatrixCache& updateAll(float aspect) const;
+
+  mutable MatrixCache m_cache;
 };
 
 #endif
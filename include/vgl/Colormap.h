@@ -0,0 +1,40 @@
+#ifndef COLORMAP_H
+#define COLORMAP_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// 1D lookup texture mapping a normalized scalar in [0, 1] to a color.
+// Shaders sample it with `uniform sampler1D colormap`.
+class Colormap {
+public:
+  enum class Preset {
+    Viridis,
+    Turbo,
+    Coolwarm,
+    Grayscale
+  };
+
+  Colormap() = default;
+  ~Colormap();
+  Colormap(Colormap&& other) noexcept;
+  Colormap& operator=(Colormap&& other) noexcept;
+  Colormap(const Colormap&) = delete;
+  Colormap& operator=(const Colormap&) = delete;
+
+  void load(Preset preset, int resolution = 256);
+  // Evenly spaced color stops, linearly interpolated by the sampler
+  void load(const std::vector<glm::vec3>& colors);
+  void bind(unsigned int unit) const;
+  bool isLoaded() const { return m_texture != 0; }
+
+  static glm::vec3 sample(Preset preset, float t);
+
+private:
+  void cleanup();
+
+  GLuint m_texture = 0;
+};
+
+#endif
@@ -71,6 +71,434 @@ void main() {
 }
 )";
 
+// Trail shader: ring-buffer slot is recovered from gl_VertexID so age fading
+// needs no per-vertex data beyond position.
+inline const char* trailVert = R"(
+#version 330 core
+
+layout(location = 0) in vec3 aPos;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform int trailHead;
+uniform int trailCapacity;
+uniform int trailCount;
+
+out float v_age;
+out float v_fragW;
+
+void main() {
+  int slot = gl_VertexID % trailCapacity; // slot == capacity mirrors slot 0
+  int age = (trailHead - 1 - slot + trailCapacity) % trailCapacity;
+  v_age = float(age) / float(max(trailCount - 1, 1));
+  gl_Position = projection * view * vec4(aPos, 1.0);
+  v_fragW = gl_Position.w;
+}
+)";
+
+inline const char* trailFrag = R"(
+#version 330 core
+
+in float v_age;
+in float v_fragW;
+
+uniform vec3 color;
+uniform float fade;
+uniform float logDepthFarPlane;
+
+out vec4 FragColor;
+
+void main() {
+  if (logDepthFarPlane > 0.0) {
+    gl_FragDepth = log2(max(1e-6, 1.0 + v_fragW)) / log2(1.0 + logDepthFarPlane);
+  } else {
+    gl_FragDepth = gl_FragCoord.z;
+  }
+
+  FragColor = vec4(color, 1.0 - fade * v_age);
+}
+)";
+
+// Thick line shader: each instance is one segment, expanded into a quad of
+// `width` framebuffer pixels. Quad corners come from gl_VertexID (strip of 4).
+inline const char* lineVert = R"(
+#version 330 core
+
+layout(location = 0) in vec3 aStart;
+layout(location = 1) in vec3 aEnd;
+layout(location = 2) in vec3 aColor;
+layout(location = 3) in float aWidth;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec2 viewportSize;
+
+out vec3 vColor;
+out float v_fragW;
+
+void main() {
+  vec4 a = projection * view * vec4(aStart, 1.0);
+  vec4 b = projection * view * vec4(aEnd, 1.0);
+
+  // Clip against the near plane so the screen-space direction stays valid
+  float da = a.z + a.w;
+  float db = b.z + b.w;
+  if (da < 0.0 && db < 0.0) {
+    gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+    vColor = aColor;
+    v_fragW = 1.0;
+    return;
+  }
+  if (da < 0.0) a = mix(a, b, da / (da - db));
+  if (db < 0.0) b = mix(b, a, db / (db - da));
+
+  vec2 halfViewport = viewportSize * 0.5;
+  vec2 sa = a.xy / a.w * halfViewport;
+  vec2 sb = b.xy / b.w * halfViewport;
+  vec2 dir = sb - sa;
+  dir = length(dir) > 1e-6 ? normalize(dir) : vec2(1.0, 0.0);
+  vec2 normal = vec2(-dir.y, dir.x);
+
+  bool atEnd = (gl_VertexID & 2) != 0;
+  float side = (gl_VertexID & 1) != 0 ? 1.0 : -1.0;
+  vec4 p = atEnd ? b : a;
+  p.xy += normal * side * aWidth * 0.5 / halfViewport * p.w;
+
+  gl_Position = p;
+  vColor = aColor;
+  v_fragW = p.w;
+}
+)";
+
+// Instanced arrowhead shader: unit cone (MeshGen::cone) oriented along aAxis
+inline const char* arrowHeadVert = R"(
+#version 330 core
+
+layout(location = 0) in vec3 aPos;
+layout(location = 3) in vec3 aBase;
+layout(location = 4) in vec3 aAxis;
+layout(location = 5) in vec3 aColor;
+layout(location = 6) in float aRadius;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 vColor;
+out float v_fragW;
+
+void main() {
+  float len = length(aAxis);
+  vec3 dir = aAxis / max(len, 1e-20);
+  vec3 ref = abs(dir.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0);
+  vec3 b1 = normalize(cross(dir, ref));
+  vec3 b2 = cross(dir, b1);
+
+  vec3 worldPos = aBase + dir * (aPos.y + 0.5) * len + (b1 * aPos.x + b2 * aPos.z) * (2.0 * aRadius);
+  gl_Position = projection * view * vec4(worldPos, 1.0);
+  vColor = aColor;
+  v_fragW = gl_Position.w;
+}
+)";
+
+// Unlit per-instance color, shared by the line and arrowhead shaders
+inline const char* colorFrag = R"(
+#version 330 core
+
+in vec3 vColor;
+in float v_fragW;
+
+uniform float logDepthFarPlane;
+
+out vec4 FragColor;
+
+void main() {
+  if (logDepthFarPlane > 0.0) {
+    gl_FragDepth = log2(max(1e-6, 1.0 + v_fragW)) / log2(1.0 + logDepthFarPlane);
+  } else {
+    gl_FragDepth = gl_FragCoord.z;
+  }
+
+  FragColor = vec4(vColor, 1.0);
+}
+)";
+
+// Vector field glyphs: unit arrow (MeshGen::arrow) placed at the grid sample
+// given by gl_InstanceID, oriented and scaled by the per-instance vector
+inline const char* vectorFieldVert = R"(
+#version 330 core
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 3) in vec3 aVector;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform ivec3 gridDims;
+uniform vec3 gridOrigin;
+uniform vec3 gridSpacing;
+uniform float glyphScale;
+uniform float glyphMaxLength;
+uniform float glyphWidth;
+uniform float glyphMinMagnitude;
+uniform vec2 colorRange;
+uniform sampler1D colormap;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 vColor;
+out float v_fragW;
+
+void main() {
+  int id = gl_InstanceID;
+  ivec3 cell = ivec3(id % gridDims.x, (id / gridDims.x) % gridDims.y, id / (gridDims.x * gridDims.y));
+  vec3 center = gridOrigin + vec3(cell) * gridSpacing;
+
+  float magnitude = length(aVector);
+  // A vanishing vector would still show a glyph-wide disc; every vertex
+  // goes beyond the far plane so the whole glyph is clipped
+  if (magnitude <= glyphMinMagnitude) {
+    gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+    FragPos = center;
+    Normal = vec3(0.0, 1.0, 0.0);
+    vColor = vec3(0.0);
+    v_fragW = 1.0;
+    return;
+  }
+  vec3 dir = aVector / magnitude;
+  vec3 ref = abs(dir.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0);
+  vec3 b1 = normalize(cross(dir, ref));
+  vec3 b2 = cross(dir, b1);
+
+  float len = magnitude * glyphScale;
+  if (glyphMaxLength > 0.0) len = min(len, glyphMaxLength);
+
+  // Glyph is centered on its sample
+  vec3 worldPos = center + dir * (aPos.y - 0.5) * len + (b1 * aPos.x + b2 * aPos.z) * glyphWidth;
+  FragPos = worldPos;
+  Normal = b1 * (aNormal.x / glyphWidth) + dir * (aNormal.y / max(len, 1e-20)) + b2 * (aNormal.z / glyphWidth);
+
+  float t = (magnitude - colorRange.x) / max(colorRange.y - colorRange.x, 1e-20);
+  vColor = texture(colormap, clamp(t, 0.0, 1.0)).rgb;
+
+  gl_Position = projection * view * vec4(worldPos, 1.0);
+  v_fragW = gl_Position.w;
+}
+)";
+
+// Lit per-vertex color, same lighting model as defaultFrag
+inline const char* litColorFrag = R"(
+#version 330 core
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 vColor;
+in float v_fragW;
+
+uniform vec3 lightDir;
+uniform vec3 viewPos;
+uniform bool useLighting;
+uniform float logDepthFarPlane;
+
+out vec4 FragColor;
+
+void main() {
+  if (logDepthFarPlane > 0.0) {
+    gl_FragDepth = log2(max(1e-6, 1.0 + v_fragW)) / log2(1.0 + logDepthFarPlane);
+  } else {
+    gl_FragDepth = gl_FragCoord.z;
+  }
+
+  if (!useLighting) {
+    FragColor = vec4(vColor, 1.0);
+    return;
+  }
+
+  vec3 norm = normalize(Normal);
+  vec3 light = normalize(lightDir);
+
+  float ambient = 0.15;
+  float diffuse = max(dot(norm, light), 0.0);
+
+  vec3 viewDir = normalize(viewPos - FragPos);
+  vec3 halfDir = normalize(light + viewDir);
+  float specular = pow(max(dot(norm, halfDir), 0.0), 32.0) * 0.3;
+
+  FragColor = vec4(vColor * (ambient + diffuse) + vec3(specular), 1.0);
+}
+)";
+
+// Heightfield: vertex positions and normals come from the height texture.
+// aChunkOrigin is per instance (one chunk), gl_VertexID indexes the chunk grid.
+inline const char* heightfieldVert = R"(
+#version 330 core
+
+layout(location = 0) in ivec2 aChunkOrigin;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform sampler2D heights;
+uniform ivec2 fieldSize;
+uniform vec3 fieldOrigin;
+uniform vec2 fieldSpacing;
+uniform float heightScale;
+uniform float skirtDepth;
+uniform int chunkVerts;
+uniform vec3 color;
+uniform bool useColormap;
+uniform vec2 colorRange;
+uniform sampler1D colormap;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 vColor;
+out float v_fragW;
+
+float heightAt(ivec2 s) {
+  return texelFetch(heights, clamp(s, ivec2(0), fieldSize - 1), 0).r;
+}
+
+void main() {
+  int id = gl_VertexID;
+  int vertsPerChunk = chunkVerts * chunkVerts;
+  bool skirt = id >= vertsPerChunk;
+  if (skirt) id -= vertsPerChunk;
+
+  ivec2 s = min(aChunkOrigin + ivec2(id % chunkVerts, id / chunkVerts), fieldSize - 1);
+  float h = heightAt(s);
+
+  // Central differences (one-sided at the border)
+  ivec2 l = max(s - ivec2(1, 0), ivec2(0));
+  ivec2 r = min(s + ivec2(1, 0), fieldSize - 1);
+  ivec2 d = max(s - ivec2(0, 1), ivec2(0));
+  ivec2 u = min(s + ivec2(0, 1), fieldSize - 1);
+  float dhdx = (heightAt(r) - heightAt(l)) * heightScale / (float(max(r.x - l.x, 1)) * fieldSpacing.x);
+  float dhdz = (heightAt(u) - heightAt(d)) * heightScale / (float(max(u.y - d.y, 1)) * fieldSpacing.y);
+  Normal = normalize(vec3(-dhdx, 1.0, -dhdz));
+
+  vec3 worldPos = fieldOrigin + vec3(float(s.x) * fieldSpacing.x, h * heightScale, float(s.y) * fieldSpacing.y);
+  if (skirt) worldPos.y -= skirtDepth;
+  FragPos = worldPos;
+
+  if (useColormap) {
+    float t = (h - colorRange.x) / max(colorRange.y - colorRange.x, 1e-20);
+    vColor = texture(colormap, clamp(t, 0.0, 1.0)).rgb;
+  } else {
+    vColor = color;
+  }
+
+  gl_Position = projection * view * vec4(worldPos, 1.0);
+  v_fragW = gl_Position.w;
+}
+)";
+
+// OBJ meshes, always instanced: transform and color come per instance, the
+// submesh's diffuse color and texture layer are fetched from the material
+// buffer texture (two texels per submesh) by materialIndex unless the
+// instance color overrides them (aColor.a > 0.5). With useColormap the
+// per-vertex scalar is colormapped instead.
+inline const char* objVert = R"(
+#version 330 core
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoord;
+layout(location = 3) in mat4 aModel;
+layout(location = 7) in vec4 aColor;
+layout(location = 8) in float aScalar;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform samplerBuffer materials;
+uniform int materialIndex;
+uniform bool useColormap;
+uniform vec2 colorRange;
+uniform sampler1D colormap;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 vColor;
+out vec2 vTexCoord;
+flat out ivec2 vTexture;
+out float v_fragW;
+
+void main() {
+  vec4 worldPos = aModel * vec4(aPos, 1.0);
+  FragPos = worldPos.xyz;
+  Normal = transpose(inverse(mat3(aModel))) * aNormal;
+  vTexCoord = aTexCoord;
+  vTexture = ivec2(-1, 0);
+  if (useColormap) {
+    float t = (aScalar - colorRange.x) / max(colorRange.y - colorRange.x, 1e-20);
+    vColor = texture(colormap, clamp(t, 0.0, 1.0)).rgb;
+  } else if (aColor.a > 0.5) {
+    vColor = aColor.rgb;
+  } else {
+    vColor = texelFetch(materials, materialIndex * 2).rgb;
+    vTexture = ivec2(texelFetch(materials, materialIndex * 2 + 1).xy);
+  }
+  gl_Position = projection * view * worldPos;
+  v_fragW = gl_Position.w;
+}
+)";
+
+// OBJ meshes: litColorFrag with the color multiplied by the submesh's
+// diffuse texture, layer vTexture.y of texture array vTexture.x (x < 0:
+// untextured). GLSL 3.30 only indexes sampler arrays with constants, hence
+// the branches; they are uniform across a draw.
+inline const char* objFrag = R"(
+#version 330 core
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 vColor;
+in vec2 vTexCoord;
+flat in ivec2 vTexture;
+in float v_fragW;
+
+uniform vec3 lightDir;
+uniform vec3 viewPos;
+uniform bool useLighting;
+uniform float logDepthFarPlane;
+uniform sampler2DArray diffuseMaps[4];
+
+out vec4 FragColor;
+
+vec3 diffuseTexel() {
+  vec3 coord = vec3(vTexCoord, float(vTexture.y));
+  if (vTexture.x == 0) return texture(diffuseMaps[0], coord).rgb;
+  if (vTexture.x == 1) return texture(diffuseMaps[1], coord).rgb;
+  if (vTexture.x == 2) return texture(diffuseMaps[2], coord).rgb;
+  if (vTexture.x == 3) return texture(diffuseMaps[3], coord).rgb;
+  return vec3(1.0);
+}
+
+void main() {
+  if (logDepthFarPlane > 0.0) {
+    gl_FragDepth = log2(max(1e-6, 1.0 + v_fragW)) / log2(1.0 + logDepthFarPlane);
+  } else {
+    gl_FragDepth = gl_FragCoord.z;
+  }
+
+  vec3 color = vColor * diffuseTexel();
+  if (!useLighting) {
+    FragColor = vec4(color, 1.0);
+    return;
+  }
+
+  vec3 norm = normalize(Normal);
+  vec3 light = normalize(lightDir);
+
+  float ambient = 0.15;
+  float diffuse = max(dot(norm, light), 0.0);
+
+  vec3 viewDir = normalize(viewPos - FragPos);
+  vec3 halfDir = normalize(light + viewDir);
+  float specular = pow(max(dot(norm, halfDir), 0.0), 32.0) * 0.3;
+
+  FragColor = vec4(color * (ambient + diffuse) + vec3(specular), 1.0);
+}
+)";
+
 } // namespace EmbeddedShaders
 
 #endif
@@ -5,12 +5,33 @@
 #include <vgl/Mesh.h>
 #include <vgl/Camera.h>
 #include <vgl/OBJMesh.h>
+#include <vgl/Trail.h>
+#include <vgl/LineBatch.h>
+#include <vgl/Colormap.h>
+#include <vgl/VectorField.h>
+#include <vgl/Heightfield.h>
+#include <vgl/SpatialIndex.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <string>
+#include <vector>
+#include <unordered_map>
 #include <unordered_set>
 
+// OBJ submesh draws of one frame, counted per instance and submesh.
+// Triangles are those of the level of detail each instance would use.
+struct OBJCullStats
+{
+  size_t subMeshesDrawn = 0;
+  size_t subMeshesCulled = 0;
+  size_t trianglesDrawn = 0;
+  size_t trianglesCulled = 0;
+  // Static instances the spatial index skipped without visiting them (not
+  // counted above)
+  size_t staticInstancesCulled = 0;
+};
+
 class GUI
 {
 public:
@@ -29,8 +50,10 @@ public:
   void drawCircle(glm::vec3 pos, float radius, glm::quat rotation, glm::vec3 color = {1, 1, 1});
   void drawRect(glm::vec3 pos, float width, float height, glm::vec3 color = {1, 1, 1});
   void drawRect(glm::vec3 pos, float width, float height, glm::quat rotation, glm::vec3 color = {1, 1, 1});
+  // Lines and arrows are batched and drawn instanced at endFrame. width is in pixels
   void drawLine(glm::vec3 start, glm::vec3 end, glm::vec3 color = {1, 1, 1}, float width = 1.0f);
   void drawArrow(glm::vec3 start, glm::vec3 end, glm::vec3 color = {1, 1, 1}, float width = 1.0f);
+  void drawArrows(const std::vector<glm::vec3> &starts, const std::vector<glm::vec3> &ends, glm::vec3 color = {1, 1, 1}, float width = 1.0f);
 
   // 3D shapes
   void drawSphere(glm::vec3 pos, float radius, glm::vec3 color = {1, 1, 1});
@@ -43,7 +66,10 @@ public:
   void drawCylinder(glm::vec3 pos, float radius, float length, glm::quat rotation, glm::vec3 color = {1, 1, 1});
   void drawCylinder(glm::vec3 pos, float radius, float length, glm::vec3 axis, glm::quat rotation, glm::vec3 color = {1, 1, 1});
 
-  // OBJ mesh drawing (uses material colors from the mesh)
+  // OBJ mesh drawing (uses material colors from the mesh). Calls are batched
+  // per mesh (keyed by address) and drawn instanced at endFrame, or earlier
+  // when an immediate OBJ draw below flushes them. Until then the mesh must
+  // not be destroyed or moved.
   void drawOBJMesh(OBJMesh &mesh, glm::vec3 pos, float scale = 1.0f);
   void drawOBJMesh(OBJMesh &mesh, glm::vec3 pos, float scale, glm::quat rotation);
   void drawOBJMesh(OBJMesh &mesh, glm::vec3 pos, glm::vec3 scale);
@@ -53,6 +79,55 @@ public:
   void drawOBJMesh(OBJMesh &mesh, glm::vec3 pos, float scale, glm::quat rotation, glm::vec3 color);
   void drawOBJMesh(OBJMesh &mesh, glm::vec3 pos, glm::vec3 scale, glm::vec3 color);
   void drawOBJMesh(OBJMesh &mesh, glm::vec3 pos, glm::vec3 scale, glm::quat rotation, glm::vec3 color);
+  // Many copies drawn immediately, one instanced draw per submesh. The
+  // drawOBJMesh batches queued so far are drawn first, so OBJ draws keep
+  // their call order. colors may be null (or shorter than transforms) to
+  // keep material colors.
+  void drawOBJMeshInstanced(OBJMesh &mesh, const glm::mat4 *transforms, const glm::vec3 *colors, size_t count);
+  void drawOBJMeshInstanced(OBJMesh &mesh, const std::vector<glm::mat4> &transforms, const std::vector<glm::vec3> &colors = {});
+  // Retained OBJ instances for large static scenes. They are kept in a
+  // spatial index (SpatialIndex) and join the drawOBJMesh batches at every
+  // endFrame, but only those the index finds in the view frustum and
+  // within the static draw distance are visited, so the cost per frame
+  // follows what is visible rather than the size of the scene. Meshes
+  // must outlive their instances; handles stay valid until removed.
+  // Instances of a mesh that is still loading are placed once its bounds
+  // arrive, or never if the load fails (until moved).
+  SpatialIndex::Handle addStaticOBJMesh(OBJMesh &mesh, const glm::mat4 &transform);
+  SpatialIndex::Handle addStaticOBJMesh(OBJMesh &mesh, const glm::mat4 &transform, glm::vec3 color);
+  // Many at once, the index built in parallel for large batches. colors
+  // and handles may be null.
+  void addStaticOBJMeshes(OBJMesh &mesh, const glm::mat4 *transforms, const glm::vec3 *colors, size_t count,
+                          SpatialIndex::Handle *handles = nullptr);
+  void moveStaticOBJMesh(SpatialIndex::Handle handle, const glm::mat4 &transform);
+  void removeStaticOBJMesh(SpatialIndex::Handle handle);
+  void clearStaticOBJMeshes();
+  // Static instances whose bounds are farther than this from the camera
+  // are not drawn (0 = no limit, the default)
+  void setStaticDrawDistance(float distance) { m_staticDrawDistance = distance; }
+  // World bounds of the static instances, e.g. for radius and box queries
+  // of picking and selection tools. Handles are those returned above.
+  const SpatialIndex &getStaticIndex() const { return m_staticIndex; }
+
+  // OBJ mesh colored by its per-vertex scalars (OBJMesh::updateScalars),
+  // mapped through a colormap over [minValue, maxValue] (default viridis).
+  // Drawn immediately, after the queued drawOBJMesh batches; nothing is
+  // drawn until the mesh has scalars.
+  void drawOBJMeshScalars(OBJMesh &mesh, const glm::mat4 &transform, float minValue, float maxValue);
+  void drawOBJMeshScalars(OBJMesh &mesh, const glm::mat4 &transform, const Colormap &colormap, float minValue,
+                          float maxValue);
+
+  // Trail drawing. fade in [0, 1] dims samples by age; the oldest sample
+  // reaches alpha 1 - fade (0 = no fading)
+  void drawTrail(const Trail &trail, glm::vec3 color = {1, 1, 1}, float fade = 0.0f);
+
+  // Vector field glyphs, colored by magnitude (default colormap is viridis)
+  void drawVectorField(const VectorField &field);
+  void drawVectorField(const VectorField &field, const Colormap &colormap);
+
+  // Heightfield surface, flat colored or colormapped by (unscaled) height
+  void drawHeightfield(Heightfield &field, glm::vec3 color = {1, 1, 1});
+  void drawHeightfield(Heightfield &field, const Colormap &colormap, float minHeight, float maxHeight);
 
   // Lighting control
   void setLighting(bool enabled) { m_useLighting = enabled; }
@@ -62,6 +137,21 @@ public:
   // Pass farPlane (same value as camera.farPlane) to enable; 0 = disabled (default).
   void setLogDepth(float farPlane) { m_logDepthFarPlane = farPlane; }
 
+  // Bytes of OBJMesh::loadAsync geometry uploaded per frame, shared by every
+  // loading mesh drawn that frame (default 16 MB)
+  void setUploadBudget(size_t bytesPerFrame) { m_uploadBudget = bytesPerFrame; }
+
+  // OBJ meshes loaded with LOD levels draw full detail while their bounding
+  // sphere covers at least this many pixels across, and coarser levels
+  // below that, see OBJMesh::selectLOD (default 256; 0 = always full detail)
+  void setLODThreshold(float pixels) { m_lodThreshold = pixels; }
+
+  // OBJ meshes are frustum culled per instance, and per submesh for
+  // instances crossing the frustum edge (on by default)
+  void setFrustumCulling(bool enabled) { m_frustumCulling = enabled; }
+  // Counts for the last finished frame
+  const OBJCullStats &getCullStats() const { return m_cullStats; }
+
   // Keyboard input
   bool isKeyPressed(int key) const;
   bool isKeyJustPressed(int key) const;
@@ -75,6 +165,7 @@ public:
   glm::vec2 getScrollDelta() const;
 
   // Raycasting: unproject a mouse position into a world-space ray direction
+  // (the view direction while the window has no size)
   glm::vec3 getMouseRay(glm::vec2 mousePos) const;
 
   Camera camera;
@@ -92,6 +183,17 @@ private:
   void initMeshes();
   void setupCallbacks();
   void setupDraw(const glm::mat4 &model, glm::vec3 color);
+  void applyFrameUniforms(const Shader &shader);
+  void flushLines();
+  void drawHeightfield(Heightfield &field, const Colormap *colormap, glm::vec3 color, glm::vec2 colorRange);
+  void drawOBJMesh(OBJMesh &mesh, const glm::mat4 &model, const glm::vec3 *color);
+  void queueOBJInstance(OBJMesh &mesh, const OBJInstance &instance);
+  void queueStaticOBJMeshes();
+  void addStaticPending(OBJMesh &mesh, SpatialIndex::Handle handle);
+  void drawOBJInstances(OBJMesh &mesh, const OBJInstance *instances, size_t count, const Colormap *colormap = nullptr,
+                        glm::vec2 colorRange = glm::vec2(0.0f));
+  void uploadPending(OBJMesh &mesh);
+  void flushOBJMeshes();
 
   // GLFW callbacks
   static void framebufferSizeCallback(GLFWwindow *window, int width, int height);
@@ -108,12 +210,73 @@ private:
   int m_framebufferHeight;
 
   Shader m_shader;
+  Shader m_trailShader;
+  Shader m_lineShader;
+  Shader m_arrowHeadShader;
+  Shader m_vectorFieldShader;
+  Shader m_heightfieldShader;
+  Shader m_objShader;
+  Colormap m_defaultColormap;
   Mesh m_circleMesh;
   Mesh m_quadMesh;
   Mesh m_cubeMesh;
   Mesh m_sphereMesh;
   Mesh m_cylinderMesh;
-  Mesh m_lineMesh;
+  LineBatch m_lineBatch;
+
+  // drawOBJMesh calls of the current frame, one batch per mesh. Batches are
+  // reused across frames so their instance vectors keep their capacity.
+  struct OBJBatch
+  {
+    OBJMesh *mesh = nullptr;
+    std::vector<OBJInstance> instances;
+  };
+  std::vector<OBJBatch> m_objBatches;
+  size_t m_objBatchCount = 0;
+  std::unordered_map<const OBJMesh *, size_t> m_objBatchIndex;
+  std::vector<OBJInstance> m_instanceScratch;
+  size_t m_uploadBudget = 16 << 20;
+  size_t m_uploadBudgetLeft = 0;
+  float m_lodThreshold = 256.0f;
+  std::vector<unsigned int> m_lodLevels;
+  std::vector<OBJInstance> m_lodInstances;
+
+  // Instances with some submeshes culled are drawn one at a time with a
+  // visibility mask (one byte per submesh, stored in m_subMeshMasks), from
+  // the end of the same instance upload as the whole ones
+  struct PartialInstance
+  {
+    size_t instance;
+    size_t maskOffset;
+    unsigned int level;
+  };
+  bool m_frustumCulling = true;
+  Frustum m_frustum;
+  std::vector<PartialInstance> m_partialInstances;
+  std::vector<unsigned char> m_subMeshMasks;
+  OBJCullStats m_frameCullStats;
+  OBJCullStats m_cullStats;
+
+  // Static instances by SpatialIndex handle. Those added before their
+  // mesh's bounds were known (still loading) sit in the index with empty
+  // bounds and are listed as pending, per mesh, until the bounds arrive.
+  struct StaticInstance
+  {
+    OBJMesh *mesh = nullptr;
+    OBJInstance instance;
+  };
+  struct StaticPending
+  {
+    OBJMesh *mesh;
+    std::vector<SpatialIndex::Handle> handles;
+  };
+  SpatialIndex m_staticIndex;
+  std::vector<StaticInstance> m_staticInstances;
+  std::vector<StaticPending> m_staticPending;
+  size_t m_staticPendingCount = 0;
+  std::vector<SpatialIndex::Handle> m_staticVisible;
+  std::vector<AABB> m_staticBounds;
+  float m_staticDrawDistance = 0.0f;
 
   bool m_useLighting = true;
   glm::vec3 m_lightDir{0.5f, 1.0f, 0.3f};
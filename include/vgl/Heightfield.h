@@ -0,0 +1,87 @@
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Regular grid of heights in the XZ plane, displaced along +Y.
+// Heights live in a single R32F texture; geometry is a static chunk grid
+// shared by every chunk, with one index range per LOD level. Vertex
+// positions and normals are reconstructed from the texture in the shader.
+// Chunks are drawn instanced, one draw per LOD level in use.
+class Heightfield {
+public:
+  static constexpr int CHUNK_SIZE = 64; // quads per chunk side
+
+  Heightfield() = default;
+  ~Heightfield();
+  Heightfield(Heightfield&& other) noexcept;
+  Heightfield& operator=(Heightfield&& other) noexcept;
+  Heightfield(const Heightfield&) = delete;
+  Heightfield& operator=(const Heightfield&) = delete;
+
+  // size samples per axis (x along X, y along Z), origin is sample (0, 0).
+  // Also picks the LOD distance and skirt depth defaults below, unless they
+  // were set explicitly (before or after this call).
+  Heightfield& setGrid(glm::ivec2 size, glm::vec3 origin, glm::vec2 spacing);
+  Heightfield& setHeightScale(float scale) { m_heightScale = scale; return *this; }
+  // Chunks farther than this drop one level per doubling of distance (0 = full resolution).
+  // Defaults to four chunk widths on grids larger than 4096 on a side, 0 otherwise.
+  Heightfield& setLODDistance(float distance) { m_lodDistance = distance; m_lodDistanceSet = true; return *this; }
+  // How far chunk skirts hang below the surface to hide LOD cracks.
+  // Defaults to 5% of a chunk width.
+  Heightfield& setSkirtDepth(float depth) { m_skirtDepth = depth; m_skirtDepthSet = true; return *this; }
+
+  // Full upload, size.x * size.y heights with x fastest. Heights live in one
+  // texture, so a grid larger than GL_MAX_TEXTURE_SIZE on a side is not
+  // uploaded; false is returned with getError() set.
+  bool update(const std::vector<float>& heights);
+  bool update(const float* heights);
+  // Dirty sub-rectangle. rowStride is the source row length in floats (0 = width)
+  void updateRegion(int x, int y, int width, int height, const float* heights, int rowStride = 0);
+
+  // Selects a LOD per chunk from the camera position and draws
+  void draw(glm::vec3 cameraPos);
+  void bindHeights(unsigned int unit) const;
+
+  glm::ivec2 getSize() const { return m_size; }
+  glm::vec3 getOrigin() const { return m_origin; }
+  glm::vec2 getSpacing() const { return m_spacing; }
+  float getHeightScale() const { return m_heightScale; }
+  float getSkirtDepth() const { return m_skirtDepth; }
+  bool isUploaded() const { return m_texture != 0; }
+  const std::string& getError() const { return m_error; }
+
+private:
+  struct LODRange {
+    unsigned int indexOffset;
+    unsigned int indexCount;
+  };
+
+  void init();
+  void cleanup();
+  void buildChunkIndices(std::vector<unsigned int>& indices);
+
+  GLuint m_texture = 0;
+  GLuint m_vao = 0;
+  GLuint m_ebo = 0;
+  GLuint m_instanceVbo = 0;
+  std::vector<LODRange> m_lods;
+  std::vector<std::vector<glm::ivec2>> m_chunksPerLOD;
+  std::vector<glm::ivec2> m_instanceData;
+
+  glm::ivec2 m_size{0, 0};
+  glm::ivec2 m_textureSize{0, 0};
+  glm::vec3 m_origin{0, 0, 0};
+  glm::vec2 m_spacing{1, 1};
+  float m_heightScale = 1.0f;
+  float m_lodDistance = 0.0f;
+  float m_skirtDepth = 1.0f;
+  bool m_lodDistanceSet = false;
+  bool m_skirtDepthSet = false;
+  std::string m_error;
+};
+
+#endif
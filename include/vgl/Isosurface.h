@@ -0,0 +1,71 @@
+#ifndef ISOSURFACE_H
+#define ISOSURFACE_H
+
+#include <vgl/Mesh.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+// Marching-cubes isosurface extraction over a regular scalar grid.
+// The grid is split into blocks of BLOCK_SIZE^3 cells; a per-block min/max
+// table lets extract() skip blocks the iso value cannot cross. Active blocks
+// are polygonized in parallel into their own vertex lists, which are then
+// compacted with a prefix sum into one contiguous array.
+//
+// Normals come from the field gradient and point toward lower values
+// (out of a density blob). Use setInvertNormals for signed distance fields.
+class Isosurface
+{
+public:
+  static constexpr int BLOCK_SIZE = 8;
+
+  Isosurface() = default;
+
+  // data holds dims.x * dims.y * dims.z samples, x fastest, and must stay
+  // valid until the last extract(). Rebuilds the block min/max table.
+  void setField(const float *data, glm::ivec3 dims, glm::vec3 origin, glm::vec3 spacing);
+  // Call after changing values in place behind the same pointer
+  void refreshField();
+  Isosurface &setInvertNormals(bool invert)
+  {
+    m_invertNormals = invert;
+    return *this;
+  }
+
+  // Returns the triangle count
+  size_t extract(float isoValue);
+  // Extracts and uploads into mesh, reusing its GPU buffers
+  size_t extract(float isoValue, Mesh &mesh);
+
+  const std::vector<Vertex> &getVertices() const { return m_vertices; }
+  size_t getTriangleCount() const { return m_vertices.size() / 3; }
+  size_t getBlockCount() const { return m_blockRanges.size(); }
+  // Blocks polygonized by the last extract (the rest were skipped)
+  size_t getActiveBlockCount() const { return m_activeBlockCount; }
+
+private:
+  void polygonizeBlock(size_t block, float isoValue, std::vector<Vertex> &out) const;
+  glm::vec3 gradient(int x, int y, int z) const;
+  float sample(int x, int y, int z) const
+  {
+    return m_data[(static_cast<size_t>(z) * m_dims.y + y) * m_dims.x + x];
+  }
+
+  const float *m_data = nullptr;
+  glm::ivec3 m_dims{0, 0, 0};
+  glm::ivec3 m_blockDims{0, 0, 0};
+  glm::vec3 m_origin{0, 0, 0};
+  glm::vec3 m_spacing{1, 1, 1};
+  bool m_invertNormals = false;
+
+  std::vector<glm::vec2> m_blockRanges; // min, max per block
+  std::vector<size_t> m_activeBlocks;
+  std::vector<std::vector<Vertex>> m_blockVertices;
+  std::vector<size_t> m_blockOffsets;
+  size_t m_activeBlockCount = 0;
+
+  std::vector<Vertex> m_vertices;
+  std::vector<unsigned int> m_indices;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef LINEBATCH_H
+#define LINEBATCH_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Per-frame batch of line segments and arrowheads.
+// Each segment is one instance, expanded into a screen-space quad by the
+// vertex shader so widths work on core profiles. Arrowheads are instanced
+// cones. A full batch draws in two calls regardless of its size.
+class LineBatch {
+public:
+  LineBatch() = default;
+  ~LineBatch();
+  LineBatch(const LineBatch&) = delete;
+  LineBatch& operator=(const LineBatch&) = delete;
+
+  void addLine(glm::vec3 start, glm::vec3 end, glm::vec3 color, float width);
+  void addArrow(glm::vec3 start, glm::vec3 end, glm::vec3 color, float width);
+  void reserve(size_t lines, size_t arrows);
+
+  // Streams the queued instances to the GPU
+  void upload();
+  void drawLines() const;
+  void drawArrowHeads() const;
+  void clear();
+
+  bool hasLines() const { return !m_lines.empty(); }
+  bool hasArrowHeads() const { return !m_cones.empty(); }
+
+private:
+  struct LineInstance {
+    glm::vec3 start;
+    glm::vec3 end;
+    glm::vec3 color;
+    float width;
+  };
+
+  struct ConeInstance {
+    glm::vec3 base;
+    glm::vec3 axis; // base to tip
+    glm::vec3 color;
+    float radius;
+  };
+
+  void init();
+
+  std::vector<LineInstance> m_lines;
+  std::vector<ConeInstance> m_cones;
+
+  GLuint m_lineVao = 0;
+  GLuint m_lineVbo = 0;
+  GLuint m_coneVao = 0;
+  GLuint m_coneVbo = 0;
+  GLuint m_coneEbo = 0;
+  GLuint m_coneInstanceVbo = 0;
+  unsigned int m_coneIndexCount = 0;
+};
+
+#endif
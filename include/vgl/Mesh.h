@@ -3,6 +3,7 @@
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
 
 struct Vertex {
@@ -11,6 +12,8 @@ struct Vertex {
   glm::vec2 uv;
 };
 
+class MeshArena;
+
 class Mesh {
 public:
   Mesh();
@@ -21,21 +24,127 @@ public:
   Mesh& operator=(const Mesh&) = delete;
 
   void upload(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+  void upload(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+  // Re-fills the existing buffers, growing them geometrically only when the
+  // data no longer fits. For geometry that changes every frame.
+  void update(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+  void update(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+  // Static storage for vertexCount/indexCount elements, left undefined and
+  // filled piece by piece with uploadRange (e.g. spread over several frames)
+  void allocate(size_t vertexCount, size_t indexCount);
+  void uploadRange(size_t firstVertex, const Vertex* vertices, size_t vertexCount,
+                   size_t firstIndex, const unsigned int* indices, size_t indexCount);
+  // Reallocates the storage to exactly vertexCount/indexCount elements,
+  // keeping the leading contents (copied on the GPU, nothing is read back)
+  void resize(size_t vertexCount, size_t indexCount);
+  // Write access to all of a static mesh's vertex and index storage, e.g.
+  // to decode straight into it from worker threads; the old contents are
+  // discarded. False for arena, dynamic, line and empty meshes. Call
+  // unmapStorage() on the GL thread before drawing; it returns false if
+  // the driver lost the data, which then has to be uploaded again.
+  bool mapStorage(Vertex*& vertices, unsigned int*& indices);
+  bool unmapStorage();
+  // Suballocated from a shared arena instead of owning buffers (see
+  // MeshArena). The other calls work the same on such a mesh; update and
+  // resize stay in the arena, upload/allocate without one leave it.
+  void upload(MeshArena& arena, const Vertex* vertices, size_t vertexCount, const unsigned int* indices,
+              size_t indexCount);
+  void allocate(MeshArena& arena, size_t vertexCount, size_t indexCount);
+  bool isArenaBacked() const { return m_arena != nullptr; }
+  size_t getVertexCapacity() const { return m_vertexCapacity; }
+  size_t getIndexCapacity() const { return m_indexCapacity; }
+
+  // Deformable geometry: the topology is fixed here and vertices are then
+  // rewritten in place with updateVertices/updatePositions. Positions get a
+  // buffer of their own so they can be written alone. With bufferCount 2 or
+  // 3 the vertex data is kept in that many copies written round-robin, each
+  // fenced when the mesh moves on from it, so a write only waits for draws
+  // issued bufferCount updates ago instead of the last frame's.
+  void uploadDynamic(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+                     unsigned int bufferCount = 1);
+  // Rewrites vertices [first, first + count). Works on static meshes too,
+  // which just take a synchronized buffer update.
+  void updateVertices(size_t first, const Vertex* vertices, size_t count);
+  // Rewrites positions only, keeping normals and uvs (e.g. when normals are
+  // derived in a shader). Dynamic meshes only.
+  void updatePositions(size_t first, const glm::vec3* positions, size_t count);
+  bool isDynamic() const { return !m_copies.empty(); }
+
+  // Optional per-vertex scalar at attribute 8 (e.g. a simulation result to
+  // colormap). It has a buffer of its own, so it can change every frame
+  // without re-sending vertex data; each update orphans that buffer and is
+  // one upload. Not available on arena meshes, which share their VAO.
+  void updateScalars(const float* values, size_t count);
+  // The same in place: fill getVertexCapacity() floats at the returned
+  // pointer (any thread), then call unmapScalars() on the GL thread.
+  // Null when the mesh has no vertex storage.
+  float* mapScalars();
+  void unmapScalars();
+  void clearScalars();
+  bool hasScalars() const { return m_scalarBuffer != 0; }
+
   void uploadLines(const std::vector<glm::vec3>& points);
   void draw() const;
+  // Several index ranges with one VAO bind: bind(), drawRange()..., unbind().
+  // baseVertex is added to every index of the range.
+  void bind() const;
+  void drawRange(size_t indexOffset, size_t indexCount, int baseVertex = 0, size_t instanceCount = 1) const;
+  static void unbind();
   void drawLines() const;
-  bool isUploaded() const { return m_vao != 0; }
+  bool isUploaded() const { return m_vao != 0 || m_arena; }
+  // Vertex, scalar and index buffer storage of a triangle mesh, all copies included
+  size_t getGPUBytes() const;
 
 private:
+  // Reads the range handle and index count of arena meshes for batched draws
+  friend class MeshArena;
+
+  // Vertices [first, end)
+  struct VertexRange {
+    size_t first;
+    size_t end;
+  };
+
+  // One copy of a dynamic mesh's vertex data. The dirty lists hold the
+  // ranges other copies were written in since this one was last current;
+  // only those are refreshed from the latest copy before it is written.
+  struct DynamicCopy {
+    GLuint positionBuffer = 0;
+    GLuint vertexBuffer = 0;
+    GLsync fence = nullptr;
+    std::vector<VertexRange> dirtyPositions;
+    std::vector<VertexRange> dirtyVertices;
+  };
+
   void cleanup();
   void setupAttributes();
+  // Moves to the next copy, waits for the GPU to be done with it, refreshes
+  // the ranges it missed except those inside [first, first + count), which
+  // are about to be rewritten (vertex data only with writesVertices), and
+  // points the VAO at it. The flags report which buffers were refreshed.
+  DynamicCopy& beginWrite(size_t first, size_t count, bool writesVertices, bool& positionsRefreshed,
+                          bool& verticesRefreshed);
+  // Marks [first, first + count) dirty in every copy but the current one
+  void endWrite(size_t first, size_t count, bool wroteVertices);
 
   GLuint m_vao = 0;
   GLuint m_vbo = 0;
   GLuint m_ebo = 0;
   unsigned int m_indexCount = 0;
   unsigned int m_vertexCount = 0;
+  size_t m_vertexCapacity = 0;
+  size_t m_indexCapacity = 0;
   bool m_isLineMode = false;
+
+  std::vector<DynamicCopy> m_copies;
+  size_t m_currentCopy = 0;
+  std::vector<char> m_writeScratch;
+
+  MeshArena* m_arena = nullptr;
+  uint32_t m_arenaHandle = 0;
+
+  GLuint m_scalarBuffer = 0;
+  size_t m_scalarCapacity = 0;
 };
 
 namespace MeshGen {
@@ -44,6 +153,9 @@ namespace MeshGen {
   void cube(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
   void sphere(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, int rings = 16, int sectors = 32);
   void cylinder(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, int segments = 32);
+  void cone(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, int segments = 32);
+  // Glyph arrow from y = 0 (tail) to y = 1 (tip), head radius 0.5, shaft radius 0.2
+  void arrow(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, int segments = 8);
 }
 
 #endif
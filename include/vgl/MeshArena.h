@@ -0,0 +1,161 @@
+#ifndef MESHARENA_H
+#define MESHARENA_H
+
+#include <vgl/Mesh.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit (TLSF) allocator over a range of elements.
+// Free blocks are kept in lists by size class and found through two
+// bitmaps, so allocate and free take constant time; a freed block is merged
+// with free neighbours right away.
+class RangeAllocator
+{
+public:
+  static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+  struct Allocation
+  {
+    size_t offset = 0;
+    uint32_t block = NONE; // pass to free(); NONE for empty allocations
+  };
+
+  explicit RangeAllocator(size_t capacity = 0);
+
+  // Forgets every allocation and starts over with one free block
+  void reset(size_t capacity);
+  // Extends the range at the end; existing allocations keep their offsets
+  void grow(size_t capacity);
+  // False when no free block is large enough
+  bool allocate(size_t size, Allocation &allocation);
+  void free(uint32_t block);
+
+  size_t getCapacity() const { return m_capacity; }
+  size_t getUsed() const { return m_used; }
+  size_t getLargestFree() const;
+
+private:
+  static constexpr int SL_BITS = 4;
+  static constexpr int SL_COUNT = 1 << SL_BITS;
+  static constexpr int FL_COUNT = 64 - SL_BITS + 1;
+
+  struct Block
+  {
+    size_t offset = 0;
+    size_t size = 0;
+    uint32_t prevPhysical = NONE;
+    uint32_t nextPhysical = NONE;
+    uint32_t prevFree = NONE;
+    uint32_t nextFree = NONE;
+    bool isFree = false;
+  };
+
+  static void mapping(size_t size, int &fl, int &sl);
+  uint32_t newBlock();
+  void insertFree(uint32_t block);
+  void removeFree(uint32_t block);
+
+  std::vector<Block> m_blocks;
+  std::vector<uint32_t> m_unusedBlocks;
+  std::array<uint32_t, FL_COUNT * SL_COUNT> m_heads;
+  uint64_t m_flBitmap = 0;
+  std::array<uint32_t, FL_COUNT> m_slBitmaps{};
+  uint32_t m_lastBlock = NONE;
+  size_t m_capacity = 0;
+  size_t m_used = 0;
+};
+
+struct MeshArenaStats
+{
+  size_t allocatedBytes = 0;  // GPU storage of the shared buffers
+  size_t usedBytes = 0;       // held by meshes
+  size_t fragmentedBytes = 0; // free, but outside each buffer's largest free block
+  size_t meshCount = 0;
+
+  size_t freeBytes() const { return allocatedBytes - usedBytes; }
+};
+
+// Vertex and index storage shared by many meshes: one vertex buffer, one
+// index buffer and one VAO, carved into ranges with a RangeAllocator. A
+// Mesh uploaded into an arena (Mesh::upload(arena, ...)) is only a handle
+// to its range and draws with an index offset and base vertex, so
+// thousands of small meshes cost three GL objects in total. Mesh::draw
+// still binds the VAO per mesh; draw() below takes many of them with one
+// bind and one multi-draw call.
+//
+// The buffers are created on first use and doubled when full.
+// defragment() packs the ranges together again after many frees; handles
+// stay valid, only the offsets change. Owns GPU resources: use it on the GL
+// thread and keep it alive longer than its meshes.
+class MeshArena
+{
+public:
+  struct Range
+  {
+    size_t vertexOffset = 0;
+    size_t vertexCount = 0;
+    size_t indexOffset = 0;
+    size_t indexCount = 0;
+  };
+
+  explicit MeshArena(size_t vertexCapacity = 1u << 16, size_t indexCapacity = 1u << 18);
+  ~MeshArena();
+
+  MeshArena(const MeshArena &) = delete;
+  MeshArena &operator=(const MeshArena &) = delete;
+
+  // Reserves a range with undefined contents and returns its handle
+  uint32_t allocate(size_t vertexCount, size_t indexCount);
+  void release(uint32_t handle);
+  // New range of the given size keeping the leading contents (copied on the GPU)
+  void resize(uint32_t handle, size_t vertexCount, size_t indexCount);
+  // Offsets are relative to the range
+  void write(uint32_t handle, size_t firstVertex, const Vertex *vertices, size_t vertexCount,
+             size_t firstIndex, const unsigned int *indices, size_t indexCount);
+
+  const Range &getRange(uint32_t handle) const { return m_ranges[handle].range; }
+  GLuint getVAO() const { return m_vao; }
+
+  // Draws the given meshes of this arena (others are skipped) with the
+  // current shader and uniforms: one VAO bind and one
+  // glMultiDrawElementsBaseVertex over their index ranges.
+  void draw(const Mesh *const *meshes, size_t count);
+  void draw(const std::vector<const Mesh *> &meshes) { draw(meshes.data(), meshes.size()); }
+
+  // Moves every range to the front of fresh buffers, leaving one free block
+  // per buffer. Costs a second set of buffers while it runs.
+  void defragment();
+  MeshArenaStats getStats() const;
+
+private:
+  struct Slot
+  {
+    Range range;
+    uint32_t vertexBlock = RangeAllocator::NONE;
+    uint32_t indexBlock = RangeAllocator::NONE;
+    bool isLive = false;
+  };
+
+  void createBuffers();
+  // Doubles a buffer (or more, to fit needed elements), keeping its contents
+  void growBuffer(GLuint &buffer, RangeAllocator &allocator, size_t elementSize, size_t needed);
+  void allocateBlocks(size_t vertexCount, size_t indexCount, Slot &slot);
+  void setupVAO();
+
+  GLuint m_vao = 0;
+  GLuint m_vbo = 0;
+  GLuint m_ebo = 0;
+  RangeAllocator m_vertices;
+  RangeAllocator m_indices;
+  std::vector<Slot> m_ranges;
+  std::vector<uint32_t> m_unusedRanges;
+  size_t m_meshCount = 0;
+  // draw() arguments, kept to reuse their capacity
+  std::vector<GLsizei> m_drawCounts;
+  std::vector<const void *> m_drawOffsets;
+  std::vector<GLint> m_drawBaseVertices;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef MESHOPTIMIZE_H
+#define MESHOPTIMIZE_H
+
+#include <vgl/Mesh.h>
+#include <vector>
+
+// Reordering passes for indexed triangle lists. None of them change the
+// rendered result, only the order the GPU sees triangles and vertices in.
+// Typical use: vertexCache, then optionally overdraw, then vertexFetch.
+namespace MeshOptimize {
+  // Average cache miss ratio (vertex shader runs per triangle) for a FIFO
+  // post-transform cache. 0.5 is ideal for large grids, 3.0 is no reuse.
+  float computeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+  // Forsyth's linear-speed vertex cache optimization: greedily emits the
+  // triangle whose vertices score best for an LRU cache of 32 entries
+  void vertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+  // Splits the (cache-optimized) order into clusters and sorts them
+  // outside-in, so front faces tend to be drawn first. Cuts are placed so
+  // the ACMR stays near threshold times the input's.
+  void overdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+  // Renumbers vertices in first-use order so vertex fetches walk memory
+  // linearly. companion, if given, holds one value per vertex and is
+  // reordered along with them.
+  void vertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                   std::vector<unsigned int>* companion = nullptr);
+
+  // Quadric error edge collapse (Garland & Heckbert) down to about
+  // targetIndexCount indices. Unlike the passes above this changes the
+  // shape: vertices are collapsed onto neighbours, so the result indexes the
+  // same vertex array and needs no new vertices. Vertices on open edges
+  // never move, which keeps outlines and submesh (material) boundaries in
+  // place. On seams (several vertices at one position, e.g. UV or normal
+  // splits) all vertices at a position move together, each to the vertex
+  // on its side of the seam, and only along the seam; seam corners stay.
+  // Stops early when no allowed collapse is left. If error is given it
+  // receives the largest collapse error relative to the mesh's extent.
+  std::vector<unsigned int> simplify(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices,
+                                     size_t targetIndexCount, float* error = nullptr);
+}
+
+#endif
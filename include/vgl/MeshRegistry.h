@@ -0,0 +1,72 @@
+#ifndef MESHREGISTRY_H
+#define MESHREGISTRY_H
+
+#include <vgl/OBJMesh.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Shares loaded OBJ meshes between everything that asks for the same file.
+// Assets are keyed by canonical path plus the load options that change the
+// built geometry, so "parts/gear.obj" and "./parts/../parts/gear.obj" give
+// the same handle and the file is parsed and uploaded once.
+//
+// The registry keeps its own reference to every asset. One that nobody else
+// holds is unreferenced: it stays resident so the next request is free, and
+// is evicted (least recently requested first) once the resident total goes
+// over the memory cap. Handles stay valid for as long as they are held.
+//
+// Owns GPU resources, so use it on the GL thread and destroy it before the
+// GL context.
+class MeshRegistry
+{
+public:
+  explicit MeshRegistry(size_t memoryCap = 256u << 20);
+
+  MeshRegistry(const MeshRegistry &) = delete;
+  MeshRegistry &operator=(const MeshRegistry &) = delete;
+
+  // Resident asset, or a fresh synchronous load (null on failure, see
+  // getError). An asset still loading asynchronously is waited for and
+  // fully uploaded first.
+  std::shared_ptr<OBJMesh> load(const std::string &path, const OBJLoadOptions &options = {});
+  // Resident or loading asset, or a new OBJMesh::loadAsync. Never null;
+  // failures are reported by the mesh itself.
+  std::shared_ptr<OBJMesh> loadAsync(const std::string &path, const OBJLoadOptions &options = {});
+  // Already registered asset, or null. Does not load.
+  std::shared_ptr<OBJMesh> find(const std::string &path, const OBJLoadOptions &options = {});
+
+  // Unreferenced assets are evicted while the resident total exceeds this
+  void setMemoryCap(size_t bytes);
+  size_t getMemoryCap() const { return m_memoryCap; }
+  // GPU bytes of every registered asset, referenced or not
+  size_t getResidentBytes() const;
+  size_t getAssetCount() const { return m_assets.size(); }
+
+  // Applies the cap now. Runs on every load; call it after dropping handles
+  // to release memory without loading something new.
+  void trim();
+  // Evicts every unreferenced asset regardless of the cap
+  void purge();
+
+  const std::string &getError() const { return m_error; }
+
+private:
+  struct Asset
+  {
+    std::shared_ptr<OBJMesh> mesh;
+    uint64_t lastUsed = 0;
+  };
+
+  static std::string makeKey(const std::string &path, const OBJLoadOptions &options);
+  Asset *lookup(const std::string &key);
+
+  std::unordered_map<std::string, Asset> m_assets;
+  size_t m_memoryCap;
+  uint64_t m_clock = 0;
+  std::string m_error;
+};
+
+#endif
@@ -1,9 +1,15 @@
 #ifndef OBJMESH_H
 #define OBJMESH_H
 
+#include <vgl/Bounds.h>
 #include <vgl/Mesh.h>
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <future>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <vector>
 #include <unordered_map>
 
@@ -14,42 +20,298 @@ struct Material
   glm::vec3 ambient{0.2f, 0.2f, 0.2f};
   glm::vec3 specular{1.0f, 1.0f, 1.0f};
   float shininess = 32.0f;
+  // map_Kd image, resolved against the MTL file's directory (empty = none).
+  // The texture multiplies the diffuse color.
+  std::string diffuseMap;
 };
 
+// A simplified index range over its submesh's vertices
+struct SubMeshLOD
+{
+  size_t indexOffset = 0;
+  size_t indexCount = 0;
+};
+
+// A material group: a range of the shared index buffer. Indices are local
+// to the submesh's own vertex range, which starts at baseVertex.
 struct SubMesh
 {
-  Mesh mesh;
   Material material;
+  // Where material.diffuseMap ended up: a layer of one of the model's
+  // texture arrays (textureArray -1: untextured, or the image failed to load)
+  int textureArray = -1;
+  int textureLayer = 0;
+  size_t indexOffset = 0;
+  size_t indexCount = 0;
+  int baseVertex = 0;
+  size_t vertexCount = 0;
+  // Levels 1, 2, ... of detail, each coarser than the last. Their indices
+  // follow the submesh's own range directly.
+  std::vector<SubMeshLOD> lods;
+  // Model space
+  AABB bounds;
+  BoundingSphere sphere;
+
+  // Index range drawn at the given level (past the end of the chain: the
+  // coarsest level)
+  SubMeshLOD getLevel(unsigned int lod) const
+  {
+    if (lod == 0 || lods.empty())
+      return {indexOffset, indexCount};
+    return lods[std::min<size_t>(lod, lods.size()) - 1];
+  }
+};
+
+// Per-copy data for instanced drawing. color.a = 0 keeps the material
+// colors, color.a = 1 overrides every submesh with color.rgb.
+struct OBJInstance
+{
+  glm::mat4 transform{1.0f};
+  glm::vec4 color{0.0f};
+};
+
+struct OBJLoadOptions
+{
+  // Threads used to parse the file (0 = every thread of ThreadPool::shared()).
+  // Large files are split into line-aligned chunks parsed in parallel; the
+  // result is identical to a serial parse.
+  unsigned int threadCount = 0;
+
+  // Keep a binary copy of the built geometry and load that instead of
+  // re-parsing while the OBJ and its MTL files are unchanged
+  bool useCache = false;
+  // Where cache files go (empty = next to the OBJ as <file>.vglcache)
+  std::string cacheDir;
+  // Write the cache packed, for caches on network or otherwise slow
+  // storage: about a third of the raw size, and decoded at over 1 GB/s
+  // per thread. load() decodes straight into the mapped GPU buffers.
+  // Vertices are quantized to 16 bits per component, positions and uvs
+  // over the range they span in the whole mesh (seams and submesh borders
+  // stay closed), so geometry read back from such a cache differs slightly
+  // from a parse.
+  bool compressCache = false;
+
+  // Post-dedup reordering, see MeshOptimize. Vertex cache order is cheap
+  // and always a win; the overdraw pass trades a little of it for drawing
+  // outward-facing clusters first.
+  bool optimizeVertexCache = true;
+  bool optimizeOverdraw = false;
+
+  // Corners without a vn index get smooth normals, weighted by face area
+  // and by the face's angle at the corner (off = constant (0, 1, 0)).
+  // Faces meeting at a sharper angle than creaseAngle degrees keep separate
+  // normals along the edge; 180 smooths everything.
+  bool generateNormals = true;
+  float creaseAngle = 180.0f;
+
+  // Bounded-memory load() for files too big to build in RAM (0 = off).
+  // The file is read in batches sized so that parsing and building one
+  // batch's faces stays within about this many bytes, and each batch goes
+  // to the GPU before the next is read. Vertex attributes are kept for the
+  // whole load, since any face may refer back to them. Batches are
+  // deduplicated and optimized on their own, so vertices shared across a
+  // batch boundary are stored twice. A valid cache is still used, but a
+  // streamed load never writes one. Ignored by loadAsync.
+  size_t streamingBudget = 0;
+
+  // Simplified levels of detail per submesh (0 = none), each with about
+  // lodReduction times the triangles of the one before. They reuse the
+  // submesh's vertices, so they only cost index memory. Open edges and
+  // material boundaries stay in place; UV and normal seams only slide
+  // along themselves. Submeshes are simplified in
+  // parallel on ThreadPool::shared(). A chain ends early once the mesh stops
+  // getting simpler. Not built by streamed loads.
+  unsigned int lodCount = 0;
+  float lodReduction = 0.5f;
+
+  // Remember which OBJ position ('v' line) each built vertex came from, so
+  // per-position values can be passed to OBJMesh::updateScalars. Costs 4
+  // bytes of CPU memory per vertex.
+  bool vertexScalars = false;
+};
+
+// Size of the geometry produced by the last load. Triangle corners that
+// share a (position, uv, normal) index triple share one vertex.
+struct OBJLoadStats
+{
+  size_t triangleCount = 0;
+  size_t vertexCount = 0; // unique vertices uploaded
+  // Average cache miss ratio (16-entry FIFO), triangle weighted, before and
+  // after the optimization passes. Equal when optimization is off.
+  float acmrBefore = 0.0f;
+  float acmrAfter = 0.0f;
+  // Distinct map_Kd images decoded, and those that were missing or in a
+  // format the loader cannot read (PNG, JPEG, TGA, BMP and binary
+  // PPM/PGM are read)
+  size_t textureCount = 0;
+  size_t textureFailures = 0;
+  // Decoded images resized to fit a texture array of another size, when
+  // the model has more than OBJMesh::MAX_TEXTURE_ARRAYS image sizes
+  size_t texturesResized = 0;
+  // "<path>: <reason>" for every image that failed or was resized
+  std::vector<std::string> textureMessages;
+
+  size_t cornerCount() const { return triangleCount * 3; }
+  // Fraction of corners that reused an existing vertex
+  double dedupRate() const { return cornerCount() ? 1.0 - double(vertexCount) / cornerCount() : 0.0; }
+  // Vertex buffer bytes saved compared to one vertex per corner
+  size_t savedBytes() const { return (cornerCount() - vertexCount) * sizeof(Vertex); }
 };
 
 class OBJMesh
 {
 public:
+  // Diffuse textures are packed into this many GL_TEXTURE_2D_ARRAYs at most,
+  // one per image size; images beyond that are resized to the size of the
+  // array with the most layers
+  static constexpr size_t MAX_TEXTURE_ARRAYS = 4;
+
   OBJMesh() = default;
-  ~OBJMesh() = default;
+  ~OBJMesh();
 
-  OBJMesh(OBJMesh &&) = default;
-  OBJMesh &operator=(OBJMesh &&) = default;
+  OBJMesh(OBJMesh &&other) noexcept;
+  OBJMesh &operator=(OBJMesh &&other) noexcept;
   OBJMesh(const OBJMesh &) = delete;
   OBJMesh &operator=(const OBJMesh &) = delete;
 
-  bool load(const std::string &path);
-  bool isLoaded() const { return !m_subMeshes.empty(); }
+  bool load(const std::string &path, const OBJLoadOptions &options = {});
+  // Parses (or reads the cache) on ThreadPool::shared() and returns at once.
+  // The GPU side is filled by uploadPending on the GL thread; until the new
+  // geometry arrives the mesh keeps drawing what it had. Failures show up
+  // as isLoading() turning false with getError() set.
+  void loadAsync(const std::string &path, const OBJLoadOptions &options = {});
+  // Uploads at most byteBudget bytes of pending geometry, submesh by submesh
+  // (a submesh larger than the budget spreads over several calls). Call
+  // once per frame on the GL thread. Returns the bytes uploaded.
+  size_t uploadPending(size_t byteBudget);
+  // Blocks until an asynchronous load has been parsed, then uploads the
+  // rest of it. False if the load failed (see getError).
+  bool finishLoading();
+  bool isLoading() const { return m_loadJob.valid() || m_upload != nullptr; }
+  // True as soon as the first submesh can be drawn
+  bool isLoaded() const { return m_readyCount > 0; }
+  // Submeshes [0, count) are on the GPU and get drawn
+  size_t getReadySubMeshCount() const { return m_readyCount; }
 
   const std::vector<SubMesh> &getSubMeshes() const { return m_subMeshes; }
+  // Every submesh lives in this one vertex/index buffer pair
+  const Mesh &getMesh() const { return m_mesh; }
+  // Geometry plus material buffer and texture storage (allocated as soon
+  // as an asynchronous load starts uploading)
+  size_t getGPUBytes() const
+  {
+    return m_mesh.getGPUBytes() + (m_materialBuffer ? m_subMeshes.size() * 2 * sizeof(glm::vec4) : 0) +
+           m_textureBytes;
+  }
+
+  // Model-space bounds of every submesh together
+  const AABB &getBounds() const { return m_bounds; }
+  const BoundingSphere &getBoundingSphere() const { return m_sphere; }
+
+  // Number of detail levels, the full mesh included. Submeshes with a
+  // shorter chain draw their coarsest level for the levels they lack.
+  size_t getLODCount() const;
+  // Level for a mesh covering pixelSize pixels across on screen. At least
+  // fullDetailSize gets level 0; below it each level covers the size range
+  // where the on-screen area shrank by another lodReduction.
+  unsigned int selectLOD(float pixelSize, float fullDetailSize) const;
+
+  // Per-vertex scalars for colormapped drawing (GUI::drawOBJMeshScalars),
+  // one per OBJ position in file order, e.g. nodal FEM results. Positions
+  // past count get 0. Needs a load with OBJLoadOptions::vertexScalars and
+  // returns false otherwise. Each call is one upload into a buffer of its
+  // own; the geometry is not sent again.
+  bool updateScalars(const float *values, size_t count);
+  bool hasScalars() const { return m_mesh.hasScalars(); }
+  // Number of positions in the file, i.e. the count updateScalars expects
+  size_t getSourcePositionCount() const { return m_sourcePositionCount; }
+
+  // Two RGBA32F texels per submesh, as a samplerBuffer: the diffuse color
+  // at 2 * i, then (textureArray, textureLayer, 0, 0) at 2 * i + 1
+  void bindMaterials(unsigned int unit) const;
+  // Texture array i on unit firstUnit + i, so one bind per array serves
+  // every submesh of the model. The arrays are mipmapped RGBA8.
+  void bindTextures(unsigned int firstUnit) const;
+  size_t getTextureArrayCount() const { return m_textureArrays.size(); }
+  // Draws every submesh once, untransformed and in material colors: one
+  // identity instance through drawInstanced. If materialIndexLocation is a
+  // valid uniform location, the submesh index is set there before each draw.
+  void draw(GLint materialIndexLocation = -1, unsigned int lod = 0);
+  // Streams the instances into the mesh's instance buffer (attribute 3-6:
+  // transform, 7: color, one per instance) and draws each submesh once.
+  // With subMeshVisible (one entry per submesh) only submeshes with a
+  // nonzero entry are drawn.
+  void drawInstanced(const OBJInstance *instances, size_t count, GLint materialIndexLocation = -1,
+                     unsigned int lod = 0, const unsigned char *subMeshVisible = nullptr);
+  // drawInstanced in two steps, for several draws from one upload: the
+  // instances are streamed once, then each drawInstanceRange points the
+  // instance attributes at instance first and draws count instances.
+  void uploadInstances(const OBJInstance *instances, size_t count);
+  void drawInstanceRange(size_t first, size_t count, GLint materialIndexLocation = -1, unsigned int lod = 0,
+                         const unsigned char *subMeshVisible = nullptr);
   const std::string &getError() const { return m_error; }
+  const OBJLoadStats &getStats() const { return m_stats; }
 
 private:
-  bool loadMTL(const std::string &path);
-  void buildMeshes(
+  // CPU-side result of a load, built without touching GL so it can run on
+  // a worker thread
+  struct Geometry;
+  // Decoded layers of one texture array
+  struct TextureLayers;
+
+  // The static loading steps only write into the Geometry they are given
+  static void loadGeometry(const std::string &path, const OBJLoadOptions &options, Geometry &geometry);
+  static bool loadMTL(const std::string &path, std::unordered_map<std::string, Material> &materials);
+  static bool loadCache(const std::string &cachePath, const std::string &source, const OBJLoadOptions &options,
+                        Geometry &geometry);
+  // Decodes a packed cache hit into the Geometry's own arrays
+  static void unpack(Geometry &geometry);
+  static void buildMeshes(
       const std::vector<glm::vec3> &positions,
       const std::vector<glm::vec3> &normals,
       const std::vector<glm::vec2> &texCoords,
-      const std::vector<std::tuple<std::string, std::vector<std::array<int, 9>>>> &materialFaces);
+      const std::vector<std::tuple<std::string, std::vector<std::array<int, 9>>>> &materialFaces,
+      const std::unordered_map<std::string, Material> &materials,
+      const OBJLoadOptions &options,
+      const std::string &cachePath,
+      const std::vector<std::string> &sources,
+      Geometry &geometry);
+  // Decodes every distinct map_Kd image on ThreadPool::shared(), groups
+  // them by size and assigns each submesh its array and layer
+  static void decodeTextures(std::vector<SubMesh> &subMeshes, std::vector<TextureLayers> &arrays,
+                             OBJLoadStats &stats);
+  // load() with OBJLoadOptions::streamingBudget; uploads as it parses
+  bool loadStreaming(const std::string &path, const OBJLoadOptions &options);
+  // Takes over the submeshes and stats and allocates the GPU buffers
+  void beginUpload(std::shared_ptr<Geometry> geometry);
+  // Decodes a packed cache hit straight into the mapped GPU buffers,
+  // falling back to unpack() and a regular upload
+  void uploadPacked();
+  void uploadMaterials();
+  // Replaces the texture arrays; frees the pixels as it goes
+  void uploadTextures(std::vector<TextureLayers> &arrays);
+  // Mesh bounds from the submeshes' bounds
+  void updateBounds();
+  void cleanup();
 
   std::vector<SubMesh> m_subMeshes;
-  std::unordered_map<std::string, Material> m_materials;
+  size_t m_readyCount = 0;
+  Mesh m_mesh;
+  GLuint m_materialBuffer = 0;
+  GLuint m_materialTexture = 0;
+  GLuint m_instanceBuffer = 0;
+  std::vector<GLuint> m_textureArrays;
+  size_t m_textureBytes = 0;
+  std::future<std::shared_ptr<Geometry>> m_loadJob;
+  std::shared_ptr<Geometry> m_upload; // being copied to the GPU
   std::string m_error;
+  OBJLoadStats m_stats;
+  AABB m_bounds;
+  BoundingSphere m_sphere;
+  float m_lodReduction = 0.5f;
+  // Source position of each vertex, with OBJLoadOptions::vertexScalars
+  std::vector<unsigned int> m_positionMap;
+  size_t m_sourcePositionCount = 0;
 };
 
 #endif
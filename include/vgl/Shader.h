@@ -21,7 +21,11 @@ public:
   void use() const;
 
   void setBool(const std::string& name, bool value) const;
+  void setInt(const std::string& name, int value) const;
+  void setIVec2(const std::string& name, const glm::ivec2& value) const;
+  void setIVec3(const std::string& name, const glm::ivec3& value) const;
   void setFloat(const std::string& name, float value) const;
+  void setVec2(const std::string& name, const glm::vec2& value) const;
   void setVec3(const std::string& name, const glm::vec3& value) const;
   void setMat4(const std::string& name, const glm::mat4& mat) const;
 
@@ -0,0 +1,109 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <vgl/Bounds.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Loose octree over axis-aligned boxes, for scenes with far more objects
+// than can be tested one by one each frame. An item belongs to the
+// deepest cell at least as large as the item that contains its center,
+// or to an ancestor of it while only a few items share the branch. A
+// cell's loose bounds are twice its size, so every item lies inside the
+// loose bounds of its cell and a query skips whole subtrees whose loose
+// bounds miss it. Cells fully inside a query are taken without looking at
+// their items.
+//
+// Items are identified by handles, which stay valid until removed and are
+// reused afterwards. Items with empty or non-finite bounds (e.g. a mesh
+// whose bounds are not known yet) are kept but never reported until moved
+// to real bounds. The root grows to take items inserted outside it.
+// Queries may run concurrently with each other, not with changes.
+class SpatialIndex
+{
+public:
+  using Handle = uint32_t;
+  static constexpr Handle NONE = 0xFFFFFFFFu;
+
+  // Replaces the contents; handle i is bounds[i]. Built in parallel on
+  // ThreadPool::shared().
+  void build(const AABB *bounds, size_t count);
+  Handle insert(const AABB &bounds);
+  // Many items at once, their handles written to handles (may be null).
+  // A batch of at least half the current size rebuilds the whole tree in
+  // parallel instead of inserting items one by one.
+  void insert(const AABB *bounds, size_t count, Handle *handles);
+  // Items still within the loose bounds of their cell only update their
+  // box; others are taken out and placed again
+  void move(Handle handle, const AABB &bounds);
+  // Many moves at once; like the batch insert, at least half the current
+  // size rebuilds the whole tree instead
+  void move(const Handle *handles, const AABB *bounds, size_t count);
+  void remove(Handle handle);
+  void clear();
+  // Rebuilds the tree from the current items (same handles), dropping the
+  // cells that moves and removals emptied and refitting the root
+  void rebuild();
+
+  bool contains(Handle handle) const { return handle < m_items.size() && m_items[handle].node != FREE; }
+  const AABB &getBounds(Handle handle) const { return m_items[handle].bounds; }
+  size_t size() const { return m_itemCount; }
+  size_t getNodeCount() const { return m_nodes.size(); }
+
+  // Queries append the handles of the items they find to out. Frustum
+  // tests are as conservative as Frustum::test.
+  void queryFrustum(const Frustum &frustum, std::vector<Handle> &out) const;
+  // In the frustum and no farther than maxDistance from eye (to the box)
+  void queryFrustum(const Frustum &frustum, glm::vec3 eye, float maxDistance, std::vector<Handle> &out) const;
+  // Boxes touching the sphere
+  void queryRadius(glm::vec3 center, float radius, std::vector<Handle> &out) const;
+  // Boxes overlapping box
+  void queryBox(const AABB &box, std::vector<Handle> &out) const;
+
+private:
+  static constexpr uint32_t FREE = 0xFFFFFFFFu;
+  static constexpr uint32_t UNPLACED = 0xFFFFFFFEu;
+  // Cells below rootHalfSize / 2^MAX_DEPTH (at build) are not created
+  static constexpr int MAX_DEPTH = 12;
+
+  struct Item
+  {
+    AABB bounds;
+    uint32_t node = FREE; // FREE, UNPLACED or the cell holding the item
+    uint32_t slot = 0;    // position in the cell's items (or m_unplaced)
+  };
+
+  struct Node
+  {
+    glm::vec3 center{0.0f};
+    float halfSize = 0.0f; // of the cell; the loose bounds reach twice as far
+    uint32_t parent = NONE;
+    uint32_t children[8] = {NONE, NONE, NONE, NONE, NONE, NONE, NONE, NONE};
+    size_t subtreeCount = 0; // items here and below
+    std::vector<Handle> items;
+  };
+
+  Handle allocate(const AABB &bounds);
+  void place(Handle handle);
+  void unplace(Handle handle);
+  uint32_t newNode(glm::vec3 center, float halfSize, uint32_t parent);
+  void growRoot(const AABB &bounds);
+  void addCount(uint32_t node, ptrdiff_t delta);
+  AABB looseBounds(const Node &node) const;
+
+  template <typename Classify>
+  void query(const Classify &classify, std::vector<Handle> &out) const;
+  void appendSubtree(uint32_t node, std::vector<Handle> &out) const;
+
+  std::vector<Item> m_items;
+  std::vector<Handle> m_freeHandles;
+  std::vector<Handle> m_unplaced;
+  std::vector<Node> m_nodes;
+  uint32_t m_root = NONE;
+  float m_minHalfSize = 0.0f;
+  size_t m_itemCount = 0;
+};
+
+#endif
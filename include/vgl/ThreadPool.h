@@ -0,0 +1,58 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with a FIFO job queue.
+// parallelFor runs on the calling thread too, so it is safe to call from
+// inside a job without starving the pool.
+class ThreadPool
+{
+public:
+  // 0 = one worker per hardware thread
+  explicit ThreadPool(unsigned int threadCount = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  template <typename F>
+  auto submit(F &&task) -> std::future<decltype(task())>
+  {
+    using Result = decltype(task());
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> future = packaged->get_future();
+    enqueue([packaged]()
+            { (*packaged)(); });
+    return future;
+  }
+
+  // Calls body(i) for every i in [0, count) and blocks until all are done.
+  // The first exception thrown by body is rethrown here.
+  void parallelFor(size_t count, const std::function<void(size_t)> &body);
+
+  unsigned int getThreadCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+  // Process-wide pool used by the library's parallel paths
+  static ThreadPool &shared();
+
+private:
+  void enqueue(std::function<void()> job);
+  void workerLoop();
+
+  std::vector<std::thread> m_workers;
+  std::deque<std::function<void()>> m_jobs;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stopping = false;
+};
+
+#endif
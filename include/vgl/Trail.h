@@ -0,0 +1,44 @@
+#ifndef TRAIL_H
+#define TRAIL_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+// Fixed-capacity polyline backed by a GPU ring buffer.
+// Appending only uploads the new samples; once full, the oldest samples are
+// overwritten. Drawing takes at most two line-strip draws.
+class Trail {
+public:
+  explicit Trail(unsigned int capacity = 10000);
+  ~Trail();
+  Trail(Trail&& other) noexcept;
+  Trail& operator=(Trail&& other) noexcept;
+  Trail(const Trail&) = delete;
+  Trail& operator=(const Trail&) = delete;
+
+  void append(glm::vec3 point);
+  void append(const std::vector<glm::vec3>& points);
+  void append(const glm::vec3* points, size_t count);
+  void clear();
+  void draw() const;
+
+  unsigned int size() const { return m_count; }
+  unsigned int capacity() const { return m_capacity; }
+  // Slot the next sample will be written to (the newest sample is head - 1)
+  unsigned int getHead() const { return m_head; }
+
+private:
+  void init();
+  void cleanup();
+  void write(unsigned int slot, const glm::vec3* points, unsigned int count);
+
+  GLuint m_vao = 0;
+  GLuint m_vbo = 0;
+  unsigned int m_capacity = 0;
+  unsigned int m_head = 0;
+  unsigned int m_count = 0;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef VECTORFIELD_H
+#define VECTORFIELD_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+// Arrow glyphs for a vec3 field sampled on a regular 3D grid.
+// Vectors live in a per-instance buffer (x fastest, then y, then z); glyph
+// placement, orientation, length scaling and colormapping happen in the
+// vertex shader, so updating the field is a single upload.
+class VectorField {
+public:
+  VectorField() = default;
+  ~VectorField();
+  VectorField(VectorField&& other) noexcept;
+  VectorField& operator=(VectorField&& other) noexcept;
+  VectorField(const VectorField&) = delete;
+  VectorField& operator=(const VectorField&) = delete;
+
+  // dims samples per axis, origin is the position of sample (0, 0, 0)
+  VectorField& setGrid(glm::ivec3 dims, glm::vec3 origin, glm::vec3 spacing);
+  // World length of a glyph per unit magnitude
+  VectorField& setScale(float scale) { m_scale = scale; return *this; }
+  // Glyph length clamp in world units (0 = unclamped)
+  VectorField& setMaxLength(float length) { m_maxLength = length; return *this; }
+  // Glyph thickness in world units (0 = 30% of the smallest spacing)
+  VectorField& setGlyphWidth(float width) { m_glyphWidth = width; return *this; }
+  // Samples with a magnitude at or below this draw no glyph (default 1e-6)
+  VectorField& setMinMagnitude(float magnitude) { m_minMagnitude = magnitude; return *this; }
+  // Magnitude range mapped onto the colormap
+  VectorField& setRange(float minMagnitude, float maxMagnitude) { m_rangeMin = minMagnitude; m_rangeMax = maxMagnitude; return *this; }
+
+  // Replaces the whole field; count must equal dims.x * dims.y * dims.z
+  void update(const std::vector<glm::vec3>& vectors);
+  void update(const glm::vec3* vectors, size_t count);
+  void draw() const;
+
+  glm::ivec3 getDims() const { return m_dims; }
+  glm::vec3 getOrigin() const { return m_origin; }
+  glm::vec3 getSpacing() const { return m_spacing; }
+  float getScale() const { return m_scale; }
+  float getMaxLength() const { return m_maxLength; }
+  float getGlyphWidth() const;
+  float getMinMagnitude() const { return m_minMagnitude; }
+  float getRangeMin() const { return m_rangeMin; }
+  float getRangeMax() const { return m_rangeMax; }
+  size_t getSampleCount() const { return (size_t)m_dims.x * m_dims.y * m_dims.z; }
+  bool isUploaded() const { return m_uploadedCount != 0; }
+
+private:
+  void init();
+  void cleanup();
+
+  GLuint m_vao = 0;
+  GLuint m_glyphVbo = 0;
+  GLuint m_glyphEbo = 0;
+  GLuint m_instanceVbo = 0;
+  unsigned int m_glyphIndexCount = 0;
+  size_t m_uploadedCount = 0;
+
+  glm::ivec3 m_dims{0, 0, 0};
+  glm::vec3 m_origin{0, 0, 0};
+  glm::vec3 m_spacing{1, 1, 1};
+  float m_scale = 1.0f;
+  float m_maxLength = 0.0f;
+  float m_glyphWidth = 0.0f;
+  float m_minMagnitude = 1e-6f;
+  float m_rangeMin = 0.0f;
+  float m_rangeMax = 1.0f;
+};
+
+#endif
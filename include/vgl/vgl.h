@@ -3,8 +3,20 @@
 
 #include "Camera.h"
 #include "Mesh.h"
+#include "MeshArena.h"
 #include "Shader.h"
+#include "Bounds.h"
+#include "SpatialIndex.h"
+#include "MeshOptimize.h"
 #include "OBJMesh.h"
+#include "MeshRegistry.h"
+#include "Trail.h"
+#include "LineBatch.h"
+#include "Colormap.h"
+#include "VectorField.h"
+#include "Heightfield.h"
+#include "ThreadPool.h"
+#include "Isosurface.h"
 #include "GUI.h"
 #include "OrbitalCamera.h"
 
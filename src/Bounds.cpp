@@ -0,0 +1,196 @@
+#include <vgl/Bounds.h>
+#include "Simd.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+
+AABB AABB::transformed(const glm::mat4 &transform) const
+{
+  if (isEmpty())
+    return *this;
+
+  glm::vec3 center = glm::vec3(transform * glm::vec4(getCenter(), 1.0f));
+  glm::vec3 extent = getExtent();
+  glm::vec3 newExtent(0.0f);
+  for (int column = 0; column < 3; ++column)
+    newExtent += glm::abs(glm::vec3(transform[column])) * extent[column];
+
+  AABB result;
+  result.min = center - newExtent;
+  result.max = center + newExtent;
+  return result;
+}
+
+AABB AABB::fromVertices(const Vertex *vertices, size_t count)
+{
+  AABB box;
+#ifdef VGL_HAS_SSE2
+  // One unaligned load takes a position plus the normal's x, which lands in
+  // the unused fourth lane. Two accumulator pairs hide the min/max latency.
+  // The new value goes first: MINPS/MAXPS return their second operand when
+  // either is NaN, which skips NaN positions like the scalar loop does.
+  static_assert(offsetof(Vertex, position) == 0 && sizeof(Vertex) >= 4 * sizeof(float),
+                "the position load reads four floats");
+  __m128 lo0 = _mm_set1_ps(FLT_MAX), lo1 = lo0;
+  __m128 hi0 = _mm_set1_ps(-FLT_MAX), hi1 = hi0;
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2)
+  {
+    __m128 p0 = _mm_loadu_ps(&vertices[i].position.x);
+    __m128 p1 = _mm_loadu_ps(&vertices[i + 1].position.x);
+    lo0 = _mm_min_ps(p0, lo0);
+    hi0 = _mm_max_ps(p0, hi0);
+    lo1 = _mm_min_ps(p1, lo1);
+    hi1 = _mm_max_ps(p1, hi1);
+  }
+  if (i < count)
+  {
+    __m128 p = _mm_loadu_ps(&vertices[i].position.x);
+    lo0 = _mm_min_ps(p, lo0);
+    hi0 = _mm_max_ps(p, hi0);
+  }
+
+  float lo[4], hi[4];
+  _mm_storeu_ps(lo, _mm_min_ps(lo0, lo1));
+  _mm_storeu_ps(hi, _mm_max_ps(hi0, hi1));
+  box.min = glm::vec3(lo[0], lo[1], lo[2]);
+  box.max = glm::vec3(hi[0], hi[1], hi[2]);
+#else
+  // Four independent min/max lanes, merged at the end, so consecutive
+  // vertices do not wait on each other
+  constexpr size_t LANES = 4;
+  float lo[LANES][3];
+  float hi[LANES][3];
+  for (size_t lane = 0; lane < LANES; ++lane)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      lo[lane][axis] = FLT_MAX;
+      hi[lane][axis] = -FLT_MAX;
+    }
+  }
+
+  size_t i = 0;
+  for (; i + LANES <= count; i += LANES)
+  {
+    for (size_t lane = 0; lane < LANES; ++lane)
+    {
+      const glm::vec3 &p = vertices[i + lane].position;
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        lo[lane][axis] = std::min(lo[lane][axis], p[axis]);
+        hi[lane][axis] = std::max(hi[lane][axis], p[axis]);
+      }
+    }
+  }
+  for (; i < count; ++i)
+  {
+    const glm::vec3 &p = vertices[i].position;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      lo[0][axis] = std::min(lo[0][axis], p[axis]);
+      hi[0][axis] = std::max(hi[0][axis], p[axis]);
+    }
+  }
+
+  for (size_t lane = 0; lane < LANES; ++lane)
+  {
+    box.min = glm::min(box.min, glm::vec3(lo[lane][0], lo[lane][1], lo[lane][2]));
+    box.max = glm::max(box.max, glm::vec3(hi[lane][0], hi[lane][1], hi[lane][2]));
+  }
+#endif
+  return box;
+}
+
+BoundingSphere BoundingSphere::transformed(const glm::mat4 &transform) const
+{
+  if (isEmpty())
+    return *this;
+
+  float scale = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])),
+                          glm::length(glm::vec3(transform[2]))});
+  return {glm::vec3(transform * glm::vec4(center, 1.0f)), radius * scale};
+}
+
+BoundingSphere BoundingSphere::fromVertices(const Vertex *vertices, size_t count, const AABB &box)
+{
+  if (count == 0 || box.isEmpty())
+    return {};
+
+  glm::vec3 center = box.getCenter();
+  float radiusSquared = 0.0f;
+  for (size_t i = 0; i < count; ++i)
+  {
+    glm::vec3 offset = vertices[i].position - center;
+    radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+  }
+  return {center, std::sqrt(radiusSquared)};
+}
+
+BoundingSphere BoundingSphere::around(const AABB &box)
+{
+  if (box.isEmpty())
+    return {};
+  return {box.getCenter(), glm::length(box.getExtent())};
+}
+
+Frustum::Frustum(const glm::mat4 &clipFromSpace)
+{
+  // Gribb & Hartmann: each plane is the fourth row plus or minus another
+  // row of the matrix (GL clip space, -w <= x, y, z <= w)
+  glm::vec4 rows[4];
+  for (int r = 0; r < 4; ++r)
+    rows[r] = glm::vec4(clipFromSpace[0][r], clipFromSpace[1][r], clipFromSpace[2][r], clipFromSpace[3][r]);
+
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    m_planes[axis * 2] = rows[3] + rows[axis];
+    m_planes[axis * 2 + 1] = rows[3] - rows[axis];
+  }
+  for (auto &plane : m_planes)
+  {
+    float length = glm::length(glm::vec3(plane));
+    if (length > 0.0f)
+      plane /= length;
+  }
+}
+
+Containment Frustum::test(const AABB &box) const
+{
+  if (box.isEmpty())
+    return Containment::Outside;
+
+  glm::vec3 center = box.getCenter();
+  glm::vec3 extent = box.getExtent();
+  Containment result = Containment::Inside;
+  for (const auto &plane : m_planes)
+  {
+    glm::vec3 normal(plane);
+    float distance = glm::dot(normal, center) + plane.w;
+    // Projection of the box's half size onto the plane normal
+    float reach = glm::dot(extent, glm::abs(normal));
+    if (distance + reach < 0.0f)
+      return Containment::Outside;
+    if (distance - reach < 0.0f)
+      result = Containment::Intersects;
+  }
+  return result;
+}
+
+Containment Frustum::test(const BoundingSphere &sphere) const
+{
+  if (sphere.isEmpty())
+    return Containment::Outside;
+
+  Containment result = Containment::Inside;
+  for (const auto &plane : m_planes)
+  {
+    float distance = glm::dot(glm::vec3(plane), sphere.center) + plane.w;
+    if (distance < -sphere.radius)
+      return Containment::Outside;
+    if (distance < sphere.radius)
+      result = Containment::Intersects;
+  }
+  return result;
+}
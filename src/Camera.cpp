@@ -0,0 +1,259 @@
+#include <vgl/Camera.h>
+#include "Simd.h"
+#include <glm/gtc/matrix_inverse.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Points per block of the portable batched loops. Each block is gathered
+  // into per-component arrays, computed lane by lane, then scattered back.
+  constexpr size_t LANES = 8;
+
+#ifdef VGL_HAS_SSE2
+  static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && sizeof(glm::vec2) == 2 * sizeof(float),
+                "glm vectors are tightly packed");
+
+  // Four packed vec3 (x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3) to one
+  // register per component
+  void loadVec3x4(const glm::vec3 *points, __m128 &x, __m128 &y, __m128 &z)
+  {
+    const float *p = reinterpret_cast<const float *>(points);
+    __m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4), c = _mm_loadu_ps(p + 8);
+    x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+                       _MM_SHUFFLE(2, 0, 2, 0));
+    z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+                       _MM_SHUFFLE(2, 0, 2, 0));
+  }
+
+  // The reverse of loadVec3x4
+  void storeVec3x4(glm::vec3 *out, __m128 x, __m128 y, __m128 z)
+  {
+    float *p = reinterpret_cast<float *>(out);
+    _mm_storeu_ps(p, _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)),
+                                    _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(p + 4, _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)),
+                                        _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(p + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)),
+                                        _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+  }
+#endif
+}
+
+const Camera::MatrixCache &Camera::updateView() const
+{
+  MatrixCache &c = m_cache;
+  if (c.viewValid && c.position == position && c.target == target && c.up == up)
+    return c;
+
+  c.position = position;
+  c.target = target;
+  c.up = up;
+  c.view = glm::lookAt(position, target, up);
+  // A view matrix is a rigid transform, which inverts without a general 4x4 inverse
+  c.inverseView = glm::affineInverse(c.view);
+  c.viewValid = true;
+  c.productValid = false;
+  return c;
+}
+
+const Camera::MatrixCache &Camera::updateProjection(float aspect) const
+{
+  MatrixCache &c = m_cache;
+  if (c.projectionValid && c.fov == fov && c.nearPlane == nearPlane && c.farPlane == farPlane && c.aspect == aspect)
+    return c;
+
+  c.fov = fov;
+  c.nearPlane = nearPlane;
+  c.farPlane = farPlane;
+  c.aspect = aspect;
+  c.projection = glm::perspective(glm::radians(fov), aspect, nearPlane, farPlane);
+  c.inverseProjection = glm::inverse(c.projection);
+  c.projectionValid = true;
+  c.productValid = false;
+  return c;
+}
+
+const Camera::MatrixCache &Camera::updateAll(float aspect) const
+{
+  updateView();
+  MatrixCache &c = m_cache;
+  updateProjection(aspect);
+  if (!c.productValid)
+  {
+    c.viewProjection = c.projection * c.view;
+    c.inverseViewProjection = c.inverseView * c.inverseProjection;
+    c.productValid = true;
+  }
+  return c;
+}
+
+glm::mat4 Camera::getViewMatrix() const
+{
+  return updateView().view;
+}
+
+glm::mat4 Camera::getProjectionMatrix(float aspect) const
+{
+  return updateProjection(aspect).projection;
+}
+
+glm::mat4 Camera::getViewProjectionMatrix(float aspect) const
+{
+  return updateAll(aspect).viewProjection;
+}
+
+glm::mat4 Camera::getInverseViewMatrix() const
+{
+  return updateView().inverseView;
+}
+
+glm::mat4 Camera::getInverseProjectionMatrix(float aspect) const
+{
+  return updateProjection(aspect).inverseProjection;
+}
+
+glm::mat4 Camera::getInverseViewProjectionMatrix(float aspect) const
+{
+  return updateAll(aspect).inverseViewProjection;
+}
+
+void Camera::project(const glm::vec3 *points, size_t count, glm::vec3 *out, glm::vec2 viewport) const
+{
+  if (count == 0 || viewport.x <= 0.0f || viewport.y <= 0.0f)
+    return;
+
+  // Only clip x, y and w are needed. The NDC to pixel scale is folded into
+  // the x and y rows, leaving one divide per point; for a perspective
+  // projection clip w is the depth along the view direction.
+  const glm::mat4 &m = updateAll(viewport.x / viewport.y).viewProjection;
+  glm::vec2 half = viewport * 0.5f;
+  float rows[3][4];
+  for (int col = 0; col < 4; ++col)
+  {
+    rows[0][col] = m[col][0] * half.x;
+    rows[1][col] = -m[col][1] * half.y;
+    rows[2][col] = m[col][3];
+  }
+
+  size_t begin = 0;
+#ifdef VGL_HAS_SSE2
+  // Four points per iteration, the same operations in the same order as
+  // the loop below, so results match it exactly
+  {
+    __m128 r[3][4];
+    for (int row = 0; row < 3; ++row)
+      for (int col = 0; col < 4; ++col)
+        r[row][col] = _mm_set1_ps(rows[row][col]);
+    const __m128 halfX = _mm_set1_ps(half.x), halfY = _mm_set1_ps(half.y), one = _mm_set1_ps(1.0f);
+    for (; begin + 4 <= count; begin += 4)
+    {
+      __m128 x, y, z;
+      loadVec3x4(points + begin, x, y, z);
+      __m128 cx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0][0], x), _mm_mul_ps(r[0][1], y)), _mm_mul_ps(r[0][2], z)), r[0][3]);
+      __m128 cy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r[1][0], x), _mm_mul_ps(r[1][1], y)), _mm_mul_ps(r[1][2], z)), r[1][3]);
+      __m128 cw = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r[2][0], x), _mm_mul_ps(r[2][1], y)), _mm_mul_ps(r[2][2], z)), r[2][3]);
+      __m128 inverseW = _mm_div_ps(one, cw);
+      storeVec3x4(out + begin, _mm_add_ps(_mm_mul_ps(cx, inverseW), halfX), _mm_add_ps(_mm_mul_ps(cy, inverseW), halfY), cw);
+    }
+  }
+#endif
+
+  for (; begin < count; begin += LANES)
+  {
+    size_t n = std::min(LANES, count - begin);
+    float x[LANES] = {}, y[LANES] = {}, z[LANES] = {};
+    for (size_t i = 0; i < n; ++i)
+    {
+      x[i] = points[begin + i].x;
+      y[i] = points[begin + i].y;
+      z[i] = points[begin + i].z;
+    }
+
+    float px[LANES], py[LANES], depth[LANES];
+    for (size_t i = 0; i < LANES; ++i)
+    {
+      float cx = rows[0][0] * x[i] + rows[0][1] * y[i] + rows[0][2] * z[i] + rows[0][3];
+      float cy = rows[1][0] * x[i] + rows[1][1] * y[i] + rows[1][2] * z[i] + rows[1][3];
+      float cw = rows[2][0] * x[i] + rows[2][1] * y[i] + rows[2][2] * z[i] + rows[2][3];
+      float inverseW = 1.0f / cw;
+      px[i] = cx * inverseW + half.x;
+      py[i] = cy * inverseW + half.y;
+      depth[i] = cw;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+      out[begin + i] = glm::vec3(px[i], py[i], depth[i]);
+  }
+}
+
+void Camera::unproject(const glm::vec2 *pixels, size_t count, glm::vec3 *out, glm::vec2 viewport) const
+{
+  if (count == 0 || viewport.x <= 0.0f || viewport.y <= 0.0f)
+    return;
+
+  // The view-space direction through NDC (x, y) is the inverse projection
+  // of (x, y, -1, 1) with its z forced to -1, and NDC is linear in pixels,
+  // so the world-space direction before normalization is a * px + b * py + c
+  const MatrixCache &cache = updateAll(viewport.x / viewport.y);
+  const glm::mat4 &p = cache.inverseProjection;
+  glm::mat3 rotation(cache.inverseView);
+  glm::vec3 dx = rotation * glm::vec3(p[0].x, p[0].y, 0.0f);
+  glm::vec3 dy = rotation * glm::vec3(p[1].x, p[1].y, 0.0f);
+  glm::vec3 origin = rotation * glm::vec3(p[3].x - p[2].x, p[3].y - p[2].y, -1.0f);
+  glm::vec3 a = dx * (2.0f / viewport.x);
+  glm::vec3 b = dy * (-2.0f / viewport.y);
+  glm::vec3 c = origin - dx + dy;
+
+  size_t begin = 0;
+#ifdef VGL_HAS_SSE2
+  // Four rays per iteration, matching the loop below exactly (a true
+  // divide and square root rather than the approximate reciprocals)
+  {
+    const __m128 ax = _mm_set1_ps(a.x), ay = _mm_set1_ps(a.y), az = _mm_set1_ps(a.z);
+    const __m128 bx = _mm_set1_ps(b.x), by = _mm_set1_ps(b.y), bz = _mm_set1_ps(b.z);
+    const __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; begin + 4 <= count; begin += 4)
+    {
+      const float *p = reinterpret_cast<const float *>(pixels + begin);
+      __m128 first = _mm_loadu_ps(p), second = _mm_loadu_ps(p + 4);
+      __m128 px = _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 py = _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1));
+      __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, px), _mm_mul_ps(bx, py)), cx);
+      __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ay, px), _mm_mul_ps(by, py)), cy);
+      __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(az, px), _mm_mul_ps(bz, py)), cz);
+      __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+      __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+      storeVec3x4(out + begin, _mm_mul_ps(x, inverseLength), _mm_mul_ps(y, inverseLength), _mm_mul_ps(z, inverseLength));
+    }
+  }
+#endif
+
+  for (; begin < count; begin += LANES)
+  {
+    size_t n = std::min(LANES, count - begin);
+    float px[LANES] = {}, py[LANES] = {};
+    for (size_t i = 0; i < n; ++i)
+    {
+      px[i] = pixels[begin + i].x;
+      py[i] = pixels[begin + i].y;
+    }
+
+    float rx[LANES], ry[LANES], rz[LANES];
+    for (size_t i = 0; i < LANES; ++i)
+    {
+      float x = a.x * px[i] + b.x * py[i] + c.x;
+      float y = a.y * px[i] + b.y * py[i] + c.y;
+      float z = a.z * px[i] + b.z * py[i] + c.z;
+      float inverseLength = 1.0f / std::sqrt(x * x + y * y + z * z);
+      rx[i] = x * inverseLength;
+      ry[i] = y * inverseLength;
+      rz[i] = z * inverseLength;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+      out[begin + i] = glm::vec3(rx[i], ry[i], rz[i]);
+  }
+}
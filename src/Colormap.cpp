@@ -0,0 +1,105 @@
+#include <vgl/Colormap.h>
+#include <algorithm>
+
+Colormap::~Colormap() { cleanup(); }
+
+Colormap::Colormap(Colormap &&other) noexcept : m_texture(other.m_texture)
+{
+  other.m_texture = 0;
+}
+
+Colormap &Colormap::operator=(Colormap &&other) noexcept
+{
+  if (this != &other)
+  {
+    cleanup();
+    m_texture = other.m_texture;
+    other.m_texture = 0;
+  }
+  return *this;
+}
+
+void Colormap::cleanup()
+{
+  if (m_texture)
+    glDeleteTextures(1, &m_texture);
+  m_texture = 0;
+}
+
+// Polynomial fits of the matplotlib viridis map and Google's Turbo map
+glm::vec3 Colormap::sample(Preset preset, float t)
+{
+  t = glm::clamp(t, 0.0f, 1.0f);
+
+  switch (preset)
+  {
+  case Preset::Viridis:
+  {
+    const glm::vec3 c0(0.2777273272f, 0.0054073445f, 0.3340998053f);
+    const glm::vec3 c1(0.1050930431f, 1.4046135299f, 1.3845901626f);
+    const glm::vec3 c2(-0.3308618287f, 0.2148475595f, 0.0950951630f);
+    const glm::vec3 c3(-4.6342304990f, -5.7991009734f, -19.3324409563f);
+    const glm::vec3 c4(6.2282699363f, 14.1799333668f, 56.6905526007f);
+    const glm::vec3 c5(4.7763849977f, -13.7451453777f, -65.3530326334f);
+    const glm::vec3 c6(-5.4354558559f, 4.6458526122f, 26.3124352496f);
+    glm::vec3 c = c0 + t * (c1 + t * (c2 + t * (c3 + t * (c4 + t * (c5 + t * c6)))));
+    return glm::clamp(c, glm::vec3(0.0f), glm::vec3(1.0f));
+  }
+  case Preset::Turbo:
+  {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    float t4 = t2 * t2;
+    float t5 = t4 * t;
+    glm::vec3 c(
+        0.13572138f + 4.61539260f * t - 42.66032258f * t2 + 132.13108234f * t3 - 152.94239396f * t4 + 59.28637943f * t5,
+        0.09140261f + 2.19418839f * t + 4.84296658f * t2 - 14.18503333f * t3 + 4.27729857f * t4 + 2.82956604f * t5,
+        0.10667330f + 12.64194608f * t - 60.58204836f * t2 + 110.36276771f * t3 - 89.90310912f * t4 + 27.34824973f * t5);
+    return glm::clamp(c, glm::vec3(0.0f), glm::vec3(1.0f));
+  }
+  case Preset::Coolwarm:
+  {
+    const glm::vec3 cool(0.230f, 0.299f, 0.754f);
+    const glm::vec3 neutral(0.865f, 0.865f, 0.865f);
+    const glm::vec3 warm(0.706f, 0.016f, 0.150f);
+    return t < 0.5f ? glm::mix(cool, neutral, t * 2.0f) : glm::mix(neutral, warm, t * 2.0f - 1.0f);
+  }
+  case Preset::Grayscale:
+  default:
+    return glm::vec3(t);
+  }
+}
+
+void Colormap::load(Preset preset, int resolution)
+{
+  resolution = std::max(resolution, 2);
+  std::vector<glm::vec3> colors(resolution);
+  for (int i = 0; i < resolution; ++i)
+  {
+    colors[i] = sample(preset, (float)i / (resolution - 1));
+  }
+  load(colors);
+}
+
+void Colormap::load(const std::vector<glm::vec3> &colors)
+{
+  if (colors.empty())
+    return;
+
+  if (!m_texture)
+    glGenTextures(1, &m_texture);
+
+  glBindTexture(GL_TEXTURE_1D, m_texture);
+  glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB32F, colors.size(), 0, GL_RGB, GL_FLOAT, colors.data());
+  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_1D, 0);
+}
+
+void Colormap::bind(unsigned int unit) const
+{
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_1D, m_texture);
+  glActiveTexture(GL_TEXTURE0);
+}
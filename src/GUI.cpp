@@ -1,8 +1,10 @@
 #include <vgl/GUI.h>
 #include <vgl/EmbeddedShaders.h>
+#include <vgl/ThreadPool.h>
 #include <stdexcept>
 #include <cstdio>
 #include <cmath>
+#include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 
@@ -34,6 +36,13 @@ GUI::GUI(int width, int height, const char *title)
 
   setupCallbacks();
   m_shader.loadFromSource(EmbeddedShaders::defaultVert, EmbeddedShaders::defaultFrag);
+  m_trailShader.loadFromSource(EmbeddedShaders::trailVert, EmbeddedShaders::trailFrag);
+  m_lineShader.loadFromSource(EmbeddedShaders::lineVert, EmbeddedShaders::colorFrag);
+  m_arrowHeadShader.loadFromSource(EmbeddedShaders::arrowHeadVert, EmbeddedShaders::colorFrag);
+  m_vectorFieldShader.loadFromSource(EmbeddedShaders::vectorFieldVert, EmbeddedShaders::litColorFrag);
+  m_heightfieldShader.loadFromSource(EmbeddedShaders::heightfieldVert, EmbeddedShaders::litColorFrag);
+  m_objShader.loadFromSource(EmbeddedShaders::objVert, EmbeddedShaders::objFrag);
+  m_defaultColormap.load(Colormap::Preset::Viridis);
   initMeshes();
 }
 
@@ -89,20 +98,37 @@ void GUI::beginFrame()
 {
   glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  m_uploadBudgetLeft = m_uploadBudget;
+  m_frustum = Frustum(camera.getViewProjectionMatrix(getAspect()));
+  m_frameCullStats = OBJCullStats{};
+
+  for (const Shader *shader : {&m_trailShader, &m_lineShader, &m_arrowHeadShader, &m_vectorFieldShader, &m_heightfieldShader, &m_objShader})
+  {
+    shader->use();
+    applyFrameUniforms(*shader);
+  }
 
   m_shader.use();
+  applyFrameUniforms(m_shader);
+}
 
+void GUI::applyFrameUniforms(const Shader &shader)
+{
   float aspect = (float)m_framebufferWidth / m_framebufferHeight;
-  m_shader.setMat4("view", camera.getViewMatrix());
-  m_shader.setMat4("projection", camera.getProjectionMatrix(aspect));
-  m_shader.setBool("useLighting", m_useLighting);
-  m_shader.setVec3("lightDir", m_lightDir);
-  m_shader.setVec3("viewPos", camera.position);
-  m_shader.setFloat("logDepthFarPlane", m_logDepthFarPlane);
+  shader.setMat4("view", camera.getViewMatrix());
+  shader.setMat4("projection", camera.getProjectionMatrix(aspect));
+  shader.setFloat("logDepthFarPlane", m_logDepthFarPlane);
+  shader.setBool("useLighting", m_useLighting);
+  shader.setVec3("lightDir", m_lightDir);
+  shader.setVec3("viewPos", camera.position);
 }
 
 void GUI::endFrame()
 {
+  queueStaticOBJMeshes();
+  flushOBJMeshes();
+  m_cullStats = m_frameCullStats;
+  flushLines();
   glfwSwapBuffers(m_window);
 
   // Clear per-frame input state before polling new events
@@ -173,70 +199,110 @@ void GUI::drawRect(glm::vec3 pos, float width, float height, glm::quat rotation,
 
 void GUI::drawLine(glm::vec3 start, glm::vec3 end, glm::vec3 color, float width)
 {
-  std::vector<glm::vec3> points = {start, end};
-  m_lineMesh.uploadLines(points);
-
-  glLineWidth(width);
-  m_shader.setBool("useLighting", false);
-  setupDraw(glm::mat4(1.0f), color);
-  m_lineMesh.drawLines();
-  m_shader.setBool("useLighting", m_useLighting);
+  m_lineBatch.addLine(start, end, color, width);
 }
 
 void GUI::drawArrow(glm::vec3 start, glm::vec3 end, glm::vec3 color, float width)
 {
-  glm::vec3 dir = end - start;
-  float length = glm::length(dir);
-  if (length <= 0.0001f)
+  m_lineBatch.addArrow(start, end, color, width);
+}
+
+void GUI::drawArrows(const std::vector<glm::vec3> &starts, const std::vector<glm::vec3> &ends, glm::vec3 color, float width)
+{
+  size_t count = std::min(starts.size(), ends.size());
+  m_lineBatch.reserve(0, count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    m_lineBatch.addArrow(starts[i], ends[i], color, width);
+  }
+}
+
+void GUI::flushLines()
+{
+  if (!m_lineBatch.hasLines() && !m_lineBatch.hasArrowHeads())
     return;
 
-  float headLength = length / 10.0f;
-  float headRadius = headLength / 3.0f;
+  m_lineBatch.upload();
 
-  glm::vec3 dirNorm = glm::normalize(dir);
+  m_lineShader.use();
+  m_lineShader.setVec2("viewportSize", glm::vec2(m_framebufferWidth, m_framebufferHeight));
+  m_lineBatch.drawLines();
 
-  // Clamp head length
-  headLength = glm::min(headLength, length * 0.5f);
+  m_arrowHeadShader.use();
+  m_lineBatch.drawArrowHeads();
 
-  glm::vec3 shaftEnd = end - dirNorm * headLength;
+  m_lineBatch.clear();
+  m_shader.use();
+}
+
+void GUI::drawTrail(const Trail &trail, glm::vec3 color, float fade)
+{
+  m_trailShader.use();
+  m_trailShader.setInt("trailHead", trail.getHead());
+  m_trailShader.setInt("trailCapacity", trail.capacity());
+  m_trailShader.setInt("trailCount", trail.size());
+  m_trailShader.setVec3("color", color);
+  m_trailShader.setFloat("fade", glm::clamp(fade, 0.0f, 1.0f));
+  trail.draw();
+  m_shader.use();
+}
 
-  // Draw shaft
-  drawLine(start, shaftEnd, color, width);
+void GUI::drawVectorField(const VectorField &field)
+{
+  drawVectorField(field, m_defaultColormap);
+}
 
-  // Build orthonormal basis for cone
-  glm::vec3 b1, b2;
-  if (std::abs(dirNorm.x) < 0.9f)
-    b1 = glm::normalize(glm::cross(dirNorm, glm::vec3(1, 0, 0)));
-  else
-    b1 = glm::normalize(glm::cross(dirNorm, glm::vec3(0, 1, 0)));
-  b2 = glm::cross(dirNorm, b1);
+void GUI::drawVectorField(const VectorField &field, const Colormap &colormap)
+{
+  if (!field.isUploaded())
+    return;
 
-  // Draw cone edges
-  std::vector<glm::vec3> coneLines;
-  int coneSegments = 12;
-  for (int i = 0; i < coneSegments; ++i)
-  {
-    float a0 = (float)i / coneSegments * glm::two_pi<float>();
-    float a1 = (float)(i + 1) / coneSegments * glm::two_pi<float>();
+  m_vectorFieldShader.use();
+  m_vectorFieldShader.setIVec3("gridDims", field.getDims());
+  m_vectorFieldShader.setVec3("gridOrigin", field.getOrigin());
+  m_vectorFieldShader.setVec3("gridSpacing", field.getSpacing());
+  m_vectorFieldShader.setFloat("glyphScale", field.getScale());
+  m_vectorFieldShader.setFloat("glyphMaxLength", field.getMaxLength());
+  m_vectorFieldShader.setFloat("glyphWidth", field.getGlyphWidth());
+  m_vectorFieldShader.setFloat("glyphMinMagnitude", field.getMinMagnitude());
+  m_vectorFieldShader.setVec2("colorRange", glm::vec2(field.getRangeMin(), field.getRangeMax()));
+  m_vectorFieldShader.setInt("colormap", 0);
+  colormap.bind(0);
+  field.draw();
+  m_shader.use();
+}
 
-    glm::vec3 p0 = shaftEnd + (std::cos(a0) * b1 + std::sin(a0) * b2) * headRadius;
-    glm::vec3 p1 = shaftEnd + (std::cos(a1) * b1 + std::sin(a1) * b2) * headRadius;
+void GUI::drawHeightfield(Heightfield &field, glm::vec3 color)
+{
+  drawHeightfield(field, nullptr, color, glm::vec2(0.0f, 1.0f));
+}
 
-    // Circle edge
-    coneLines.push_back(p0);
-    coneLines.push_back(p1);
+void GUI::drawHeightfield(Heightfield &field, const Colormap &colormap, float minHeight, float maxHeight)
+{
+  drawHeightfield(field, &colormap, glm::vec3(1.0f), glm::vec2(minHeight, maxHeight));
+}
 
-    // Side edge to tip
-    coneLines.push_back(p0);
-    coneLines.push_back(end);
-  }
+void GUI::drawHeightfield(Heightfield &field, const Colormap *colormap, glm::vec3 color, glm::vec2 colorRange)
+{
+  if (!field.isUploaded())
+    return;
 
-  m_lineMesh.uploadLines(coneLines);
-  glLineWidth(width);
-  m_shader.setBool("useLighting", false);
-  setupDraw(glm::mat4(1.0f), color);
-  m_lineMesh.drawLines();
-  m_shader.setBool("useLighting", m_useLighting);
+  m_heightfieldShader.use();
+  m_heightfieldShader.setIVec2("fieldSize", field.getSize());
+  m_heightfieldShader.setVec3("fieldOrigin", field.getOrigin());
+  m_heightfieldShader.setVec2("fieldSpacing", field.getSpacing());
+  m_heightfieldShader.setFloat("heightScale", field.getHeightScale());
+  m_heightfieldShader.setFloat("skirtDepth", field.getSkirtDepth());
+  m_heightfieldShader.setInt("chunkVerts", Heightfield::CHUNK_SIZE + 1);
+  m_heightfieldShader.setVec3("color", color);
+  m_heightfieldShader.setBool("useColormap", colormap != nullptr);
+  m_heightfieldShader.setVec2("colorRange", colorRange);
+  m_heightfieldShader.setInt("colormap", 0);
+  m_heightfieldShader.setInt("heights", 1);
+  (colormap ? *colormap : m_defaultColormap).bind(0);
+  field.bindHeights(1);
+  field.draw(camera.position);
+  m_shader.use();
 }
 
 void GUI::drawSphere(glm::vec3 pos, float radius, glm::vec3 color)
@@ -356,18 +422,10 @@ void GUI::drawOBJMesh(OBJMesh &mesh, glm::vec3 pos, glm::vec3 scale)
 
 void GUI::drawOBJMesh(OBJMesh &mesh, glm::vec3 pos, glm::vec3 scale, glm::quat rotation)
 {
-  if (!mesh.isLoaded())
-    return;
-
   glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
   model = model * glm::mat4_cast(rotation);
   model = glm::scale(model, scale);
-
-  for (const auto &subMesh : mesh.getSubMeshes())
-  {
-    setupDraw(model, subMesh.material.diffuse);
-    subMesh.mesh.draw();
-  }
+  drawOBJMesh(mesh, model, nullptr);
 }
 
 void GUI::drawOBJMesh(OBJMesh &mesh, glm::vec3 pos, float scale, glm::vec3 color)
@@ -387,18 +445,385 @@ void GUI::drawOBJMesh(OBJMesh &mesh, glm::vec3 pos, glm::vec3 scale, glm::vec3 c
 
 void GUI::drawOBJMesh(OBJMesh &mesh, glm::vec3 pos, glm::vec3 scale, glm::quat rotation, glm::vec3 color)
 {
-  if (!mesh.isLoaded())
-    return;
-
   glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
   model = model * glm::mat4_cast(rotation);
   model = glm::scale(model, scale);
+  drawOBJMesh(mesh, model, &color);
+}
+
+void GUI::drawOBJMesh(OBJMesh &mesh, const glm::mat4 &model, const glm::vec3 *color)
+{
+  OBJInstance instance;
+  instance.transform = model;
+  instance.color = color ? glm::vec4(*color, 1.0f) : glm::vec4(0.0f);
+  queueOBJInstance(mesh, instance);
+}
+
+void GUI::queueOBJInstance(OBJMesh &mesh, const OBJInstance &instance)
+{
+  uploadPending(mesh);
+  if (!mesh.isLoaded())
+    return;
 
-  for (const auto &subMesh : mesh.getSubMeshes())
+  // Queued per mesh; every copy drawn this frame goes out in one instanced
+  // draw per submesh at endFrame
+  auto [it, inserted] = m_objBatchIndex.try_emplace(&mesh, m_objBatchCount);
+  if (inserted)
   {
-    setupDraw(model, color);
-    subMesh.mesh.draw();
+    if (m_objBatchCount == m_objBatches.size())
+      m_objBatches.emplace_back();
+    m_objBatches[m_objBatchCount].mesh = &mesh;
+    m_objBatches[m_objBatchCount].instances.clear();
+    ++m_objBatchCount;
   }
+  m_objBatches[it->second].instances.push_back(instance);
+}
+
+void GUI::drawOBJMeshInstanced(OBJMesh &mesh, const glm::mat4 *transforms, const glm::vec3 *colors, size_t count)
+{
+  uploadPending(mesh);
+  if (!mesh.isLoaded() || count == 0)
+    return;
+
+  // Earlier drawOBJMesh calls go out first, keeping the call order
+  flushOBJMeshes();
+  m_instanceScratch.resize(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    m_instanceScratch[i].transform = transforms[i];
+    m_instanceScratch[i].color = colors ? glm::vec4(colors[i], 1.0f) : glm::vec4(0.0f);
+  }
+  drawOBJInstances(mesh, m_instanceScratch.data(), count);
+}
+
+void GUI::drawOBJMeshInstanced(OBJMesh &mesh, const std::vector<glm::mat4> &transforms, const std::vector<glm::vec3> &colors)
+{
+  drawOBJMeshInstanced(mesh, transforms.data(), colors.size() >= transforms.size() ? colors.data() : nullptr,
+                       transforms.size());
+}
+
+void GUI::drawOBJMeshScalars(OBJMesh &mesh, const glm::mat4 &transform, float minValue, float maxValue)
+{
+  drawOBJMeshScalars(mesh, transform, m_defaultColormap, minValue, maxValue);
+}
+
+void GUI::drawOBJMeshScalars(OBJMesh &mesh, const glm::mat4 &transform, const Colormap &colormap, float minValue,
+                             float maxValue)
+{
+  uploadPending(mesh);
+  if (!mesh.isLoaded() || !mesh.hasScalars())
+    return;
+
+  flushOBJMeshes();
+  OBJInstance instance;
+  instance.transform = transform;
+  instance.color = glm::vec4(0.0f);
+  drawOBJInstances(mesh, &instance, 1, &colormap, glm::vec2(minValue, maxValue));
+}
+
+SpatialIndex::Handle GUI::addStaticOBJMesh(OBJMesh &mesh, const glm::mat4 &transform)
+{
+  SpatialIndex::Handle handle;
+  addStaticOBJMeshes(mesh, &transform, nullptr, 1, &handle);
+  return handle;
+}
+
+SpatialIndex::Handle GUI::addStaticOBJMesh(OBJMesh &mesh, const glm::mat4 &transform, glm::vec3 color)
+{
+  SpatialIndex::Handle handle;
+  addStaticOBJMeshes(mesh, &transform, &color, 1, &handle);
+  return handle;
+}
+
+void GUI::addStaticOBJMeshes(OBJMesh &mesh, const glm::mat4 *transforms, const glm::vec3 *colors, size_t count,
+                             SpatialIndex::Handle *handles)
+{
+  if (count == 0)
+    return;
+
+  // Empty while the mesh is still loading; such instances wait in
+  // m_staticPending
+  const AABB &meshBounds = mesh.getBounds();
+  m_staticBounds.resize(count);
+  constexpr size_t CHUNK = 16384;
+  ThreadPool::shared().parallelFor((count + CHUNK - 1) / CHUNK, [&](size_t c)
+  {
+    size_t end = std::min(count, (c + 1) * CHUNK);
+    for (size_t i = c * CHUNK; i < end; ++i)
+      m_staticBounds[i] = meshBounds.transformed(transforms[i]);
+  });
+
+  std::vector<SpatialIndex::Handle> created;
+  if (!handles)
+  {
+    created.resize(count);
+    handles = created.data();
+  }
+  m_staticIndex.insert(m_staticBounds.data(), count, handles);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    SpatialIndex::Handle handle = handles[i];
+    if (handle >= m_staticInstances.size())
+      m_staticInstances.resize(handle + 1);
+    StaticInstance &instance = m_staticInstances[handle];
+    instance.mesh = &mesh;
+    instance.instance.transform = transforms[i];
+    instance.instance.color = colors ? glm::vec4(colors[i], 1.0f) : glm::vec4(0.0f);
+    if (meshBounds.isEmpty())
+      addStaticPending(mesh, handle);
+  }
+}
+
+void GUI::moveStaticOBJMesh(SpatialIndex::Handle handle, const glm::mat4 &transform)
+{
+  StaticInstance &instance = m_staticInstances[handle];
+  instance.instance.transform = transform;
+  AABB bounds = instance.mesh->getBounds().transformed(transform);
+  m_staticIndex.move(handle, bounds);
+  if (bounds.isEmpty())
+    addStaticPending(*instance.mesh, handle);
+}
+
+void GUI::removeStaticOBJMesh(SpatialIndex::Handle handle)
+{
+  m_staticIndex.remove(handle);
+  m_staticInstances[handle].mesh = nullptr;
+}
+
+void GUI::clearStaticOBJMeshes()
+{
+  m_staticIndex.clear();
+  m_staticInstances.clear();
+  m_staticPending.clear();
+  m_staticPendingCount = 0;
+}
+
+void GUI::addStaticPending(OBJMesh &mesh, SpatialIndex::Handle handle)
+{
+  auto it = std::find_if(m_staticPending.begin(), m_staticPending.end(),
+                         [&](const StaticPending &pending) { return pending.mesh == &mesh; });
+  if (it == m_staticPending.end())
+    it = m_staticPending.insert(m_staticPending.end(), StaticPending{&mesh, {}});
+  it->handles.push_back(handle);
+  ++m_staticPendingCount;
+}
+
+void GUI::queueStaticOBJMeshes()
+{
+  // Pending instances enter the index together once their mesh's bounds
+  // are known, so a large group takes the index's parallel rebuild. Each
+  // frame only looks at the meshes, not at every pending instance. Entries
+  // of removed (or since re-added) handles are just dropped, as are all of
+  // a mesh's if its load failed.
+  for (size_t p = 0; p < m_staticPending.size();)
+  {
+    OBJMesh &mesh = *m_staticPending[p].mesh;
+    uploadPending(mesh);
+    const AABB &meshBounds = mesh.getBounds();
+    bool failed = !mesh.isLoading() && !mesh.isLoaded();
+    if (meshBounds.isEmpty() && !failed)
+    {
+      ++p;
+      continue;
+    }
+
+    std::vector<SpatialIndex::Handle> &handles = m_staticPending[p].handles;
+    m_staticPendingCount -= handles.size();
+    if (!meshBounds.isEmpty())
+    {
+      size_t count = 0;
+      m_staticBounds.resize(handles.size());
+      for (SpatialIndex::Handle handle : handles)
+      {
+        if (m_staticIndex.contains(handle) && m_staticInstances[handle].mesh == &mesh &&
+            m_staticIndex.getBounds(handle).isEmpty())
+        {
+          m_staticBounds[count] = meshBounds.transformed(m_staticInstances[handle].instance.transform);
+          handles[count++] = handle;
+        }
+      }
+      m_staticIndex.move(handles.data(), m_staticBounds.data(), count);
+    }
+    m_staticPending[p] = std::move(m_staticPending.back());
+    m_staticPending.pop_back();
+  }
+
+  if (m_staticIndex.size() == 0)
+    return;
+  m_staticVisible.clear();
+  float maxDistance = m_staticDrawDistance > 0.0f ? m_staticDrawDistance : FLT_MAX;
+  if (m_frustumCulling)
+    m_staticIndex.queryFrustum(m_frustum, camera.position, maxDistance, m_staticVisible);
+  else
+    m_staticIndex.queryRadius(camera.position, maxDistance, m_staticVisible);
+
+  for (SpatialIndex::Handle handle : m_staticVisible)
+    queueOBJInstance(*m_staticInstances[handle].mesh, m_staticInstances[handle].instance);
+
+  size_t placed = m_staticIndex.size() - std::min(m_staticIndex.size(), m_staticPendingCount);
+  m_frameCullStats.staticInstancesCulled += placed - std::min(placed, m_staticVisible.size());
+}
+
+void GUI::uploadPending(OBJMesh &mesh)
+{
+  // Asynchronous loads stream in while the mesh is being drawn
+  if (mesh.isLoading())
+    m_uploadBudgetLeft -= mesh.uploadPending(m_uploadBudgetLeft);
+}
+
+void GUI::drawOBJInstances(OBJMesh &mesh, const OBJInstance *instances, size_t count, const Colormap *colormap,
+                           glm::vec2 colorRange)
+{
+  // Units: materials 0, colormap 1, diffuse texture arrays from 2. Every
+  // sampler gets its own unit even when unused, since samplers of different
+  // types on one unit fail the draw.
+  m_objShader.use();
+  m_objShader.setInt("materials", 0);
+  mesh.bindMaterials(0);
+  m_objShader.setInt("colormap", 1);
+  for (size_t i = 0; i < OBJMesh::MAX_TEXTURE_ARRAYS; ++i)
+    m_objShader.setInt("diffuseMaps[" + std::to_string(i) + "]", 2 + static_cast<int>(i));
+  mesh.bindTextures(2);
+  m_objShader.setBool("useColormap", colormap != nullptr);
+  if (colormap)
+  {
+    m_objShader.setVec2("colorRange", colorRange);
+    colormap->bind(1);
+  }
+  GLint materialIndexLocation = glGetUniformLocation(m_objShader.getID(), "materialIndex");
+
+  const std::vector<SubMesh> &subMeshes = mesh.getSubMeshes();
+  size_t ready = mesh.getReadySubMeshCount();
+  size_t levels = m_lodThreshold > 0.0f ? mesh.getLODCount() : 1;
+  std::vector<size_t> levelTriangles(levels, 0);
+  for (size_t level = 0; level < levels; ++level)
+  {
+    for (size_t s = 0; s < ready; ++s)
+      levelTriangles[level] += subMeshes[s].getLevel(static_cast<unsigned int>(level)).indexCount / 3;
+  }
+
+  // Per instance: cull against the frustum, then pick a level from the
+  // projected diameter of the bounding sphere. Whole instances are then
+  // drawn with one instanced draw per level.
+  constexpr unsigned int CULLED = ~0u;
+  float pixelsPerRadian = m_framebufferHeight / (2.0f * std::tan(glm::radians(camera.fov) * 0.5f));
+  std::vector<size_t> levelStart(levels + 1, 0);
+  m_lodLevels.resize(count);
+  m_partialInstances.clear();
+  m_subMeshMasks.clear();
+  OBJCullStats &stats = m_frameCullStats;
+  for (size_t i = 0; i < count; ++i)
+  {
+    const glm::mat4 &transform = instances[i].transform;
+    BoundingSphere sphere = mesh.getBoundingSphere().transformed(transform);
+
+    // From inside the sphere the mesh fills the view
+    unsigned int level = 0;
+    float distance = glm::length(sphere.center - camera.position);
+    if (levels > 1 && distance > sphere.radius)
+      level = mesh.selectLOD(2.0f * sphere.radius / distance * pixelsPerRadian, m_lodThreshold);
+
+    Containment containment = m_frustumCulling ? m_frustum.test(sphere) : Containment::Inside;
+    if (containment == Containment::Intersects)
+      containment = m_frustum.test(mesh.getBounds().transformed(transform));
+
+    if (containment == Containment::Intersects)
+    {
+      // Crosses the frustum edge: decide per submesh
+      size_t maskOffset = m_subMeshMasks.size();
+      size_t visible = 0;
+      for (size_t s = 0; s < ready; ++s)
+      {
+        const SubMesh &subMesh = subMeshes[s];
+        Containment part = m_frustum.test(subMesh.sphere.transformed(transform));
+        if (part == Containment::Intersects)
+          part = m_frustum.test(subMesh.bounds.transformed(transform));
+        bool inside = part != Containment::Outside;
+        m_subMeshMasks.push_back(inside);
+        visible += inside;
+      }
+
+      if (visible < ready)
+      {
+        for (size_t s = 0; s < ready; ++s)
+        {
+          size_t triangles = subMeshes[s].getLevel(level).indexCount / 3;
+          if (m_subMeshMasks[maskOffset + s])
+          {
+            ++stats.subMeshesDrawn;
+            stats.trianglesDrawn += triangles;
+          }
+          else
+          {
+            ++stats.subMeshesCulled;
+            stats.trianglesCulled += triangles;
+          }
+        }
+        if (visible > 0)
+          m_partialInstances.push_back({i, maskOffset, level});
+        else
+          m_subMeshMasks.resize(maskOffset);
+        m_lodLevels[i] = CULLED;
+        continue;
+      }
+      m_subMeshMasks.resize(maskOffset);
+    }
+    else if (containment == Containment::Outside)
+    {
+      stats.subMeshesCulled += ready;
+      stats.trianglesCulled += levelTriangles[level];
+      m_lodLevels[i] = CULLED;
+      continue;
+    }
+
+    stats.subMeshesDrawn += ready;
+    stats.trianglesDrawn += levelTriangles[level];
+    m_lodLevels[i] = level;
+    ++levelStart[level + 1];
+  }
+  for (size_t level = 0; level < levels; ++level)
+    levelStart[level + 1] += levelStart[level];
+
+  // Whole instances grouped by level, then the partial ones, all uploaded
+  // at once; each draw then takes its range of the buffer
+  const size_t partialStart = levelStart[levels];
+  m_lodInstances.resize(partialStart + m_partialInstances.size());
+  std::vector<size_t> next(levelStart.begin(), levelStart.end() - 1);
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (m_lodLevels[i] != CULLED)
+      m_lodInstances[next[m_lodLevels[i]]++] = instances[i];
+  }
+  for (size_t p = 0; p < m_partialInstances.size(); ++p)
+    m_lodInstances[partialStart + p] = instances[m_partialInstances[p].instance];
+
+  if (!m_lodInstances.empty() && ready > 0)
+  {
+    mesh.uploadInstances(m_lodInstances.data(), m_lodInstances.size());
+    for (size_t level = 0; level < levels; ++level)
+    {
+      size_t levelCount = levelStart[level + 1] - levelStart[level];
+      if (levelCount > 0)
+        mesh.drawInstanceRange(levelStart[level], levelCount, materialIndexLocation, static_cast<unsigned int>(level));
+    }
+    for (size_t p = 0; p < m_partialInstances.size(); ++p)
+    {
+      const PartialInstance &partial = m_partialInstances[p];
+      mesh.drawInstanceRange(partialStart + p, 1, materialIndexLocation, partial.level,
+                             &m_subMeshMasks[partial.maskOffset]);
+    }
+  }
+  m_shader.use();
+}
+
+void GUI::flushOBJMeshes()
+{
+  for (size_t i = 0; i < m_objBatchCount; ++i)
+    drawOBJInstances(*m_objBatches[i].mesh, m_objBatches[i].instances.data(), m_objBatches[i].instances.size());
+
+  m_objBatchIndex.clear();
+  m_objBatchCount = 0;
 }
 
 // --- Callbacks ---
@@ -521,17 +946,9 @@ glm::vec2 GUI::getScrollDelta() const
 
 glm::vec3 GUI::getMouseRay(glm::vec2 mousePos) const
 {
-  float x = (2.0f * mousePos.x) / m_windowWidth - 1.0f;
-  float y = 1.0f - (2.0f * mousePos.y) / m_windowHeight;
-
-  glm::mat4 projectionMatrix = camera.getProjectionMatrix((float)m_windowWidth / m_windowHeight);
-  glm::mat4 viewMatrix = camera.getViewMatrix();
-
-  glm::vec4 rayClip = glm::vec4(x, y, -1.0f, 1.0f);
-  glm::vec4 rayView = glm::inverse(projectionMatrix) * rayClip;
-
-  // Turn into direction
-  rayView = glm::vec4(rayView.x, rayView.y, -1.0f, 0.0f);
-  glm::vec3 rayWorld = glm::normalize(glm::vec3(glm::inverse(viewMatrix) * rayView));
-  return rayWorld;
+  // A minimized window has no viewport to unproject against
+  glm::vec3 ray = camera.getDirection();
+  if (m_windowWidth > 0 && m_windowHeight > 0)
+    camera.unproject(&mousePos, 1, &ray, glm::vec2(m_windowWidth, m_windowHeight));
+  return ray;
 }
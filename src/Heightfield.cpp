@@ -0,0 +1,298 @@
+#include <vgl/Heightfield.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+// Chunk vertices are virtual: the shader maps gl_VertexID to a grid coordinate
+// inside the chunk, so the only buffers are the shared index buffer and the
+// per-frame list of chunk origins. Ids at or above (CHUNK_SIZE + 1)^2 are
+// skirt copies of the border vertices, pushed down by the skirt depth.
+
+static constexpr int CHUNK_VERTS = Heightfield::CHUNK_SIZE + 1;
+static constexpr unsigned int SKIRT_OFFSET = CHUNK_VERTS * CHUNK_VERTS;
+
+Heightfield::~Heightfield() { cleanup(); }
+
+Heightfield::Heightfield(Heightfield &&other) noexcept
+    : m_texture(other.m_texture), m_vao(other.m_vao), m_ebo(other.m_ebo), m_instanceVbo(other.m_instanceVbo),
+      m_lods(std::move(other.m_lods)), m_chunksPerLOD(std::move(other.m_chunksPerLOD)),
+      m_instanceData(std::move(other.m_instanceData)), m_size(other.m_size), m_textureSize(other.m_textureSize),
+      m_origin(other.m_origin), m_spacing(other.m_spacing), m_heightScale(other.m_heightScale),
+      m_lodDistance(other.m_lodDistance), m_skirtDepth(other.m_skirtDepth),
+      m_lodDistanceSet(other.m_lodDistanceSet), m_skirtDepthSet(other.m_skirtDepthSet),
+      m_error(std::move(other.m_error))
+{
+  other.m_texture = other.m_vao = other.m_ebo = other.m_instanceVbo = 0;
+  other.m_textureSize = glm::ivec2(0);
+}
+
+Heightfield &Heightfield::operator=(Heightfield &&other) noexcept
+{
+  if (this != &other)
+  {
+    cleanup();
+    m_texture = other.m_texture;
+    m_vao = other.m_vao;
+    m_ebo = other.m_ebo;
+    m_instanceVbo = other.m_instanceVbo;
+    m_lods = std::move(other.m_lods);
+    m_chunksPerLOD = std::move(other.m_chunksPerLOD);
+    m_instanceData = std::move(other.m_instanceData);
+    m_size = other.m_size;
+    m_textureSize = other.m_textureSize;
+    m_origin = other.m_origin;
+    m_spacing = other.m_spacing;
+    m_heightScale = other.m_heightScale;
+    m_lodDistance = other.m_lodDistance;
+    m_skirtDepth = other.m_skirtDepth;
+    m_lodDistanceSet = other.m_lodDistanceSet;
+    m_skirtDepthSet = other.m_skirtDepthSet;
+    m_error = std::move(other.m_error);
+    other.m_texture = other.m_vao = other.m_ebo = other.m_instanceVbo = 0;
+    other.m_textureSize = glm::ivec2(0);
+  }
+  return *this;
+}
+
+void Heightfield::cleanup()
+{
+  if (m_texture)
+    glDeleteTextures(1, &m_texture);
+  if (m_vao)
+    glDeleteVertexArrays(1, &m_vao);
+  if (m_ebo)
+    glDeleteBuffers(1, &m_ebo);
+  if (m_instanceVbo)
+    glDeleteBuffers(1, &m_instanceVbo);
+  m_texture = m_vao = m_ebo = m_instanceVbo = 0;
+  m_textureSize = glm::ivec2(0);
+}
+
+Heightfield &Heightfield::setGrid(glm::ivec2 size, glm::vec3 origin, glm::vec2 spacing)
+{
+  m_size = glm::max(size, glm::ivec2(2));
+  m_origin = origin;
+  m_spacing = spacing;
+
+  // Defaults follow the grid until the caller picks a value
+  float chunkExtent = CHUNK_SIZE * std::max(spacing.x, spacing.y);
+  if (!m_lodDistanceSet)
+    m_lodDistance = (m_size.x > 4096 || m_size.y > 4096) ? 4.0f * chunkExtent : 0.0f;
+  if (!m_skirtDepthSet)
+    m_skirtDepth = 0.05f * chunkExtent;
+  return *this;
+}
+
+void Heightfield::buildChunkIndices(std::vector<unsigned int> &indices)
+{
+  auto vertexId = [](int x, int z)
+  { return static_cast<unsigned int>(z * CHUNK_VERTS + x); };
+
+  m_lods.clear();
+  for (int step = 1; step <= CHUNK_SIZE; step *= 2)
+  {
+    LODRange lod;
+    lod.indexOffset = indices.size();
+
+    for (int z = 0; z < CHUNK_SIZE; z += step)
+    {
+      for (int x = 0; x < CHUNK_SIZE; x += step)
+      {
+        unsigned int a = vertexId(x, z);
+        unsigned int b = vertexId(x + step, z);
+        unsigned int c = vertexId(x, z + step);
+        unsigned int d = vertexId(x + step, z + step);
+
+        indices.push_back(a);
+        indices.push_back(c);
+        indices.push_back(b);
+
+        indices.push_back(b);
+        indices.push_back(c);
+        indices.push_back(d);
+      }
+    }
+
+    // Skirts along the four chunk borders
+    for (int i = 0; i < CHUNK_SIZE; i += step)
+    {
+      unsigned int edges[4][2] = {
+          {vertexId(i, 0), vertexId(i + step, 0)},
+          {vertexId(i, CHUNK_SIZE), vertexId(i + step, CHUNK_SIZE)},
+          {vertexId(0, i), vertexId(0, i + step)},
+          {vertexId(CHUNK_SIZE, i), vertexId(CHUNK_SIZE, i + step)}};
+
+      for (auto &edge : edges)
+      {
+        indices.push_back(edge[0]);
+        indices.push_back(edge[1]);
+        indices.push_back(edge[1] + SKIRT_OFFSET);
+
+        indices.push_back(edge[0]);
+        indices.push_back(edge[1] + SKIRT_OFFSET);
+        indices.push_back(edge[0] + SKIRT_OFFSET);
+      }
+    }
+
+    lod.indexCount = indices.size() - lod.indexOffset;
+    m_lods.push_back(lod);
+  }
+}
+
+void Heightfield::init()
+{
+  std::vector<unsigned int> indices;
+  buildChunkIndices(indices);
+  m_chunksPerLOD.resize(m_lods.size());
+
+  glGenVertexArrays(1, &m_vao);
+  glGenBuffers(1, &m_ebo);
+  glGenBuffers(1, &m_instanceVbo);
+
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+  glVertexAttribIPointer(0, 2, GL_INT, sizeof(glm::ivec2), (void *)0);
+  glEnableVertexAttribArray(0);
+  glVertexAttribDivisor(0, 1);
+  glBindVertexArray(0);
+
+  glGenTextures(1, &m_texture);
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool Heightfield::update(const std::vector<float> &heights)
+{
+  if (heights.size() < static_cast<size_t>(m_size.x) * m_size.y)
+  {
+    m_error = "Expected " + std::to_string(static_cast<size_t>(m_size.x) * m_size.y) + " heights, got " +
+              std::to_string(heights.size());
+    return false;
+  }
+  return update(heights.data());
+}
+
+bool Heightfield::update(const float *heights)
+{
+  if (m_textureSize != m_size)
+  {
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (m_size.x > maxSize || m_size.y > maxSize)
+    {
+      m_error = "Heightfield grid " + std::to_string(m_size.x) + "x" + std::to_string(m_size.y) +
+                " exceeds GL_MAX_TEXTURE_SIZE (" + std::to_string(maxSize) + ")";
+      return false;
+    }
+  }
+  m_error.clear();
+
+  if (!m_texture)
+    init();
+
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+  if (m_textureSize != m_size)
+  {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, m_size.x, m_size.y, 0, GL_RED, GL_FLOAT, heights);
+    m_textureSize = m_size;
+  }
+  else
+  {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_size.x, m_size.y, GL_RED, GL_FLOAT, heights);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return true;
+}
+
+void Heightfield::updateRegion(int x, int y, int width, int height, const float *heights, int rowStride)
+{
+  // The texture must have been allocated by a full update first
+  if (!m_texture || m_textureSize != m_size)
+    return;
+
+  // Clip to the grid, advancing the source pointer past any clipped rows/columns
+  int stride = rowStride > 0 ? rowStride : width;
+  int x0 = std::max(x, 0);
+  int y0 = std::max(y, 0);
+  int x1 = std::min(x + width, m_size.x);
+  int y1 = std::min(y + height, m_size.y);
+  if (x1 <= x0 || y1 <= y0)
+    return;
+  heights += static_cast<size_t>(y0 - y) * stride + (x0 - x);
+
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, x1 - x0, y1 - y0, GL_RED, GL_FLOAT, heights);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Heightfield::bindHeights(unsigned int unit) const
+{
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void Heightfield::draw(glm::vec3 cameraPos)
+{
+  if (!m_texture || m_textureSize != m_size)
+    return;
+
+  int chunksX = std::max(1, (m_size.x - 2) / CHUNK_SIZE + 1);
+  int chunksZ = std::max(1, (m_size.y - 2) / CHUNK_SIZE + 1);
+  int maxLevel = static_cast<int>(m_lods.size()) - 1;
+  glm::vec2 chunkExtent = glm::vec2(CHUNK_SIZE) * m_spacing;
+
+  for (auto &chunks : m_chunksPerLOD)
+    chunks.clear();
+
+  for (int cz = 0; cz < chunksZ; ++cz)
+  {
+    for (int cx = 0; cx < chunksX; ++cx)
+    {
+      int level = 0;
+      if (m_lodDistance > 0.0f)
+      {
+        // Distance from the camera to the chunk's footprint on the base plane
+        glm::vec2 lo = glm::vec2(m_origin.x, m_origin.z) + glm::vec2(cx, cz) * chunkExtent;
+        glm::vec2 hi = lo + chunkExtent;
+        glm::vec2 cam(cameraPos.x, cameraPos.z);
+        glm::vec2 d = glm::max(glm::max(lo - cam, cam - hi), glm::vec2(0.0f));
+        float dist = glm::length(glm::vec3(d.x, cameraPos.y - m_origin.y, d.y));
+
+        if (dist > m_lodDistance)
+          level = std::min(maxLevel, 1 + static_cast<int>(std::log2(dist / m_lodDistance)));
+      }
+      m_chunksPerLOD[level].push_back(glm::ivec2(cx, cz) * CHUNK_SIZE);
+    }
+  }
+
+  m_instanceData.clear();
+  for (const auto &chunks : m_chunksPerLOD)
+    m_instanceData.insert(m_instanceData.end(), chunks.begin(), chunks.end());
+
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+  glBufferData(GL_ARRAY_BUFFER, m_instanceData.size() * sizeof(glm::ivec2), m_instanceData.data(), GL_STREAM_DRAW);
+
+  size_t first = 0;
+  for (size_t level = 0; level < m_lods.size(); ++level)
+  {
+    size_t count = m_chunksPerLOD[level].size();
+    if (count == 0)
+      continue;
+
+    glVertexAttribIPointer(0, 2, GL_INT, sizeof(glm::ivec2), (void *)(first * sizeof(glm::ivec2)));
+    glDrawElementsInstanced(GL_TRIANGLES, m_lods[level].indexCount, GL_UNSIGNED_INT,
+                            (void *)(m_lods[level].indexOffset * sizeof(unsigned int)), count);
+    first += count;
+  }
+  glBindVertexArray(0);
+}
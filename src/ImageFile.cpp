@@ -0,0 +1,333 @@
+#include "ImageFile.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+  uint16_t readU16(const unsigned char *p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+  uint32_t readU32(const unsigned char *p)
+  {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+  }
+
+  bool validSize(int width, int height)
+  {
+    return width > 0 && height > 0 && width <= ImageFile::MAX_SIDE && height <= ImageFile::MAX_SIDE;
+  }
+
+  void allocate(ImageFile::Image &image, int width, int height)
+  {
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(static_cast<size_t>(width) * height * 4, 255);
+  }
+
+  // Pixel (x, y) of a file whose rows are stored top to bottom or bottom to top
+  unsigned char *target(ImageFile::Image &image, int x, int y, bool topDown)
+  {
+    int row = topDown ? image.height - 1 - y : y;
+    return &image.pixels[(static_cast<size_t>(row) * image.width + x) * 4];
+  }
+
+  // Stores one pixel of `channels` bytes: 1 = gray, 3 = BGR, 4 = BGRA
+  void storeBGR(unsigned char *out, const unsigned char *in, int channels)
+  {
+    if (channels == 1)
+    {
+      out[0] = out[1] = out[2] = in[0];
+      return;
+    }
+    out[0] = in[2];
+    out[1] = in[1];
+    out[2] = in[0];
+    if (channels == 4)
+      out[3] = in[3];
+  }
+
+  bool readTGA(const unsigned char *data, size_t size, ImageFile::Image &image, std::string &error)
+  {
+    if (size < 18)
+    {
+      error = "truncated TGA header";
+      return false;
+    }
+    int idLength = data[0];
+    int colorMapType = data[1];
+    int imageType = data[2];
+    size_t colorMapBytes = colorMapType ? readU16(data + 5) * ((data[7] + 7) / 8) : 0;
+    int width = readU16(data + 12);
+    int height = readU16(data + 14);
+    int bits = data[16];
+    bool topDown = (data[17] & 0x20) != 0;
+
+    bool rle = imageType == 10 || imageType == 11;
+    bool gray = imageType == 3 || imageType == 11;
+    if (imageType != 2 && imageType != 3 && !rle)
+    {
+      error = "unsupported TGA type " + std::to_string(imageType);
+      return false;
+    }
+    int channels = bits / 8;
+    if ((gray && bits != 8) || (!gray && bits != 24 && bits != 32))
+    {
+      error = "unsupported TGA depth " + std::to_string(bits);
+      return false;
+    }
+    if (!validSize(width, height))
+    {
+      error = "invalid TGA size";
+      return false;
+    }
+
+    size_t pos = 18 + idLength + colorMapBytes;
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    if (!rle && (pos > size || pixelCount * channels > size - pos))
+    {
+      error = "truncated TGA data";
+      return false;
+    }
+
+    allocate(image, width, height);
+    size_t done = 0;
+    while (done < pixelCount)
+    {
+      // A raw image is one long raw packet
+      size_t run = pixelCount - done;
+      bool repeat = false;
+      if (rle)
+      {
+        if (pos >= size)
+          break;
+        unsigned char packet = data[pos++];
+        run = std::min<size_t>((packet & 0x7F) + 1, pixelCount - done);
+        repeat = (packet & 0x80) != 0;
+      }
+      size_t bytes = repeat ? channels : run * channels;
+      if (pos > size || bytes > size - pos)
+        break;
+      for (size_t i = 0; i < run; ++i, ++done)
+      {
+        int x = static_cast<int>(done % width);
+        int y = static_cast<int>(done / width);
+        storeBGR(target(image, x, y, topDown), data + pos + (repeat ? 0 : i * channels), channels);
+      }
+      pos += bytes;
+    }
+    if (done < pixelCount)
+    {
+      image = ImageFile::Image{};
+      error = "truncated TGA data";
+      return false;
+    }
+    return true;
+  }
+
+  bool readBMP(const unsigned char *data, size_t size, ImageFile::Image &image, std::string &error)
+  {
+    if (size < 54)
+    {
+      error = "truncated BMP header";
+      return false;
+    }
+    uint32_t dataOffset = readU32(data + 10);
+    int32_t width = static_cast<int32_t>(readU32(data + 18));
+    int32_t height = static_cast<int32_t>(readU32(data + 22));
+    int bits = readU16(data + 28);
+    uint32_t compression = readU32(data + 30);
+
+    // BITFIELDS is accepted for 32 bit with the usual BGRA masks
+    if (compression != 0 && !(compression == 3 && bits == 32))
+    {
+      error = "unsupported BMP compression " + std::to_string(compression);
+      return false;
+    }
+    if (bits != 24 && bits != 32)
+    {
+      error = "unsupported BMP depth " + std::to_string(bits);
+      return false;
+    }
+    // Negative height: rows stored top to bottom
+    bool topDown = height < 0;
+    height = topDown ? -height : height;
+    if (!validSize(width, height))
+    {
+      error = "invalid BMP size";
+      return false;
+    }
+
+    int channels = bits / 8;
+    size_t stride = (static_cast<size_t>(width) * channels + 3) & ~size_t(3);
+    if (dataOffset > size || stride * height > size - dataOffset)
+    {
+      error = "truncated BMP data";
+      return false;
+    }
+
+    // The fourth byte of uncompressed 32-bit pixels is unused, not alpha
+    bool hasAlpha = compression == 3;
+    allocate(image, width, height);
+    for (int y = 0; y < height; ++y)
+    {
+      const unsigned char *row = data + dataOffset + y * stride;
+      for (int x = 0; x < width; ++x)
+        storeBGR(target(image, x, y, topDown), row + x * channels, hasAlpha ? 4 : 3);
+    }
+    return true;
+  }
+
+  // Next header field of a PNM file, skipping whitespace and comments
+  bool readPNMNumber(const unsigned char *data, size_t size, size_t &pos, int &value)
+  {
+    while (pos < size)
+    {
+      if (data[pos] == '#')
+      {
+        while (pos < size && data[pos] != '\n')
+          ++pos;
+      }
+      else if (std::isspace(data[pos]))
+      {
+        ++pos;
+      }
+      else
+      {
+        break;
+      }
+    }
+    value = 0;
+    size_t start = pos;
+    while (pos < size && data[pos] >= '0' && data[pos] <= '9' && value <= ImageFile::MAX_SIDE)
+      value = value * 10 + (data[pos++] - '0');
+    return pos > start;
+  }
+
+  bool readPNM(const unsigned char *data, size_t size, ImageFile::Image &image, std::string &error)
+  {
+    bool gray = data[1] == '5';
+    size_t pos = 2;
+    int width, height, maxValue;
+    if (!readPNMNumber(data, size, pos, width) || !readPNMNumber(data, size, pos, height) ||
+        !readPNMNumber(data, size, pos, maxValue))
+    {
+      error = "truncated PNM header";
+      return false;
+    }
+    if (maxValue <= 0 || maxValue > 255)
+    {
+      error = "unsupported PNM depth (16 bit)";
+      return false;
+    }
+    if (!validSize(width, height))
+    {
+      error = "invalid PNM size";
+      return false;
+    }
+
+    // A single whitespace byte separates the header from the pixels
+    ++pos;
+    int channels = gray ? 1 : 3;
+    size_t bytes = static_cast<size_t>(width) * height * channels;
+    if (pos > size || bytes > size - pos)
+    {
+      error = "truncated PNM data";
+      return false;
+    }
+
+    allocate(image, width, height);
+    const unsigned char *in = data + pos;
+    for (int y = 0; y < height; ++y)
+    {
+      for (int x = 0; x < width; ++x, in += channels)
+      {
+        unsigned char *out = target(image, x, y, true);
+        for (int c = 0; c < 3; ++c)
+          out[c] = static_cast<unsigned char>(in[gray ? 0 : c] * 255 / maxValue);
+      }
+    }
+    return true;
+  }
+
+  bool hasExtension(const std::string &path, const char *extension)
+  {
+    size_t length = std::strlen(extension);
+    if (path.size() < length)
+      return false;
+    return std::equal(path.end() - length, path.end(), extension,
+                      [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+  }
+}
+
+bool ImageFile::read(const std::string &path, Image &image, std::string &error)
+{
+  image = Image{};
+  MappedFile file;
+  if (!file.open(path))
+  {
+    error = path + ": cannot open file";
+    return false;
+  }
+
+  // TGA has no signature, so it is recognized by extension after the others
+  const unsigned char *data = reinterpret_cast<const unsigned char *>(file.data());
+  size_t size = file.size();
+  bool ok = false;
+  if (size >= 2 && data[0] == 'B' && data[1] == 'M')
+    ok = readBMP(data, size, image, error);
+  else if (size >= 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6'))
+    ok = readPNM(data, size, image, error);
+  else if (hasExtension(path, ".tga"))
+    ok = readTGA(data, size, image, error);
+  else if (size >= 8 && std::memcmp(data, "\x89PNG", 4) == 0)
+    ok = readPNG(data, size, image, error);
+  else if (size >= 2 && data[0] == 0xFF && data[1] == 0xD8)
+    ok = readJPEG(data, size, image, error);
+  else
+    error = "unknown image format";
+
+  if (!ok)
+    error = path + ": " + error;
+  return ok;
+}
+
+ImageFile::Image ImageFile::resized(const Image &image, int width, int height)
+{
+  Image result;
+  allocate(result, width, height);
+  if (image.pixels.empty())
+    return result;
+
+  // Sample positions at pixel centers, clamped to the edge texels
+  float scaleX = static_cast<float>(image.width) / width;
+  float scaleY = static_cast<float>(image.height) / height;
+  for (int y = 0; y < height; ++y)
+  {
+    float sy = std::max(0.0f, (y + 0.5f) * scaleY - 0.5f);
+    int y0 = std::min(static_cast<int>(sy), image.height - 1);
+    int y1 = std::min(y0 + 1, image.height - 1);
+    float fy = sy - y0;
+    for (int x = 0; x < width; ++x)
+    {
+      float sx = std::max(0.0f, (x + 0.5f) * scaleX - 0.5f);
+      int x0 = std::min(static_cast<int>(sx), image.width - 1);
+      int x1 = std::min(x0 + 1, image.width - 1);
+      float fx = sx - x0;
+      const unsigned char *p00 = &image.pixels[(static_cast<size_t>(y0) * image.width + x0) * 4];
+      const unsigned char *p10 = &image.pixels[(static_cast<size_t>(y0) * image.width + x1) * 4];
+      const unsigned char *p01 = &image.pixels[(static_cast<size_t>(y1) * image.width + x0) * 4];
+      const unsigned char *p11 = &image.pixels[(static_cast<size_t>(y1) * image.width + x1) * 4];
+      unsigned char *out = &result.pixels[(static_cast<size_t>(y) * width + x) * 4];
+      for (int c = 0; c < 4; ++c)
+      {
+        float top = p00[c] + (p10[c] - p00[c]) * fx;
+        float bottom = p01[c] + (p11[c] - p01[c]) * fx;
+        out[c] = static_cast<unsigned char>(top + (bottom - top) * fy + 0.5f);
+      }
+    }
+  }
+  return result;
+}
@@ -0,0 +1,39 @@
+#ifndef IMAGEFILE_H
+#define IMAGEFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Decoders for the image formats textures commonly come in: PNG and JPEG
+// (through libpng and libjpeg), TGA (raw or RLE, 8/24/32 bit), BMP (24/32
+// bit, uncompressed) and binary PPM/PGM. Internal to the library.
+// Thread-safe; decodes run on workers.
+namespace ImageFile
+{
+  // RGBA8, rows bottom to top (the order glTexImage expects, so v = 0 of
+  // an OBJ texture coordinate is the bottom row)
+  struct Image
+  {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+  };
+
+  // Larger sides are far beyond any GL texture limit and most likely a corrupt header
+  constexpr int MAX_SIDE = 1 << 15;
+
+  // On failure image is left empty and error says why
+  bool read(const std::string &path, Image &image, std::string &error);
+
+  // libpng and libjpeg behind read(), for data already in memory. Kept in
+  // ImageFilePNG.cpp and ImageFileJPEG.cpp so their headers (and their
+  // setjmp error handling) stay out of the other readers.
+  bool readPNG(const unsigned char *data, size_t size, Image &image, std::string &error);
+  bool readJPEG(const unsigned char *data, size_t size, Image &image, std::string &error);
+
+  // Bilinear resize, e.g. to fit an image into a texture array of another size
+  Image resized(const Image &image, int width, int height);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include "ImageFile.h"
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+
+namespace
+{
+  // libjpeg reports fatal errors through error_exit, which must not return
+  struct ErrorManager
+  {
+    jpeg_error_mgr manager;
+    std::jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+  };
+
+  void onError(j_common_ptr info)
+  {
+    ErrorManager *errors = reinterpret_cast<ErrorManager *>(info->err);
+    errors->manager.format_message(info, errors->message);
+    std::longjmp(errors->jump, 1);
+  }
+
+  // Warnings (e.g. premature end of data) would go to stderr; the image
+  // still decodes, with the missing part gray
+  void onMessage(j_common_ptr, int) {}
+
+  // Expands a row of `channels` (1 or 3) bytes per pixel in place to RGBA,
+  // back to front so no pixel is overwritten before it is read
+  void expandRow(unsigned char *row, int width, int channels)
+  {
+    for (int x = width - 1; x >= 0; --x)
+    {
+      const unsigned char *in = row + x * channels;
+      unsigned char r = in[0];
+      unsigned char g = channels == 3 ? in[1] : r;
+      unsigned char b = channels == 3 ? in[2] : r;
+      unsigned char *out = row + x * 4;
+      out[0] = r;
+      out[1] = g;
+      out[2] = b;
+      out[3] = 255;
+    }
+  }
+}
+
+bool ImageFile::readJPEG(const unsigned char *data, size_t size, Image &image, std::string &error)
+{
+  jpeg_decompress_struct info;
+  ErrorManager errors;
+  info.err = jpeg_std_error(&errors.manager);
+  errors.manager.error_exit = onError;
+  errors.manager.emit_message = onMessage;
+
+  // Errors land here. Nothing created after this point may need a
+  // destructor, since longjmp skips them; pixels go straight into image.
+  if (setjmp(errors.jump))
+  {
+    jpeg_destroy_decompress(&info);
+    image = Image{};
+    error = errors.message;
+    return false;
+  }
+
+  jpeg_create_decompress(&info);
+  jpeg_mem_src(&info, data, static_cast<unsigned long>(size));
+  jpeg_read_header(&info, TRUE);
+  if (info.image_width > static_cast<JDIMENSION>(MAX_SIDE) || info.image_height > static_cast<JDIMENSION>(MAX_SIDE))
+  {
+    jpeg_destroy_decompress(&info);
+    error = "invalid JPEG size";
+    return false;
+  }
+  if (info.jpeg_color_space == JCS_CMYK || info.jpeg_color_space == JCS_YCCK)
+  {
+    jpeg_destroy_decompress(&info);
+    error = "CMYK JPEG is not supported";
+    return false;
+  }
+
+  info.out_color_space = info.jpeg_color_space == JCS_GRAYSCALE ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg_start_decompress(&info);
+  int width = static_cast<int>(info.output_width);
+  int height = static_cast<int>(info.output_height);
+  int channels = info.output_components;
+  image.width = width;
+  image.height = height;
+  image.pixels.assign(static_cast<size_t>(width) * height * 4, 255);
+
+  // Each scanline is decoded into the start of its RGBA row (rows bottom
+  // to top), then widened in place
+  while (info.output_scanline < info.output_height)
+  {
+    unsigned char *row = &image.pixels[static_cast<size_t>(height - 1 - info.output_scanline) * width * 4];
+    jpeg_read_scanlines(&info, &row, 1);
+    expandRow(row, width, channels);
+  }
+  jpeg_finish_decompress(&info);
+  jpeg_destroy_decompress(&info);
+  return true;
+}
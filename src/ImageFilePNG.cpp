@@ -0,0 +1,85 @@
+#include "ImageFile.h"
+#include <cstring>
+#include <png.h>
+
+namespace
+{
+  struct Source
+  {
+    const unsigned char *data;
+    size_t size;
+    size_t position;
+  };
+
+  void readData(png_structp png, png_bytep out, png_size_t length)
+  {
+    Source *source = static_cast<Source *>(png_get_io_ptr(png));
+    if (length > source->size - source->position)
+      png_error(png, "truncated PNG file");
+    std::memcpy(out, source->data + source->position, length);
+    source->position += length;
+  }
+
+  // libpng reports fatal errors through this, which must not return; the
+  // message goes to the buffer given as the error pointer
+  void onError(png_structp png, png_const_charp message)
+  {
+    char *buffer = static_cast<char *>(png_get_error_ptr(png));
+    std::strncpy(buffer, message, 127);
+    buffer[127] = '\0';
+    png_longjmp(png, 1);
+  }
+
+  void onWarning(png_structp, png_const_charp) {}
+}
+
+bool ImageFile::readPNG(const unsigned char *data, size_t size, Image &image, std::string &error)
+{
+  char message[128] = "corrupt PNG file";
+  png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, message, onError, onWarning);
+  png_infop info = png ? png_create_info_struct(png) : nullptr;
+  if (!info)
+  {
+    png_destroy_read_struct(&png, nullptr, nullptr);
+    error = "out of memory";
+    return false;
+  }
+
+  // Errors land here. Nothing created after this point may need a
+  // destructor, since longjmp skips them; pixels go straight into image.
+  if (setjmp(png_jmpbuf(png)))
+  {
+    png_destroy_read_struct(&png, &info, nullptr);
+    image = Image{};
+    error = message;
+    return false;
+  }
+
+  Source source{data, size, 0};
+  png_set_read_fn(png, &source, readData);
+  png_set_user_limits(png, MAX_SIDE, MAX_SIDE);
+  png_read_info(png, info);
+
+  // Any color type and depth to 8-bit RGBA: palettes and low bit depths
+  // expanded, tRNS to alpha, 16-bit samples keep their high byte (no gamma
+  // or color conversion)
+  png_set_expand(png);
+  png_set_strip_16(png);
+  png_set_gray_to_rgb(png);
+  png_set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
+  int passes = png_set_interlace_handling(png);
+  png_read_update_info(png, info);
+
+  int width = static_cast<int>(png_get_image_width(png, info));
+  int height = static_cast<int>(png_get_image_height(png, info));
+  image.width = width;
+  image.height = height;
+  image.pixels.assign(static_cast<size_t>(width) * height * 4, 255);
+  // Rows bottom to top; interlaced passes fill in the same rows
+  for (int pass = 0; pass < passes; ++pass)
+    for (int y = 0; y < height; ++y)
+      png_read_row(png, &image.pixels[static_cast<size_t>(height - 1 - y) * width * 4], nullptr);
+  png_read_end(png, nullptr);
+  png_destroy_read_struct(&png, &info, nullptr);
+  return true;
+}
@@ -0,0 +1,131 @@
+#include <vgl/LineBatch.h>
+#include <vgl/Mesh.h>
+
+LineBatch::~LineBatch()
+{
+  if (m_lineVao)
+    glDeleteVertexArrays(1, &m_lineVao);
+  if (m_coneVao)
+    glDeleteVertexArrays(1, &m_coneVao);
+
+  GLuint buffers[] = {m_lineVbo, m_coneVbo, m_coneEbo, m_coneInstanceVbo};
+  for (GLuint buffer : buffers)
+  {
+    if (buffer)
+      glDeleteBuffers(1, &buffer);
+  }
+}
+
+void LineBatch::init()
+{
+  // Segments: no per-vertex data, the quad corner comes from gl_VertexID
+  glGenVertexArrays(1, &m_lineVao);
+  glGenBuffers(1, &m_lineVbo);
+
+  glBindVertexArray(m_lineVao);
+  glBindBuffer(GL_ARRAY_BUFFER, m_lineVbo);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(LineInstance), (void *)offsetof(LineInstance, start));
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(LineInstance), (void *)offsetof(LineInstance, end));
+  glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(LineInstance), (void *)offsetof(LineInstance, color));
+  glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(LineInstance), (void *)offsetof(LineInstance, width));
+  for (GLuint i = 0; i < 4; ++i)
+  {
+    glEnableVertexAttribArray(i);
+    glVertexAttribDivisor(i, 1);
+  }
+
+  // Arrowheads: shared cone geometry plus per-instance placement
+  std::vector<Vertex> vertices;
+  std::vector<unsigned int> indices;
+  MeshGen::cone(vertices, indices, 12);
+  m_coneIndexCount = indices.size();
+
+  glGenVertexArrays(1, &m_coneVao);
+  glGenBuffers(1, &m_coneVbo);
+  glGenBuffers(1, &m_coneEbo);
+  glGenBuffers(1, &m_coneInstanceVbo);
+
+  glBindVertexArray(m_coneVao);
+  glBindBuffer(GL_ARRAY_BUFFER, m_coneVbo);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_coneEbo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
+  glEnableVertexAttribArray(0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_coneInstanceVbo);
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(ConeInstance), (void *)offsetof(ConeInstance, base));
+  glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(ConeInstance), (void *)offsetof(ConeInstance, axis));
+  glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(ConeInstance), (void *)offsetof(ConeInstance, color));
+  glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(ConeInstance), (void *)offsetof(ConeInstance, radius));
+  for (GLuint i = 3; i < 7; ++i)
+  {
+    glEnableVertexAttribArray(i);
+    glVertexAttribDivisor(i, 1);
+  }
+  glBindVertexArray(0);
+}
+
+void LineBatch::addLine(glm::vec3 start, glm::vec3 end, glm::vec3 color, float width)
+{
+  m_lines.push_back({start, end, color, width});
+}
+
+void LineBatch::addArrow(glm::vec3 start, glm::vec3 end, glm::vec3 color, float width)
+{
+  glm::vec3 dir = end - start;
+  float length = glm::length(dir);
+  if (length <= 0.0001f)
+    return;
+
+  float headLength = length / 10.0f;
+  float headRadius = headLength / 3.0f;
+  glm::vec3 shaftEnd = end - dir * (headLength / length);
+
+  m_lines.push_back({start, shaftEnd, color, width});
+  m_cones.push_back({shaftEnd, end - shaftEnd, color, headRadius});
+}
+
+void LineBatch::reserve(size_t lines, size_t arrows)
+{
+  m_lines.reserve(m_lines.size() + lines + arrows);
+  m_cones.reserve(m_cones.size() + arrows);
+}
+
+void LineBatch::upload()
+{
+  if (m_lines.empty() && m_cones.empty())
+    return;
+  if (!m_lineVao)
+    init();
+
+  // Respecifying the whole store each frame lets the driver orphan the old one
+  glBindBuffer(GL_ARRAY_BUFFER, m_lineVbo);
+  glBufferData(GL_ARRAY_BUFFER, m_lines.size() * sizeof(LineInstance), m_lines.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, m_coneInstanceVbo);
+  glBufferData(GL_ARRAY_BUFFER, m_cones.size() * sizeof(ConeInstance), m_cones.data(), GL_STREAM_DRAW);
+}
+
+void LineBatch::drawLines() const
+{
+  if (!m_lineVao || m_lines.empty())
+    return;
+  glBindVertexArray(m_lineVao);
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_lines.size());
+  glBindVertexArray(0);
+}
+
+void LineBatch::drawArrowHeads() const
+{
+  if (!m_coneVao || m_cones.empty())
+    return;
+  glBindVertexArray(m_coneVao);
+  glDrawElementsInstanced(GL_TRIANGLES, m_coneIndexCount, GL_UNSIGNED_INT, 0, m_cones.size());
+  glBindVertexArray(0);
+}
+
+void LineBatch::clear()
+{
+  m_lines.clear();
+  m_cones.clear();
+}
@@ -0,0 +1,81 @@
+#include "MappedFile.h"
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define VGL_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const std::string &path)
+{
+  close();
+
+#ifdef VGL_HAS_MMAP
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  m_size = static_cast<size_t>(st.st_size);
+  if (m_size > 0)
+  {
+    void *addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED)
+    {
+      madvise(addr, m_size, MADV_SEQUENTIAL);
+      m_data = static_cast<const char *>(addr);
+      m_mapped = true;
+    }
+  }
+  ::close(fd);
+
+  if (m_mapped || m_size == 0)
+  {
+    m_open = true;
+    return true;
+  }
+#endif
+
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open())
+    return false;
+
+  m_size = static_cast<size_t>(file.tellg());
+  m_buffer.resize(m_size);
+  file.seekg(0);
+  if (m_size > 0 && !file.read(m_buffer.data(), m_size))
+  {
+    m_buffer.clear();
+    m_size = 0;
+    return false;
+  }
+
+  m_data = m_buffer.data();
+  m_open = true;
+  return true;
+}
+
+void MappedFile::close()
+{
+#ifdef VGL_HAS_MMAP
+  if (m_mapped)
+    munmap(const_cast<char *>(m_data), m_size);
+#endif
+  m_buffer.clear();
+  m_buffer.shrink_to_fit();
+  m_data = nullptr;
+  m_size = 0;
+  m_open = false;
+  m_mapped = false;
+}
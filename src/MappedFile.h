@@ -0,0 +1,34 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. Uses mmap where available and falls back
+// to a single bulk read elsewhere. Internal to the library.
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool open(const std::string &path);
+  void close();
+
+  const char *data() const { return m_data; }
+  size_t size() const { return m_size; }
+  bool isOpen() const { return m_open; }
+
+private:
+  const char *m_data = nullptr;
+  size_t m_size = 0;
+  bool m_open = false;
+  bool m_mapped = false;
+  std::vector<char> m_buffer;
+};
+
+#endif
@@ -1,5 +1,9 @@
 #include <vgl/Mesh.h>
+#include <vgl/MeshArena.h>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <utility>
 
 constexpr float PI = 3.14159265359f;
 
@@ -10,10 +14,18 @@ Mesh::~Mesh() { cleanup(); }
 Mesh::Mesh(Mesh &&other) noexcept
     : m_vao(other.m_vao), m_vbo(other.m_vbo), m_ebo(other.m_ebo),
       m_indexCount(other.m_indexCount), m_vertexCount(other.m_vertexCount),
-      m_isLineMode(other.m_isLineMode)
+      m_vertexCapacity(other.m_vertexCapacity), m_indexCapacity(other.m_indexCapacity),
+      m_isLineMode(other.m_isLineMode), m_copies(std::move(other.m_copies)),
+      m_currentCopy(other.m_currentCopy), m_arena(other.m_arena), m_arenaHandle(other.m_arenaHandle),
+      m_scalarBuffer(other.m_scalarBuffer), m_scalarCapacity(other.m_scalarCapacity)
 {
   other.m_vao = other.m_vbo = other.m_ebo = 0;
   other.m_indexCount = other.m_vertexCount = 0;
+  other.m_vertexCapacity = other.m_indexCapacity = 0;
+  other.m_copies.clear();
+  other.m_arena = nullptr;
+  other.m_scalarBuffer = 0;
+  other.m_scalarCapacity = 0;
 }
 
 Mesh &Mesh::operator=(Mesh &&other) noexcept
@@ -26,9 +38,22 @@ Mesh &Mesh::operator=(Mesh &&other) noexcept
     m_ebo = other.m_ebo;
     m_indexCount = other.m_indexCount;
     m_vertexCount = other.m_vertexCount;
+    m_vertexCapacity = other.m_vertexCapacity;
+    m_indexCapacity = other.m_indexCapacity;
     m_isLineMode = other.m_isLineMode;
+    m_copies = std::move(other.m_copies);
+    m_currentCopy = other.m_currentCopy;
+    m_arena = other.m_arena;
+    m_arenaHandle = other.m_arenaHandle;
+    m_scalarBuffer = other.m_scalarBuffer;
+    m_scalarCapacity = other.m_scalarCapacity;
     other.m_vao = other.m_vbo = other.m_ebo = 0;
     other.m_indexCount = other.m_vertexCount = 0;
+    other.m_vertexCapacity = other.m_indexCapacity = 0;
+    other.m_copies.clear();
+    other.m_arena = nullptr;
+    other.m_scalarBuffer = 0;
+    other.m_scalarCapacity = 0;
   }
   return *this;
 }
@@ -41,7 +66,23 @@ void Mesh::cleanup()
     glDeleteBuffers(1, &m_vbo);
   if (m_ebo)
     glDeleteBuffers(1, &m_ebo);
+  for (auto &copy : m_copies)
+  {
+    glDeleteBuffers(1, &copy.positionBuffer);
+    glDeleteBuffers(1, &copy.vertexBuffer);
+    if (copy.fence)
+      glDeleteSync(copy.fence);
+  }
+  m_copies.clear();
+  if (m_arena)
+    m_arena->release(m_arenaHandle);
+  m_arena = nullptr;
+  if (m_scalarBuffer)
+    glDeleteBuffers(1, &m_scalarBuffer);
+  m_scalarBuffer = 0;
+  m_scalarCapacity = 0;
   m_vao = m_vbo = m_ebo = 0;
+  m_vertexCapacity = m_indexCapacity = 0;
 }
 
 void Mesh::setupAttributes()
@@ -55,10 +96,17 @@ void Mesh::setupAttributes()
 }
 
 void Mesh::upload(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+{
+  upload(vertices.data(), vertices.size(), indices.data(), indices.size());
+}
+
+void Mesh::upload(const Vertex *vertices, size_t vertexCount, const unsigned int *indices, size_t indexCount)
 {
   cleanup();
   m_isLineMode = false;
-  m_indexCount = indices.size();
+  m_indexCount = indexCount;
+  m_vertexCapacity = vertexCount;
+  m_indexCapacity = indexCount;
 
   glGenVertexArrays(1, &m_vao);
   glGenBuffers(1, &m_vbo);
@@ -66,11 +114,532 @@ void Mesh::upload(const std::vector<Vertex> &vertices, const std::vector<unsigne
 
   glBindVertexArray(m_vao);
   glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+  setupAttributes();
+  glBindVertexArray(0);
+}
+
+void Mesh::update(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+{
+  update(vertices.data(), vertices.size(), indices.data(), indices.size());
+}
+
+void Mesh::update(const Vertex *vertices, size_t vertexCount, const unsigned int *indices, size_t indexCount)
+{
+  if (m_arena)
+  {
+    if (vertexCount > m_vertexCapacity || indexCount > m_indexCapacity)
+      upload(*m_arena, vertices, vertexCount, indices, indexCount);
+    else
+      m_arena->write(m_arenaHandle, 0, vertices, vertexCount, 0, indices, indexCount);
+    m_indexCount = indexCount;
+    return;
+  }
+
+  if (!m_vao || m_isLineMode || isDynamic())
+  {
+    cleanup();
+    m_isLineMode = false;
+
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vbo);
+    glGenBuffers(1, &m_ebo);
+
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    setupAttributes();
+  }
+  else
+  {
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  }
+
+  if (vertexCount > m_vertexCapacity)
+  {
+    m_vertexCapacity = std::max(vertexCount, m_vertexCapacity + m_vertexCapacity / 2);
+    glBufferData(GL_ARRAY_BUFFER, m_vertexCapacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+  }
+  if (indexCount > m_indexCapacity)
+  {
+    m_indexCapacity = std::max(indexCount, m_indexCapacity + m_indexCapacity / 2);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexCapacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+  }
+
+  glBufferSubData(GL_ARRAY_BUFFER, 0, vertexCount * sizeof(Vertex), vertices);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexCount * sizeof(unsigned int), indices);
+  glBindVertexArray(0);
+
+  m_indexCount = indexCount;
+}
+
+void Mesh::allocate(size_t vertexCount, size_t indexCount)
+{
+  upload(nullptr, vertexCount, nullptr, indexCount);
+}
+
+void Mesh::upload(MeshArena &arena, const Vertex *vertices, size_t vertexCount, const unsigned int *indices,
+                  size_t indexCount)
+{
+  cleanup();
+  m_isLineMode = false;
+  m_indexCount = indexCount;
+  m_vertexCapacity = vertexCount;
+  m_indexCapacity = indexCount;
+
+  m_arena = &arena;
+  m_arenaHandle = arena.allocate(vertexCount, indexCount);
+  arena.write(m_arenaHandle, 0, vertices, vertexCount, 0, indices, indexCount);
+}
+
+void Mesh::allocate(MeshArena &arena, size_t vertexCount, size_t indexCount)
+{
+  upload(arena, nullptr, vertexCount, nullptr, indexCount);
+}
+
+void Mesh::uploadRange(size_t firstVertex, const Vertex *vertices, size_t vertexCount,
+                       size_t firstIndex, const unsigned int *indices, size_t indexCount)
+{
+  if (m_arena)
+  {
+    m_arena->write(m_arenaHandle, firstVertex, vertices, vertexCount, firstIndex, indices, indexCount);
+    return;
+  }
+  if (!m_vao || m_isLineMode)
+    return;
+  if (isDynamic())
+  {
+    updateVertices(firstVertex, vertices, vertexCount);
+    vertexCount = 0;
+  }
+
+  glBindVertexArray(m_vao);
+  if (vertexCount > 0)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, firstVertex * sizeof(Vertex), vertexCount * sizeof(Vertex), vertices);
+  }
+  if (indexCount > 0)
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstIndex * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices);
+  glBindVertexArray(0);
+}
+
+void Mesh::resize(size_t vertexCount, size_t indexCount)
+{
+  if (m_arena)
+  {
+    m_arena->resize(m_arenaHandle, vertexCount, indexCount);
+    m_vertexCapacity = vertexCount;
+    m_indexCapacity = indexCount;
+    m_indexCount = indexCount;
+    return;
+  }
+  if (!m_vao || m_isLineMode || isDynamic())
+  {
+    allocate(vertexCount, indexCount);
+    return;
+  }
+
+  auto reallocate = [](GLenum target, GLuint &buffer, size_t oldBytes, size_t newBytes)
+  {
+    GLuint resized;
+    glGenBuffers(1, &resized);
+    glBindBuffer(target, resized);
+    glBufferData(target, newBytes, nullptr, GL_STATIC_DRAW);
+    if (oldBytes > 0 && newBytes > 0)
+    {
+      glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, target, 0, 0, std::min(oldBytes, newBytes));
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &buffer);
+    buffer = resized;
+  };
+
+  // The new buffers are bound while the VAO is, so it picks them up
+  glBindVertexArray(m_vao);
+  if (vertexCount != m_vertexCapacity)
+  {
+    reallocate(GL_ARRAY_BUFFER, m_vbo, m_vertexCapacity * sizeof(Vertex), vertexCount * sizeof(Vertex));
+    setupAttributes();
+  }
+  if (indexCount != m_indexCapacity)
+    reallocate(GL_ELEMENT_ARRAY_BUFFER, m_ebo, m_indexCapacity * sizeof(unsigned int), indexCount * sizeof(unsigned int));
+  glBindVertexArray(0);
+
+  m_vertexCapacity = vertexCount;
+  m_indexCapacity = indexCount;
+  m_indexCount = indexCount;
+}
+
+void Mesh::uploadDynamic(const Vertex *vertices, size_t vertexCount, const unsigned int *indices, size_t indexCount,
+                         unsigned int bufferCount)
+{
+  cleanup();
+  m_isLineMode = false;
+  m_indexCount = indexCount;
+  m_vertexCapacity = vertexCount;
+  m_indexCapacity = indexCount;
+  m_currentCopy = 0;
+
+  glGenVertexArrays(1, &m_vao);
+  glGenBuffers(1, &m_ebo);
+  glBindVertexArray(m_vao);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+
+  std::vector<glm::vec3> positions;
+  if (vertices)
+  {
+    positions.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+      positions[i] = vertices[i].position;
+  }
+
+  // Every copy starts out with the full data. The vertex buffer keeps the
+  // whole Vertex so updates are plain copies; its position field is unused.
+  m_copies.resize(std::max(bufferCount, 1u));
+  for (auto &copy : m_copies)
+  {
+    glGenBuffers(1, &copy.positionBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, copy.positionBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(glm::vec3), vertices ? positions.data() : nullptr, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &copy.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, copy.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_DYNAMIC_DRAW);
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_copies[0].vertexBuffer);
   setupAttributes();
+  glBindBuffer(GL_ARRAY_BUFFER, m_copies[0].positionBuffer);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+namespace
+{
+  // Past this many separate ranges a copy's dirty list is merged into one
+  // range covering them all, bounding the copies issued per refresh
+  constexpr size_t MAX_DIRTY_RANGES = 16;
+
+  // Adds [first, end) to a sorted list of disjoint ranges, merging it with
+  // the ranges it overlaps or touches
+  template <typename Range>
+  void addDirtyRange(std::vector<Range> &ranges, size_t first, size_t end)
+  {
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), first,
+                               [](const Range &range, size_t value) { return range.end < value; });
+    auto last = it;
+    while (last != ranges.end() && last->first <= end)
+    {
+      first = std::min(first, last->first);
+      end = std::max(end, last->end);
+      ++last;
+    }
+    it = ranges.erase(it, last);
+    ranges.insert(it, Range{first, end});
+
+    if (ranges.size() > MAX_DIRTY_RANGES)
+    {
+      Range all{ranges.front().first, ranges.back().end};
+      ranges.assign(1, all);
+    }
+  }
+}
+
+Mesh::DynamicCopy &Mesh::beginWrite(size_t first, size_t count, bool writesVertices, bool &positionsRefreshed,
+                                     bool &verticesRefreshed)
+{
+  size_t latest = m_currentCopy;
+  if (m_copies.size() > 1)
+  {
+    // Everything drawn from the current copy so far comes before this fence
+    m_copies[m_currentCopy].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_currentCopy = (m_currentCopy + 1) % m_copies.size();
+  }
+
+  DynamicCopy &copy = m_copies[m_currentCopy];
+  if (copy.fence)
+  {
+    while (glClientWaitSync(copy.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+    {
+    }
+    glDeleteSync(copy.fence);
+    copy.fence = nullptr;
+  }
+
+  // The ranges this copy missed catch up from the latest copy on the GPU,
+  // leaving out what the write is about to replace
+  const DynamicCopy &source = m_copies[latest];
+  size_t writeEnd = first + count;
+  auto refresh = [&](GLuint from, GLuint to, std::vector<VertexRange> &dirty, size_t elementSize, bool written)
+  {
+    bool copied = false;
+    glBindBuffer(GL_COPY_READ_BUFFER, from);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, to);
+    auto copyRange = [&](size_t begin, size_t end)
+    {
+      if (end <= begin)
+        return;
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, begin * elementSize, begin * elementSize,
+                          (end - begin) * elementSize);
+      copied = true;
+    };
+    for (const VertexRange &range : dirty)
+    {
+      if (!written)
+      {
+        copyRange(range.first, range.end);
+        continue;
+      }
+      copyRange(range.first, std::min(range.end, first));
+      copyRange(std::max(range.first, writeEnd), range.end);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    dirty.clear();
+    return copied;
+  };
+  positionsRefreshed = refresh(source.positionBuffer, copy.positionBuffer, copy.dirtyPositions, sizeof(glm::vec3), true);
+  verticesRefreshed = refresh(source.vertexBuffer, copy.vertexBuffer, copy.dirtyVertices, sizeof(Vertex), writesVertices);
+
+  if (m_copies.size() > 1)
+  {
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, copy.vertexBuffer);
+    setupAttributes();
+    glBindBuffer(GL_ARRAY_BUFFER, copy.positionBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  return copy;
+}
+
+void Mesh::endWrite(size_t first, size_t count, bool wroteVertices)
+{
+  for (size_t i = 0; i < m_copies.size(); ++i)
+  {
+    if (i == m_currentCopy)
+      continue;
+    addDirtyRange(m_copies[i].dirtyPositions, first, first + count);
+    if (wroteVertices)
+      addDirtyRange(m_copies[i].dirtyVertices, first, first + count);
+  }
+}
+
+namespace
+{
+  // Writes bytes at offset of buffer through fill, which gets the destination.
+  // A rewrite of a whole single buffer orphans it so the driver can hand out
+  // fresh storage instead of waiting on draws; a fenced ring copy is written
+  // unsynchronized. Anything else (a partial update of a single buffer, or of a
+  // ring copy with a GPU refresh pending) goes through glBufferSubData, which
+  // the driver orders after earlier commands.
+  enum class WriteMode
+  {
+    Orphan,
+    Unsynchronized,
+    SubData
+  };
+
+  template <typename Fill>
+  void writeBuffer(GLuint buffer, size_t offset, size_t bytes, WriteMode mode, std::vector<char> &scratch, Fill fill)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    void *destination = nullptr;
+    if (mode != WriteMode::SubData)
+    {
+      GLbitfield access = GL_MAP_WRITE_BIT;
+      if (mode == WriteMode::Orphan)
+        access |= GL_MAP_INVALIDATE_BUFFER_BIT;
+      else
+        access |= GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+      destination = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, bytes, access);
+    }
+
+    if (destination)
+    {
+      fill(destination);
+      glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    else
+    {
+      scratch.resize(bytes);
+      fill(scratch.data());
+      glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, scratch.data());
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  WriteMode chooseWriteMode(size_t copyCount, bool whole, bool refreshed)
+  {
+    if (copyCount == 1)
+      return whole ? WriteMode::Orphan : WriteMode::SubData;
+    return refreshed ? WriteMode::SubData : WriteMode::Unsynchronized;
+  }
+}
+
+void Mesh::updateVertices(size_t first, const Vertex *vertices, size_t count)
+{
+  if (!isDynamic())
+  {
+    uploadRange(first, vertices, count, 0, nullptr, 0);
+    return;
+  }
+  if (first >= m_vertexCapacity)
+    return;
+  count = std::min(count, m_vertexCapacity - first);
+  if (count == 0)
+    return;
+
+  bool whole = first == 0 && count == m_vertexCapacity;
+  bool positionsRefreshed, verticesRefreshed;
+  DynamicCopy &copy = beginWrite(first, count, true, positionsRefreshed, verticesRefreshed);
+
+  writeBuffer(copy.positionBuffer, first * sizeof(glm::vec3), count * sizeof(glm::vec3),
+              chooseWriteMode(m_copies.size(), whole, positionsRefreshed), m_writeScratch, [&](void *destination)
+              {
+                glm::vec3 *positions = static_cast<glm::vec3 *>(destination);
+                for (size_t i = 0; i < count; ++i)
+                  positions[i] = vertices[i].position;
+              });
+  writeBuffer(copy.vertexBuffer, first * sizeof(Vertex), count * sizeof(Vertex),
+              chooseWriteMode(m_copies.size(), whole, verticesRefreshed), m_writeScratch,
+              [&](void *destination) { std::memcpy(destination, vertices, count * sizeof(Vertex)); });
+  endWrite(first, count, true);
+}
+
+void Mesh::updatePositions(size_t first, const glm::vec3 *positions, size_t count)
+{
+  if (!isDynamic() || first >= m_vertexCapacity)
+    return;
+  count = std::min(count, m_vertexCapacity - first);
+  if (count == 0)
+    return;
+
+  bool whole = first == 0 && count == m_vertexCapacity;
+  bool positionsRefreshed, verticesRefreshed;
+  DynamicCopy &copy = beginWrite(first, count, false, positionsRefreshed, verticesRefreshed);
+
+  writeBuffer(copy.positionBuffer, first * sizeof(glm::vec3), count * sizeof(glm::vec3),
+              chooseWriteMode(m_copies.size(), whole, positionsRefreshed), m_writeScratch,
+              [&](void *destination) { std::memcpy(destination, positions, count * sizeof(glm::vec3)); });
+  endWrite(first, count, false);
+}
+
+bool Mesh::mapStorage(Vertex *&vertices, unsigned int *&indices)
+{
+  vertices = nullptr;
+  indices = nullptr;
+  if (m_arena || isDynamic() || !m_vao || m_isLineMode || m_vertexCapacity == 0 || m_indexCapacity == 0)
+    return false;
+
+  // Copy targets, so the VAO's element buffer binding is left alone
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+  vertices = static_cast<Vertex *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_vertexCapacity * sizeof(Vertex),
+                                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+  indices = static_cast<unsigned int *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_indexCapacity * sizeof(unsigned int),
+                                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+  if (vertices && indices)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return true;
+  }
+
+  // Only one of them mapped
+  if (indices)
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  if (vertices)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  vertices = nullptr;
+  indices = nullptr;
+  return false;
+}
+
+bool Mesh::unmapStorage()
+{
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+  bool intact = glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE;
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+  intact = glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE && intact;
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return intact;
+}
+
+float *Mesh::mapScalars()
+{
+  if (m_arena || !m_vao || m_isLineMode || m_vertexCapacity == 0)
+    return nullptr;
+
+  if (m_scalarCapacity != m_vertexCapacity)
+  {
+    // (Re)created to match the vertex storage, which resize may have changed
+    if (!m_scalarBuffer)
+      glGenBuffers(1, &m_scalarBuffer);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_scalarBuffer);
+    glBufferData(GL_ARRAY_BUFFER, m_vertexCapacity * sizeof(float), nullptr, GL_STREAM_DRAW);
+    glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void *)0);
+    glEnableVertexAttribArray(8);
+    glBindVertexArray(0);
+    m_scalarCapacity = m_vertexCapacity;
+  }
+
+  // Invalidating the whole buffer lets the driver hand out new storage
+  // while draws still read the previous values
+  glBindBuffer(GL_ARRAY_BUFFER, m_scalarBuffer);
+  void *scalars = glMapBufferRange(GL_ARRAY_BUFFER, 0, m_scalarCapacity * sizeof(float),
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return static_cast<float *>(scalars);
+}
+
+void Mesh::unmapScalars()
+{
+  if (!m_scalarBuffer)
+    return;
+  glBindBuffer(GL_ARRAY_BUFFER, m_scalarBuffer);
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Mesh::updateScalars(const float *values, size_t count)
+{
+  float *scalars = mapScalars();
+  if (!scalars)
+    return;
+  std::memcpy(scalars, values, std::min(count, m_scalarCapacity) * sizeof(float));
+  unmapScalars();
+}
+
+void Mesh::clearScalars()
+{
+  if (!m_scalarBuffer)
+    return;
+  glBindVertexArray(m_vao);
+  glDisableVertexAttribArray(8);
   glBindVertexArray(0);
+  glDeleteBuffers(1, &m_scalarBuffer);
+  m_scalarBuffer = 0;
+  m_scalarCapacity = 0;
+}
+
+size_t Mesh::getGPUBytes() const
+{
+  size_t vertexBytes = m_vertexCapacity * sizeof(Vertex);
+  if (isDynamic())
+    vertexBytes = m_vertexCapacity * (sizeof(Vertex) + sizeof(glm::vec3)) * m_copies.size();
+  return vertexBytes + m_scalarCapacity * sizeof(float) + m_indexCapacity * sizeof(unsigned int);
 }
 
 void Mesh::uploadLines(const std::vector<glm::vec3> &points)
@@ -92,6 +661,13 @@ void Mesh::uploadLines(const std::vector<glm::vec3> &points)
 
 void Mesh::draw() const
 {
+  if (m_arena)
+  {
+    bind();
+    drawRange(0, m_indexCount);
+    unbind();
+    return;
+  }
   if (!m_vao || m_isLineMode)
     return;
   glBindVertexArray(m_vao);
@@ -99,6 +675,35 @@ void Mesh::draw() const
   glBindVertexArray(0);
 }
 
+void Mesh::bind() const
+{
+  glBindVertexArray(m_arena ? m_arena->getVAO() : m_vao);
+}
+
+void Mesh::drawRange(size_t indexOffset, size_t indexCount, int baseVertex, size_t instanceCount) const
+{
+  if (m_arena)
+  {
+    const MeshArena::Range &range = m_arena->getRange(m_arenaHandle);
+    indexOffset += range.indexOffset;
+    baseVertex += int(range.vertexOffset);
+  }
+  else if (!m_vao || m_isLineMode)
+  {
+    return;
+  }
+  void *first = (void *)(indexOffset * sizeof(unsigned int));
+  if (instanceCount == 1)
+    glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, first, baseVertex);
+  else
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, first, instanceCount, baseVertex);
+}
+
+void Mesh::unbind()
+{
+  glBindVertexArray(0);
+}
+
 void Mesh::drawLines() const
 {
   if (!m_vao || !m_isLineMode || m_vertexCount < 2)
@@ -328,4 +933,147 @@ namespace MeshGen
     }
   }
 
+  void cone(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, int segments)
+  {
+    vertices.clear();
+    indices.clear();
+
+    // Unit cone: base radius 0.5 at y = -0.5, tip at y = 0.5
+    const float radius = 0.5f;
+    const float halfHeight = 0.5f;
+    const float slope = radius / (2.0f * halfHeight);
+
+    // Base cap center
+    unsigned int baseCenterIdx = vertices.size();
+    vertices.push_back({{0, -halfHeight, 0}, {0, -1, 0}, {0.5f, 0.5f}});
+
+    // Base cap ring
+    unsigned int baseRingStart = vertices.size();
+    for (int i = 0; i <= segments; ++i)
+    {
+      float angle = 2.0f * PI * i / segments;
+      float x = radius * cos(angle);
+      float z = radius * sin(angle);
+      vertices.push_back({{x, -halfHeight, z}, {0, -1, 0}, {(cos(angle) + 1) * 0.5f, (sin(angle) + 1) * 0.5f}});
+    }
+
+    for (int i = 0; i < segments; ++i)
+    {
+      indices.push_back(baseCenterIdx);
+      indices.push_back(baseRingStart + i);
+      indices.push_back(baseRingStart + i + 1);
+    }
+
+    // Side surface - one tip vertex per segment so each slice gets its own normal
+    unsigned int sideStart = vertices.size();
+    for (int i = 0; i <= segments; ++i)
+    {
+      float angle = 2.0f * PI * i / segments;
+      float x = cos(angle);
+      float z = sin(angle);
+      glm::vec3 normal = glm::normalize(glm::vec3(x, slope, z));
+      vertices.push_back({{x * radius, -halfHeight, z * radius}, normal, {(float)i / segments, 0}});
+      vertices.push_back({{0, halfHeight, 0}, normal, {(float)i / segments, 1}});
+    }
+
+    for (int i = 0; i < segments; ++i)
+    {
+      unsigned int base0 = sideStart + i * 2;
+      unsigned int tip0 = base0 + 1;
+      unsigned int base1 = base0 + 2;
+
+      indices.push_back(tip0);
+      indices.push_back(base0);
+      indices.push_back(base1);
+    }
+  }
+
+  void arrow(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, int segments)
+  {
+    vertices.clear();
+    indices.clear();
+
+    const float shaftRadius = 0.2f;
+    const float headRadius = 0.5f;
+    const float headStart = 0.65f;
+    const float headSlope = headRadius / (1.0f - headStart);
+
+    // Shaft side
+    unsigned int shaftStart = vertices.size();
+    for (int i = 0; i <= segments; ++i)
+    {
+      float angle = 2.0f * PI * i / segments;
+      float x = cos(angle);
+      float z = sin(angle);
+      vertices.push_back({{x * shaftRadius, 0, z * shaftRadius}, {x, 0, z}, {(float)i / segments, 0}});
+      vertices.push_back({{x * shaftRadius, headStart, z * shaftRadius}, {x, 0, z}, {(float)i / segments, headStart}});
+    }
+
+    for (int i = 0; i < segments; ++i)
+    {
+      unsigned int bot0 = shaftStart + i * 2;
+      unsigned int top0 = bot0 + 1;
+      unsigned int bot1 = bot0 + 2;
+      unsigned int top1 = bot0 + 3;
+
+      indices.push_back(top0);
+      indices.push_back(bot0);
+      indices.push_back(bot1);
+
+      indices.push_back(top0);
+      indices.push_back(bot1);
+      indices.push_back(top1);
+    }
+
+    // Tail cap and head underside, both facing -Y
+    unsigned int tailCenterIdx = vertices.size();
+    vertices.push_back({{0, 0, 0}, {0, -1, 0}, {0.5f, 0.5f}});
+    unsigned int headCenterIdx = vertices.size();
+    vertices.push_back({{0, headStart, 0}, {0, -1, 0}, {0.5f, 0.5f}});
+
+    unsigned int capRingStart = vertices.size();
+    for (int i = 0; i <= segments; ++i)
+    {
+      float angle = 2.0f * PI * i / segments;
+      float x = cos(angle);
+      float z = sin(angle);
+      vertices.push_back({{x * shaftRadius, 0, z * shaftRadius}, {0, -1, 0}, {(x + 1) * 0.5f, (z + 1) * 0.5f}});
+      vertices.push_back({{x * headRadius, headStart, z * headRadius}, {0, -1, 0}, {(x + 1) * 0.5f, (z + 1) * 0.5f}});
+    }
+
+    for (int i = 0; i < segments; ++i)
+    {
+      indices.push_back(tailCenterIdx);
+      indices.push_back(capRingStart + i * 2);
+      indices.push_back(capRingStart + (i + 1) * 2);
+
+      indices.push_back(headCenterIdx);
+      indices.push_back(capRingStart + i * 2 + 1);
+      indices.push_back(capRingStart + (i + 1) * 2 + 1);
+    }
+
+    // Head side
+    unsigned int headSideStart = vertices.size();
+    for (int i = 0; i <= segments; ++i)
+    {
+      float angle = 2.0f * PI * i / segments;
+      float x = cos(angle);
+      float z = sin(angle);
+      glm::vec3 normal = glm::normalize(glm::vec3(x, headSlope, z));
+      vertices.push_back({{x * headRadius, headStart, z * headRadius}, normal, {(float)i / segments, headStart}});
+      vertices.push_back({{0, 1, 0}, normal, {(float)i / segments, 1}});
+    }
+
+    for (int i = 0; i < segments; ++i)
+    {
+      unsigned int base0 = headSideStart + i * 2;
+      unsigned int tip0 = base0 + 1;
+      unsigned int base1 = base0 + 2;
+
+      indices.push_back(tip0);
+      indices.push_back(base0);
+      indices.push_back(base1);
+    }
+  }
+
 }
@@ -0,0 +1,531 @@
+#include <vgl/MeshArena.h>
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+  int lowestBit(uint64_t bits)
+  {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return int(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+  }
+
+  int highestBit(uint64_t bits)
+  {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, bits);
+    return int(index);
+#else
+    return 63 - __builtin_clzll(bits);
+#endif
+  }
+}
+
+// RangeAllocator
+
+RangeAllocator::RangeAllocator(size_t capacity)
+{
+  reset(capacity);
+}
+
+void RangeAllocator::mapping(size_t size, int &fl, int &sl)
+{
+  // Sizes below SL_COUNT get a class each; above, every power of two is
+  // split into SL_COUNT linear classes
+  if (size < SL_COUNT)
+  {
+    fl = 0;
+    sl = int(size);
+    return;
+  }
+  int msb = highestBit(size);
+  fl = msb - SL_BITS + 1;
+  sl = int(size >> (msb - SL_BITS)) - SL_COUNT;
+}
+
+uint32_t RangeAllocator::newBlock()
+{
+  uint32_t block;
+  if (!m_unusedBlocks.empty())
+  {
+    block = m_unusedBlocks.back();
+    m_unusedBlocks.pop_back();
+    m_blocks[block] = Block();
+  }
+  else
+  {
+    block = uint32_t(m_blocks.size());
+    m_blocks.emplace_back();
+  }
+  return block;
+}
+
+void RangeAllocator::insertFree(uint32_t block)
+{
+  int fl, sl;
+  mapping(m_blocks[block].size, fl, sl);
+  uint32_t &head = m_heads[fl * SL_COUNT + sl];
+
+  Block &inserted = m_blocks[block];
+  inserted.isFree = true;
+  inserted.prevFree = NONE;
+  inserted.nextFree = head;
+  if (head != NONE)
+    m_blocks[head].prevFree = block;
+  head = block;
+
+  m_flBitmap |= uint64_t(1) << fl;
+  m_slBitmaps[fl] |= 1u << sl;
+}
+
+void RangeAllocator::removeFree(uint32_t block)
+{
+  int fl, sl;
+  mapping(m_blocks[block].size, fl, sl);
+
+  Block &removed = m_blocks[block];
+  removed.isFree = false;
+  if (removed.prevFree != NONE)
+    m_blocks[removed.prevFree].nextFree = removed.nextFree;
+  else
+    m_heads[fl * SL_COUNT + sl] = removed.nextFree;
+  if (removed.nextFree != NONE)
+    m_blocks[removed.nextFree].prevFree = removed.prevFree;
+
+  if (m_heads[fl * SL_COUNT + sl] == NONE)
+  {
+    m_slBitmaps[fl] &= ~(1u << sl);
+    if (!m_slBitmaps[fl])
+      m_flBitmap &= ~(uint64_t(1) << fl);
+  }
+}
+
+void RangeAllocator::reset(size_t capacity)
+{
+  m_blocks.clear();
+  m_unusedBlocks.clear();
+  m_heads.fill(NONE);
+  m_flBitmap = 0;
+  m_slBitmaps.fill(0);
+  m_lastBlock = NONE;
+  m_capacity = 0;
+  m_used = 0;
+  grow(capacity);
+}
+
+void RangeAllocator::grow(size_t capacity)
+{
+  if (capacity <= m_capacity)
+    return;
+  size_t added = capacity - m_capacity;
+
+  if (m_lastBlock != NONE && m_blocks[m_lastBlock].isFree)
+  {
+    removeFree(m_lastBlock);
+    m_blocks[m_lastBlock].size += added;
+    insertFree(m_lastBlock);
+  }
+  else
+  {
+    uint32_t block = newBlock();
+    m_blocks[block].offset = m_capacity;
+    m_blocks[block].size = added;
+    m_blocks[block].prevPhysical = m_lastBlock;
+    if (m_lastBlock != NONE)
+      m_blocks[m_lastBlock].nextPhysical = block;
+    m_lastBlock = block;
+    insertFree(block);
+  }
+  m_capacity = capacity;
+}
+
+bool RangeAllocator::allocate(size_t size, Allocation &allocation)
+{
+  if (size == 0)
+  {
+    allocation = Allocation();
+    return true;
+  }
+
+  // Rounding the size up to the next class boundary means every block of
+  // the class found fits, so no list has to be searched
+  size_t rounded = size;
+  if (size >= SL_COUNT)
+    rounded += (size_t(1) << (highestBit(size) - SL_BITS)) - 1;
+  int fl, sl;
+  mapping(rounded, fl, sl);
+
+  uint32_t found = NONE;
+  if (fl < FL_COUNT)
+  {
+    uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+    if (slMap)
+    {
+      found = m_heads[fl * SL_COUNT + lowestBit(slMap)];
+    }
+    else
+    {
+      uint64_t flMap = fl + 1 < FL_COUNT ? m_flBitmap & (~uint64_t(0) << (fl + 1)) : 0;
+      if (flMap)
+      {
+        int larger = lowestBit(flMap);
+        found = m_heads[larger * SL_COUNT + lowestBit(m_slBitmaps[larger])];
+      }
+    }
+  }
+  // Near-full ranges: a block of the size's own class may still fit
+  if (found == NONE)
+  {
+    mapping(size, fl, sl);
+    for (uint32_t block = m_heads[fl * SL_COUNT + sl]; block != NONE; block = m_blocks[block].nextFree)
+    {
+      if (m_blocks[block].size >= size)
+      {
+        found = block;
+        break;
+      }
+    }
+  }
+  if (found == NONE)
+    return false;
+
+  removeFree(found);
+  if (m_blocks[found].size > size)
+  {
+    // The remainder stays free after the allocation
+    uint32_t rest = newBlock();
+    Block &block = m_blocks[found];
+    Block &remainder = m_blocks[rest];
+    remainder.offset = block.offset + size;
+    remainder.size = block.size - size;
+    remainder.prevPhysical = found;
+    remainder.nextPhysical = block.nextPhysical;
+    if (block.nextPhysical != NONE)
+      m_blocks[block.nextPhysical].prevPhysical = rest;
+    else
+      m_lastBlock = rest;
+    block.nextPhysical = rest;
+    block.size = size;
+    insertFree(rest);
+  }
+
+  m_used += size;
+  allocation.offset = m_blocks[found].offset;
+  allocation.block = found;
+  return true;
+}
+
+void RangeAllocator::free(uint32_t block)
+{
+  if (block == NONE)
+    return;
+  m_used -= m_blocks[block].size;
+
+  // Absorbs the physical successor of first into it
+  auto merge = [this](uint32_t first)
+  {
+    Block &block = m_blocks[first];
+    uint32_t second = block.nextPhysical;
+    block.size += m_blocks[second].size;
+    block.nextPhysical = m_blocks[second].nextPhysical;
+    if (block.nextPhysical != NONE)
+      m_blocks[block.nextPhysical].prevPhysical = first;
+    else
+      m_lastBlock = first;
+    m_unusedBlocks.push_back(second);
+  };
+
+  uint32_t prev = m_blocks[block].prevPhysical;
+  if (prev != NONE && m_blocks[prev].isFree)
+  {
+    removeFree(prev);
+    merge(prev);
+    block = prev;
+  }
+  uint32_t next = m_blocks[block].nextPhysical;
+  if (next != NONE && m_blocks[next].isFree)
+  {
+    removeFree(next);
+    merge(block);
+  }
+  insertFree(block);
+}
+
+size_t RangeAllocator::getLargestFree() const
+{
+  if (!m_flBitmap)
+    return 0;
+  int fl = highestBit(m_flBitmap);
+  int sl = highestBit(m_slBitmaps[fl]);
+  size_t largest = 0;
+  for (uint32_t block = m_heads[fl * SL_COUNT + sl]; block != NONE; block = m_blocks[block].nextFree)
+    largest = std::max(largest, m_blocks[block].size);
+  return largest;
+}
+
+// MeshArena
+
+MeshArena::MeshArena(size_t vertexCapacity, size_t indexCapacity)
+    : m_vertices(vertexCapacity), m_indices(indexCapacity)
+{
+}
+
+MeshArena::~MeshArena()
+{
+  if (m_vao)
+    glDeleteVertexArrays(1, &m_vao);
+  if (m_vbo)
+    glDeleteBuffers(1, &m_vbo);
+  if (m_ebo)
+    glDeleteBuffers(1, &m_ebo);
+}
+
+void MeshArena::createBuffers()
+{
+  glGenVertexArrays(1, &m_vao);
+  glGenBuffers(1, &m_vbo);
+  glGenBuffers(1, &m_ebo);
+
+  // Data goes through the copy targets so the VAO's element binding is
+  // only ever set in setupVAO
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+  glBufferData(GL_COPY_WRITE_BUFFER, m_vertices.getCapacity() * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+  glBufferData(GL_COPY_WRITE_BUFFER, m_indices.getCapacity() * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  setupVAO();
+}
+
+void MeshArena::setupVAO()
+{
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, uv));
+  glEnableVertexAttribArray(2);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MeshArena::draw(const Mesh *const *meshes, size_t count)
+{
+  m_drawCounts.clear();
+  m_drawOffsets.clear();
+  m_drawBaseVertices.clear();
+  for (size_t i = 0; i < count; ++i)
+  {
+    const Mesh *mesh = meshes[i];
+    if (!mesh || mesh->m_arena != this || mesh->m_indexCount == 0)
+      continue;
+    const Range &range = getRange(mesh->m_arenaHandle);
+    m_drawCounts.push_back(static_cast<GLsizei>(mesh->m_indexCount));
+    m_drawOffsets.push_back((const void *)(range.indexOffset * sizeof(unsigned int)));
+    m_drawBaseVertices.push_back(static_cast<GLint>(range.vertexOffset));
+  }
+  if (m_drawCounts.empty())
+    return;
+
+  glBindVertexArray(m_vao);
+  glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_drawCounts.data(), GL_UNSIGNED_INT, m_drawOffsets.data(),
+                                static_cast<GLsizei>(m_drawCounts.size()), m_drawBaseVertices.data());
+  glBindVertexArray(0);
+}
+
+void MeshArena::growBuffer(GLuint &buffer, RangeAllocator &allocator, size_t elementSize, size_t needed)
+{
+  size_t oldCapacity = allocator.getCapacity();
+  size_t capacity = std::max(oldCapacity * 2, oldCapacity + needed);
+
+  GLuint grown;
+  glGenBuffers(1, &grown);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+  glBufferData(GL_COPY_WRITE_BUFFER, capacity * elementSize, nullptr, GL_STATIC_DRAW);
+  if (oldCapacity > 0)
+  {
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldCapacity * elementSize);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glDeleteBuffers(1, &buffer);
+  buffer = grown;
+
+  allocator.grow(capacity);
+  setupVAO();
+}
+
+void MeshArena::allocateBlocks(size_t vertexCount, size_t indexCount, Slot &slot)
+{
+  if (!m_vao)
+    createBuffers();
+
+  RangeAllocator::Allocation vertices, indices;
+  while (!m_vertices.allocate(vertexCount, vertices))
+    growBuffer(m_vbo, m_vertices, sizeof(Vertex), vertexCount);
+  while (!m_indices.allocate(indexCount, indices))
+    growBuffer(m_ebo, m_indices, sizeof(unsigned int), indexCount);
+
+  slot.range = {vertices.offset, vertexCount, indices.offset, indexCount};
+  slot.vertexBlock = vertices.block;
+  slot.indexBlock = indices.block;
+}
+
+uint32_t MeshArena::allocate(size_t vertexCount, size_t indexCount)
+{
+  uint32_t handle;
+  if (!m_unusedRanges.empty())
+  {
+    handle = m_unusedRanges.back();
+    m_unusedRanges.pop_back();
+  }
+  else
+  {
+    handle = uint32_t(m_ranges.size());
+    m_ranges.emplace_back();
+  }
+
+  Slot &slot = m_ranges[handle];
+  allocateBlocks(vertexCount, indexCount, slot);
+  slot.isLive = true;
+  ++m_meshCount;
+  return handle;
+}
+
+void MeshArena::release(uint32_t handle)
+{
+  if (handle >= m_ranges.size() || !m_ranges[handle].isLive)
+    return;
+  Slot &slot = m_ranges[handle];
+  m_vertices.free(slot.vertexBlock);
+  m_indices.free(slot.indexBlock);
+  slot = Slot();
+  m_unusedRanges.push_back(handle);
+  --m_meshCount;
+}
+
+void MeshArena::resize(uint32_t handle, size_t vertexCount, size_t indexCount)
+{
+  Slot old = m_ranges[handle];
+  Slot &slot = m_ranges[handle];
+  // The old blocks are still held, so the copies never overlap
+  allocateBlocks(vertexCount, indexCount, slot);
+
+  auto copy = [](GLuint buffer, size_t from, size_t to, size_t bytes)
+  {
+    if (bytes == 0)
+      return;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, to, bytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  };
+  copy(m_vbo, old.range.vertexOffset * sizeof(Vertex), slot.range.vertexOffset * sizeof(Vertex),
+       std::min(old.range.vertexCount, vertexCount) * sizeof(Vertex));
+  copy(m_ebo, old.range.indexOffset * sizeof(unsigned int), slot.range.indexOffset * sizeof(unsigned int),
+       std::min(old.range.indexCount, indexCount) * sizeof(unsigned int));
+
+  m_vertices.free(old.vertexBlock);
+  m_indices.free(old.indexBlock);
+}
+
+void MeshArena::write(uint32_t handle, size_t firstVertex, const Vertex *vertices, size_t vertexCount,
+                      size_t firstIndex, const unsigned int *indices, size_t indexCount)
+{
+  // Clamped: past the end of the range are other meshes
+  const Range &range = m_ranges[handle].range;
+  vertexCount = firstVertex < range.vertexCount ? std::min(vertexCount, range.vertexCount - firstVertex) : 0;
+  indexCount = firstIndex < range.indexCount ? std::min(indexCount, range.indexCount - firstIndex) : 0;
+
+  if (vertices && vertexCount > 0)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (range.vertexOffset + firstVertex) * sizeof(Vertex),
+                    vertexCount * sizeof(Vertex), vertices);
+  }
+  if (indices && indexCount > 0)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (range.indexOffset + firstIndex) * sizeof(unsigned int),
+                    indexCount * sizeof(unsigned int), indices);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void MeshArena::defragment()
+{
+  if (!m_vao)
+    return;
+
+  auto compact = [this](GLuint &buffer, RangeAllocator &allocator, size_t elementSize, size_t Range::*offset,
+                        size_t Range::*count, uint32_t Slot::*block)
+  {
+    std::vector<uint32_t> order;
+    for (uint32_t handle = 0; handle < m_ranges.size(); ++handle)
+    {
+      if (m_ranges[handle].isLive && m_ranges[handle].range.*count > 0)
+        order.push_back(handle);
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+              { return m_ranges[a].range.*offset < m_ranges[b].range.*offset; });
+
+    GLuint packed;
+    glGenBuffers(1, &packed);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, packed);
+    glBufferData(GL_COPY_WRITE_BUFFER, allocator.getCapacity() * elementSize, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+
+    // A fresh allocator hands out blocks front to back
+    allocator.reset(allocator.getCapacity());
+    for (uint32_t handle : order)
+    {
+      Slot &slot = m_ranges[handle];
+      RangeAllocator::Allocation allocation;
+      allocator.allocate(slot.range.*count, allocation);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, slot.range.*offset * elementSize,
+                          allocation.offset * elementSize, slot.range.*count * elementSize);
+      slot.range.*offset = allocation.offset;
+      slot.*block = allocation.block;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+    buffer = packed;
+  };
+
+  compact(m_vbo, m_vertices, sizeof(Vertex), &Range::vertexOffset, &Range::vertexCount, &Slot::vertexBlock);
+  compact(m_ebo, m_indices, sizeof(unsigned int), &Range::indexOffset, &Range::indexCount, &Slot::indexBlock);
+  setupVAO();
+}
+
+MeshArenaStats MeshArena::getStats() const
+{
+  MeshArenaStats stats;
+  stats.meshCount = m_meshCount;
+  if (!m_vao)
+    return stats;
+
+  auto add = [&](const RangeAllocator &allocator, size_t elementSize)
+  {
+    size_t free = allocator.getCapacity() - allocator.getUsed();
+    stats.allocatedBytes += allocator.getCapacity() * elementSize;
+    stats.usedBytes += allocator.getUsed() * elementSize;
+    stats.fragmentedBytes += (free - allocator.getLargestFree()) * elementSize;
+  };
+  add(m_vertices, sizeof(Vertex));
+  add(m_indices, sizeof(unsigned int));
+  return stats;
+}
@@ -0,0 +1,419 @@
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <process.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+  constexpr char MAGIC[8] = {'V', 'G', 'L', 'M', 'E', 'S', 'H', '\0'};
+  constexpr uint32_t VERSION = 9;
+  constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+  constexpr size_t ALIGNMENT = 16;
+
+  // Unique per writer, so processes (or loads in one process) writing the
+  // same cache never share a temporary file: <cache>.<pid>.<random>.tmp
+  std::string tempPathFor(const std::string &cachePath)
+  {
+    unsigned long pid = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    pid = static_cast<unsigned long>(getpid());
+#elif defined(_WIN32)
+    pid = static_cast<unsigned long>(_getpid());
+#endif
+    static thread_local std::mt19937 random{std::random_device{}()};
+    char suffix[48];
+    std::snprintf(suffix, sizeof(suffix), ".%lu.%08x.tmp", pid, static_cast<unsigned>(random()));
+    return cachePath + suffix;
+  }
+
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t vertexSize;
+    uint32_t sourceCount;
+    uint32_t subMeshCount;
+    uint32_t buildFlags;
+    float acmrBefore;
+    float acmrAfter;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t positionMapOffset; // 0 = none
+    uint64_t sourcePositionCount;
+    uint32_t codec;
+    uint32_t reserved;
+    uint64_t vertexBytes; // stored sizes, smaller than count * element size when packed
+    uint64_t indexBytes;
+  };
+
+  enum Codec : uint32_t
+  {
+    CODEC_RAW = 0,
+    CODEC_PACKED = 1 // MeshCodec
+  };
+
+  struct SourceStamp
+  {
+    uint64_t size;
+    int64_t mtime;
+    uint32_t pathLength;
+    uint32_t reserved;
+  };
+
+  struct SubMeshRecord
+  {
+    float diffuse[3];
+    float ambient[3];
+    float specular[3];
+    float shininess;
+    float boundsMin[3];
+    float boundsMax[3];
+    float sphereCenter[3];
+    float sphereRadius;
+    uint32_t nameLength;
+    int32_t baseVertex;
+    uint32_t lodCount;
+    uint32_t diffuseMapLength;
+    uint64_t vertexCount;
+    uint64_t indexOffset;
+    uint64_t indexCount;
+  };
+
+  struct LODRecord
+  {
+    uint64_t indexOffset;
+    uint64_t indexCount;
+  };
+
+  size_t alignUp(size_t value) { return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+  std::string absolutePath(const std::string &path)
+  {
+    std::error_code ec;
+    fs::path absolute = fs::weakly_canonical(fs::absolute(path, ec), ec);
+    return ec ? path : absolute.string();
+  }
+
+  // Missing files get a stamp no existing file can match
+  SourceStamp stampFor(const std::string &path)
+  {
+    SourceStamp stamp{~0ull, 0, 0, 0};
+    std::error_code ec;
+    uint64_t size = fs::file_size(path, ec);
+    if (ec)
+      return stamp;
+    auto mtime = fs::last_write_time(path, ec);
+    if (ec)
+      return stamp;
+    stamp.size = size;
+    stamp.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    return stamp;
+  }
+
+  uint64_t hashString(const std::string &s)
+  {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : s)
+    {
+      hash ^= c;
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+  // Bounds-checked cursor over the mapped cache
+  struct Reader
+  {
+    const char *data;
+    size_t size;
+    size_t pos = 0;
+
+    template <typename T>
+    bool read(T &out)
+    {
+      if (size - pos < sizeof(T))
+        return false;
+      std::memcpy(&out, data + pos, sizeof(T));
+      pos += sizeof(T);
+      return true;
+    }
+
+    bool readString(std::string &out, size_t length)
+    {
+      if (size - pos < length)
+        return false;
+      out.assign(data + pos, length);
+      pos = std::min(size, alignUp(pos + length));
+      return true;
+    }
+  };
+
+  // Appends to a byte buffer, padding each block to the alignment
+  struct Writer
+  {
+    std::vector<char> bytes;
+
+    template <typename T>
+    void write(const T &value)
+    {
+      const char *p = reinterpret_cast<const char *>(&value);
+      bytes.insert(bytes.end(), p, p + sizeof(T));
+    }
+
+    void writeString(const std::string &s)
+    {
+      bytes.insert(bytes.end(), s.begin(), s.end());
+      bytes.resize(alignUp(bytes.size()), 0);
+    }
+  };
+}
+
+std::string MeshCache::pathFor(const std::string &source, const std::string &cacheDir)
+{
+  if (cacheDir.empty())
+    return source + ".vglcache";
+
+  // Flat directory: file name plus a hash of the full path keeps same-named
+  // files from different folders apart
+  char hash[17];
+  std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(hashString(absolutePath(source))));
+  std::string name = fs::path(source).filename().string();
+  return (fs::path(cacheDir) / (name + "-" + hash + ".vglcache")).string();
+}
+
+bool MeshCache::write(const std::string &cachePath, const std::vector<std::string> &sources,
+                      uint32_t buildFlags, const Contents &contents, bool compress)
+{
+  Writer header;
+  header.write(Header{{}, VERSION, BYTE_ORDER_MARK, static_cast<uint32_t>(sizeof(Vertex)),
+                      static_cast<uint32_t>(sources.size()), static_cast<uint32_t>(contents.subMeshes.size()),
+                      buildFlags, contents.acmrBefore, contents.acmrAfter, contents.vertexCount, contents.indexCount,
+                      0, 0, 0, contents.sourcePositionCount, compress ? CODEC_PACKED : CODEC_RAW, 0, 0, 0});
+  std::memcpy(header.bytes.data(), MAGIC, sizeof(MAGIC));
+
+  for (const auto &source : sources)
+  {
+    std::string absolute = absolutePath(source);
+    SourceStamp stamp = stampFor(source);
+    stamp.pathLength = static_cast<uint32_t>(absolute.size());
+    header.write(stamp);
+    header.writeString(absolute);
+  }
+
+  for (const auto &subMesh : contents.subMeshes)
+  {
+    const Material &m = subMesh.material;
+    SubMeshRecord record{};
+    std::memcpy(record.diffuse, &m.diffuse[0], sizeof(record.diffuse));
+    std::memcpy(record.ambient, &m.ambient[0], sizeof(record.ambient));
+    std::memcpy(record.specular, &m.specular[0], sizeof(record.specular));
+    record.shininess = m.shininess;
+    std::memcpy(record.boundsMin, &subMesh.bounds.min[0], sizeof(record.boundsMin));
+    std::memcpy(record.boundsMax, &subMesh.bounds.max[0], sizeof(record.boundsMax));
+    std::memcpy(record.sphereCenter, &subMesh.sphere.center[0], sizeof(record.sphereCenter));
+    record.sphereRadius = subMesh.sphere.radius;
+    record.nameLength = static_cast<uint32_t>(m.name.size());
+    record.baseVertex = subMesh.baseVertex;
+    record.lodCount = static_cast<uint32_t>(subMesh.lods.size());
+    record.diffuseMapLength = static_cast<uint32_t>(m.diffuseMap.size());
+    record.vertexCount = subMesh.vertexCount;
+    record.indexOffset = subMesh.indexOffset;
+    record.indexCount = subMesh.indexCount;
+
+    header.write(record);
+    header.writeString(m.name);
+    header.writeString(m.diffuseMap);
+    for (const auto &lod : subMesh.lods)
+      header.write(LODRecord{lod.indexOffset, lod.indexCount});
+  }
+
+  // Packed data takes the place of the raw arrays
+  const char *vertexData = reinterpret_cast<const char *>(contents.vertices);
+  const char *indexData = reinterpret_cast<const char *>(contents.indices);
+  size_t vertexBytes = contents.vertexCount * sizeof(Vertex);
+  size_t indexBytes = contents.indexCount * sizeof(unsigned int);
+  std::vector<char> packedVertices;
+  std::vector<char> packedIndices;
+  if (compress)
+  {
+    packedVertices = MeshCodec::encodeVertices(contents.vertices, contents.vertexCount);
+    packedIndices = MeshCodec::encodeIndices(contents.indices, contents.indexCount);
+    vertexData = packedVertices.data();
+    indexData = packedIndices.data();
+    vertexBytes = packedVertices.size();
+    indexBytes = packedIndices.size();
+  }
+
+  // Data block offsets are known now that the header is complete
+  Header *h = reinterpret_cast<Header *>(header.bytes.data());
+  h->vertexBytes = vertexBytes;
+  h->indexBytes = indexBytes;
+  h->vertexOffset = header.bytes.size();
+  h->indexOffset = alignUp(header.bytes.size() + vertexBytes);
+  size_t mapBytes = contents.positionMap ? contents.vertexCount * sizeof(unsigned int) : 0;
+  if (contents.positionMap)
+    h->positionMapOffset = alignUp(h->indexOffset + indexBytes);
+
+  std::error_code ec;
+  fs::path parent = fs::path(cachePath).parent_path();
+  if (!parent.empty())
+    fs::create_directories(parent, ec);
+
+  // Written under a temporary name and renamed, so readers never see a partial file
+  std::string tempPath = tempPathFor(cachePath);
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+      return false;
+
+    static const char padding[ALIGNMENT] = {};
+    file.write(header.bytes.data(), header.bytes.size());
+    file.write(vertexData, vertexBytes);
+    file.write(padding, h->indexOffset - (header.bytes.size() + vertexBytes));
+    file.write(indexData, indexBytes);
+    if (contents.positionMap)
+    {
+      file.write(padding, h->positionMapOffset - (h->indexOffset + indexBytes));
+      file.write(reinterpret_cast<const char *>(contents.positionMap), mapBytes);
+    }
+
+    if (!file.good())
+    {
+      file.close();
+      fs::remove(tempPath, ec);
+      return false;
+    }
+  }
+
+  fs::rename(tempPath, cachePath, ec);
+  if (ec)
+  {
+    fs::remove(tempPath, ec);
+    return false;
+  }
+  return true;
+}
+
+bool MeshCache::read(const std::string &cachePath, const std::string &source, uint32_t buildFlags,
+                     MappedFile &file, Contents &contents)
+{
+  contents = Contents{};
+  if (!file.open(cachePath))
+    return false;
+
+  Reader reader{file.data(), file.size()};
+  Header header;
+  if (!reader.read(header) || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION || header.byteOrder != BYTE_ORDER_MARK || header.vertexSize != sizeof(Vertex) ||
+      header.sourceCount == 0 || header.buildFlags != buildFlags)
+    return false;
+
+  // Stale if the OBJ moved or any source changed since the cache was written
+  for (uint32_t i = 0; i < header.sourceCount; ++i)
+  {
+    SourceStamp stored;
+    std::string path;
+    if (!reader.read(stored) || !reader.readString(path, stored.pathLength))
+      return false;
+    if (i == 0 && path != absolutePath(source))
+      return false;
+
+    SourceStamp current = stampFor(path);
+    if (current.size != stored.size || current.mtime != stored.mtime)
+      return false;
+  }
+
+  bool packed = header.codec == CODEC_PACKED;
+  if ((header.codec != CODEC_RAW && !packed) ||
+      (!packed && (header.vertexBytes != header.vertexCount * sizeof(Vertex) ||
+                   header.indexBytes != header.indexCount * sizeof(unsigned int))))
+    return false;
+  size_t vertexBytes = header.vertexBytes;
+  size_t indexBytes = header.indexBytes;
+  if (header.vertexOffset > file.size() || vertexBytes > file.size() - header.vertexOffset ||
+      header.indexOffset > file.size() || indexBytes > file.size() - header.indexOffset)
+    return false;
+  size_t mapBytes = header.vertexCount * sizeof(unsigned int);
+  if (header.positionMapOffset != 0 &&
+      (header.positionMapOffset > file.size() || mapBytes > file.size() - header.positionMapOffset))
+    return false;
+
+  contents.subMeshes.resize(header.subMeshCount);
+  for (auto &subMesh : contents.subMeshes)
+  {
+    SubMeshRecord record;
+    if (!reader.read(record) || !reader.readString(subMesh.material.name, record.nameLength) ||
+        !reader.readString(subMesh.material.diffuseMap, record.diffuseMapLength))
+      return false;
+    if (record.indexOffset + record.indexCount > header.indexCount || record.baseVertex < 0 ||
+        record.baseVertex + record.vertexCount > header.vertexCount || record.lodCount > header.indexCount / 3)
+      return false;
+
+    Material &m = subMesh.material;
+    std::memcpy(&m.diffuse[0], record.diffuse, sizeof(record.diffuse));
+    std::memcpy(&m.ambient[0], record.ambient, sizeof(record.ambient));
+    std::memcpy(&m.specular[0], record.specular, sizeof(record.specular));
+    m.shininess = record.shininess;
+    std::memcpy(&subMesh.bounds.min[0], record.boundsMin, sizeof(record.boundsMin));
+    std::memcpy(&subMesh.bounds.max[0], record.boundsMax, sizeof(record.boundsMax));
+    std::memcpy(&subMesh.sphere.center[0], record.sphereCenter, sizeof(record.sphereCenter));
+    subMesh.sphere.radius = record.sphereRadius;
+    subMesh.baseVertex = record.baseVertex;
+    subMesh.vertexCount = record.vertexCount;
+    subMesh.indexOffset = record.indexOffset;
+    subMesh.indexCount = record.indexCount;
+
+    subMesh.lods.resize(record.lodCount);
+    for (auto &lod : subMesh.lods)
+    {
+      LODRecord lodRecord;
+      if (!reader.read(lodRecord) || lodRecord.indexOffset + lodRecord.indexCount > header.indexCount)
+        return false;
+      lod.indexOffset = lodRecord.indexOffset;
+      lod.indexCount = lodRecord.indexCount;
+    }
+  }
+
+  // Offsets are aligned and the mapping is page aligned, so these point
+  // straight into the file with no copy
+  contents.vertexCount = header.vertexCount;
+  contents.indexCount = header.indexCount;
+  if (packed)
+  {
+    // Structure only; the data itself is decoded when it is uploaded
+    contents.packedVertices = file.data() + header.vertexOffset;
+    contents.packedVertexBytes = vertexBytes;
+    contents.packedIndices = file.data() + header.indexOffset;
+    contents.packedIndexBytes = indexBytes;
+    if (!MeshCodec::checkVertices(contents.packedVertices, vertexBytes, contents.vertexCount) ||
+        !MeshCodec::checkIndices(contents.packedIndices, indexBytes, contents.indexCount))
+      return false;
+  }
+  else
+  {
+    contents.vertices = reinterpret_cast<const Vertex *>(file.data() + header.vertexOffset);
+    contents.indices = reinterpret_cast<const unsigned int *>(file.data() + header.indexOffset);
+  }
+  contents.acmrBefore = header.acmrBefore;
+  contents.acmrAfter = header.acmrAfter;
+  if (header.positionMapOffset != 0)
+    contents.positionMap = reinterpret_cast<const unsigned int *>(file.data() + header.positionMapOffset);
+  contents.sourcePositionCount = header.sourcePositionCount;
+  return true;
+}
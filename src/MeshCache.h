@@ -0,0 +1,59 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <vgl/OBJMesh.h>
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Versioned binary cache of fully built OBJMesh geometry. Internal to the
+// library. A cache records the files it was built from (absolute path, size
+// and mtime); it is only used while all of them are unchanged.
+//
+// Layout, native byte order, every block 16-byte aligned:
+//   header, source stamps, submesh records (each followed by its name,
+//   diffuse map path and LOD ranges), vertex data, index data, optional
+//   position map (one source position index per vertex)
+//
+// Vertex and index data are stored raw, or packed with MeshCodec to cut
+// the bytes read from slow disks.
+namespace MeshCache
+{
+  struct Contents
+  {
+    std::vector<SubMesh> subMeshes;
+    const Vertex *vertices = nullptr;
+    size_t vertexCount = 0;
+    const unsigned int *indices = nullptr;
+    size_t indexCount = 0;
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+    const unsigned int *positionMap = nullptr; // vertexCount entries, or null
+    size_t sourcePositionCount = 0;
+    // Set by read() instead of vertices/indices when the cache is packed:
+    // MeshCodec data, already checked to decode to vertexCount/indexCount
+    const char *packedVertices = nullptr;
+    size_t packedVertexBytes = 0;
+    const char *packedIndices = nullptr;
+    size_t packedIndexBytes = 0;
+  };
+
+  // Next to the source when cacheDir is empty, else inside cacheDir
+  std::string pathFor(const std::string &source, const std::string &cacheDir);
+
+  // sources[0] is the OBJ file, the rest are files it pulled in (MTL).
+  // buildFlags identify the processing options the geometry was built with.
+  // With compress the vertex and index data are packed (lossy for vertices,
+  // see MeshCodec).
+  bool write(const std::string &cachePath, const std::vector<std::string> &sources,
+             uint32_t buildFlags, const Contents &contents, bool compress = false);
+
+  // Maps cachePath into file and, if it is current for source and was built
+  // with the same flags, fills contents with pointers into the mapping
+  bool read(const std::string &cachePath, const std::string &source, uint32_t buildFlags,
+            MappedFile &file, Contents &contents);
+}
+
+#endif
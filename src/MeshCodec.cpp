@@ -0,0 +1,550 @@
+#include "MeshCodec.h"
+#include "Simd.h"
+#include <vgl/Bounds.h>
+#include <vgl/ThreadPool.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+  constexpr size_t VERTEX_BLOCK = 4096;
+  constexpr size_t INDEX_BLOCK = 16384;
+  constexpr size_t GROUP = 16;
+
+  // Position xyz, normal xyz, uv: 16 bits each, one stream per byte
+  constexpr int VERTEX_LANES = 8;
+  constexpr int VERTEX_STREAMS = VERTEX_LANES * 2;
+  constexpr int INDEX_STREAMS = 4;
+
+  // Bits per byte for each 2-bit group width code
+  constexpr int WIDTH_BITS[4] = {0, 2, 4, 8};
+
+  // Encoded buffer: this table, blockCount + 1 byte offsets of the blocks
+  // (relative to the end of the offsets), then the blocks. Block b holds
+  // elements [b * blockSize, min((b + 1) * blockSize, count)). Encoded
+  // vertices start with a VertexGrid in front of the table.
+  struct BlockTable
+  {
+    uint64_t count;
+    uint64_t blockCount;
+  };
+
+  // Quantization grid of all the vertices, so equal positions (and uvs) in
+  // different blocks decode to equal values and submesh borders and
+  // attribute seams stay closed. Step 0 means every value equals the
+  // minimum.
+  struct VertexGrid
+  {
+    float positionMin[3];
+    float positionStep[3];
+    float uvMin[2];
+    float uvStep[2];
+  };
+
+  size_t blockCountFor(size_t count, size_t blockSize) { return (count + blockSize - 1) / blockSize; }
+  size_t groupCount(size_t n) { return (n + GROUP - 1) / GROUP; }
+
+  uint16_t zigzag(uint16_t delta) { return static_cast<uint16_t>((delta << 1) ^ -(delta >> 15)); }
+  uint16_t unzigzag(uint16_t value) { return static_cast<uint16_t>((value >> 1) ^ -(value & 1)); }
+  uint32_t zigzag(uint32_t delta) { return (delta << 1) ^ (0u - (delta >> 31)); }
+  uint32_t unzigzag(uint32_t value) { return (value >> 1) ^ (0u - (value & 1)); }
+
+  // Group width codes, four per byte, then each group at its width
+  void encodeStream(const uint8_t *bytes, size_t n, std::vector<char> &out)
+  {
+    size_t groups = groupCount(n);
+    size_t headerStart = out.size();
+    out.resize(out.size() + (groups + 3) / 4, 0);
+    for (size_t g = 0; g < groups; ++g)
+    {
+      uint8_t group[GROUP] = {};
+      size_t begin = g * GROUP;
+      std::memcpy(group, bytes + begin, std::min(GROUP, n - begin));
+
+      uint8_t any = 0;
+      for (size_t k = 0; k < GROUP; ++k)
+        any |= group[k];
+      int code = any == 0 ? 0 : any < 4 ? 1 : any < 16 ? 2 : 3;
+      out[headerStart + g / 4] = static_cast<char>(out[headerStart + g / 4] | code << ((g % 4) * 2));
+
+      int bits = WIDTH_BITS[code];
+      if (bits == 0)
+        continue;
+      size_t perByte = 8 / bits;
+      for (size_t j = 0; j < GROUP / perByte; ++j)
+      {
+        unsigned packed = 0;
+        for (size_t k = 0; k < perByte; ++k)
+          packed |= static_cast<unsigned>(group[j * perByte + k]) << (k * bits);
+        out.push_back(static_cast<char>(packed));
+      }
+    }
+  }
+
+  // Encoded size of an n-byte stream starting at p, false if it would run
+  // past available
+  bool streamSize(const uint8_t *p, size_t available, size_t n, size_t &size)
+  {
+    size_t groups = groupCount(n);
+    size = (groups + 3) / 4;
+    if (size > available)
+      return false;
+    for (size_t g = 0; g < groups; ++g)
+      size += GROUP * WIDTH_BITS[(p[g / 4] >> ((g % 4) * 2)) & 3] / 8;
+    return size <= available;
+  }
+
+  // Unpacks whole groups, so out needs room for n rounded up to GROUP.
+  // Returns the end of the stream.
+  const uint8_t *decodeStream(const uint8_t *p, size_t n, uint8_t *out)
+  {
+    size_t groups = groupCount(n);
+    const uint8_t *data = p + (groups + 3) / 4;
+    for (size_t g = 0; g < groups; ++g, out += GROUP)
+    {
+      switch ((p[g / 4] >> ((g % 4) * 2)) & 3)
+      {
+      case 0:
+        std::memset(out, 0, GROUP);
+        break;
+      case 1:
+        for (size_t k = 0; k < GROUP; ++k)
+          out[k] = (data[k >> 2] >> ((k & 3) * 2)) & 3;
+        data += GROUP / 4;
+        break;
+      case 2:
+        for (size_t k = 0; k < GROUP; ++k)
+          out[k] = (data[k >> 1] >> ((k & 1) * 4)) & 15;
+        data += GROUP / 2;
+        break;
+      default:
+        std::memcpy(out, data, GROUP);
+        data += GROUP;
+        break;
+      }
+    }
+    return data;
+  }
+
+  // Encodes blocks in parallel and joins them behind the block table,
+  // which follows prefixSize bytes left for the caller
+  template <typename EncodeBlock>
+  std::vector<char> encodeBlocks(size_t count, size_t blockSize, size_t prefixSize, EncodeBlock encodeBlock)
+  {
+    size_t blockCount = blockCountFor(count, blockSize);
+    std::vector<std::vector<char>> blocks(blockCount);
+    ThreadPool::shared().parallelFor(blockCount, [&](size_t b)
+                                     {
+      size_t first = b * blockSize;
+      encodeBlock(first, std::min(blockSize, count - first), blocks[b]); });
+
+    BlockTable table{count, blockCount};
+    std::vector<char> out(prefixSize + sizeof(table) + (blockCount + 1) * sizeof(uint64_t));
+    std::memcpy(out.data() + prefixSize, &table, sizeof(table));
+    uint64_t offset = 0;
+    for (size_t b = 0; b <= blockCount; ++b)
+    {
+      std::memcpy(out.data() + prefixSize + sizeof(table) + b * sizeof(uint64_t), &offset, sizeof(offset));
+      if (b < blockCount)
+        offset += blocks[b].size();
+    }
+    out.reserve(out.size() + offset);
+    for (auto &block : blocks)
+    {
+      out.insert(out.end(), block.begin(), block.end());
+      block = std::vector<char>();
+    }
+    return out;
+  }
+
+  // Block b spans [begin(b), begin(b + 1)) of the data after the table
+  struct BlockView
+  {
+    const char *blocks = nullptr;
+    const char *offsets = nullptr;
+    size_t blockCount = 0;
+
+    size_t begin(size_t b) const
+    {
+      uint64_t offset;
+      std::memcpy(&offset, offsets + b * sizeof(uint64_t), sizeof(offset));
+      return static_cast<size_t>(offset);
+    }
+  };
+
+  bool readTable(const char *data, size_t size, size_t count, size_t blockSize, BlockView &view)
+  {
+    BlockTable table;
+    if (size < sizeof(table))
+      return false;
+    std::memcpy(&table, data, sizeof(table));
+    if (table.count != count || table.blockCount != blockCountFor(count, blockSize) ||
+        (size - sizeof(table)) / sizeof(uint64_t) < table.blockCount + 1)
+      return false;
+
+    view.offsets = data + sizeof(table);
+    view.blockCount = static_cast<size_t>(table.blockCount);
+    view.blocks = view.offsets + (view.blockCount + 1) * sizeof(uint64_t);
+    size_t available = size - (view.blocks - data);
+    for (size_t b = 0; b < view.blockCount; ++b)
+    {
+      if (view.begin(b) > view.begin(b + 1))
+        return false;
+    }
+    return view.begin(0) == 0 && view.begin(view.blockCount) <= available;
+  }
+
+  // Every block holds `streams` streams of its element count
+  bool checkBlocks(const char *data, size_t size, size_t count, size_t blockSize, int streams)
+  {
+    BlockView view;
+    if (!readTable(data, size, count, blockSize, view))
+      return false;
+
+    std::atomic<bool> ok{true};
+    ThreadPool::shared().parallelFor(view.blockCount, [&](size_t b)
+                                     {
+      size_t n = std::min(blockSize, count - b * blockSize);
+      size_t available = view.begin(b + 1) - view.begin(b);
+      const uint8_t *p = reinterpret_cast<const uint8_t *>(view.blocks + view.begin(b));
+      for (int s = 0; s < streams; ++s)
+      {
+        size_t streamBytes;
+        if (!streamSize(p, available, n, streamBytes))
+        {
+          ok = false;
+          return;
+        }
+        p += streamBytes;
+        available -= streamBytes;
+      } });
+    return ok;
+  }
+
+  VertexGrid gridFor(const Vertex *vertices, size_t count)
+  {
+    VertexGrid grid{};
+    if (count == 0)
+      return grid;
+    AABB box = AABB::fromVertices(vertices, count);
+    glm::vec2 uvMin = vertices[0].uv, uvMax = vertices[0].uv;
+    for (size_t i = 1; i < count; ++i)
+    {
+      uvMin = glm::min(uvMin, vertices[i].uv);
+      uvMax = glm::max(uvMax, vertices[i].uv);
+    }
+    auto stepFor = [](float lo, float hi)
+    {
+      float step = (hi - lo) / 65535.0f;
+      return std::isfinite(step) && step > 0.0f ? step : 0.0f;
+    };
+    for (int c = 0; c < 3; ++c)
+    {
+      grid.positionMin[c] = box.min[c];
+      grid.positionStep[c] = stepFor(box.min[c], box.max[c]);
+    }
+    for (int c = 0; c < 2; ++c)
+    {
+      grid.uvMin[c] = uvMin[c];
+      grid.uvStep[c] = stepFor(uvMin[c], uvMax[c]);
+    }
+    return grid;
+  }
+
+  void encodeVertexBlock(const Vertex *vertices, size_t n, const VertexGrid &grid, std::vector<char> &out)
+  {
+    auto quantize = [](float value, float lo, float step)
+    {
+      if (step == 0.0f)
+        return uint16_t(0);
+      return static_cast<uint16_t>(std::clamp(std::lround((value - lo) / step), 0l, 65535l));
+    };
+
+    size_t stride = groupCount(n) * GROUP;
+    std::vector<uint8_t> streams(VERTEX_STREAMS * stride, 0);
+    uint16_t previous[VERTEX_LANES] = {};
+    for (size_t i = 0; i < n; ++i)
+    {
+      const Vertex &v = vertices[i];
+      uint16_t lanes[VERTEX_LANES];
+      for (int c = 0; c < 3; ++c)
+      {
+        lanes[c] = quantize(v.position[c], grid.positionMin[c], grid.positionStep[c]);
+        lanes[3 + c] = static_cast<uint16_t>(static_cast<int16_t>(std::lround(std::clamp(v.normal[c], -1.0f, 1.0f) * 32767.0f)));
+      }
+      for (int c = 0; c < 2; ++c)
+        lanes[6 + c] = quantize(v.uv[c], grid.uvMin[c], grid.uvStep[c]);
+
+      for (int l = 0; l < VERTEX_LANES; ++l)
+      {
+        uint16_t z = zigzag(static_cast<uint16_t>(lanes[l] - previous[l]));
+        previous[l] = lanes[l];
+        streams[(2 * l) * stride + i] = static_cast<uint8_t>(z);
+        streams[(2 * l + 1) * stride + i] = static_cast<uint8_t>(z >> 8);
+      }
+    }
+
+    for (int s = 0; s < VERTEX_STREAMS; ++s)
+      encodeStream(&streams[s * stride], n, out);
+  }
+
+#ifdef VGL_HAS_SSE2
+  // The lanes of a decoded vertex are its 8 floats in memory order
+  static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex is position, normal, uv");
+
+  // Rows hold one lane of 8 vertices each; afterwards row k holds the 8
+  // lanes of vertex k
+  void transpose8x8(__m128i rows[8])
+  {
+    __m128i a0 = _mm_unpacklo_epi16(rows[0], rows[1]);
+    __m128i a1 = _mm_unpackhi_epi16(rows[0], rows[1]);
+    __m128i a2 = _mm_unpacklo_epi16(rows[2], rows[3]);
+    __m128i a3 = _mm_unpackhi_epi16(rows[2], rows[3]);
+    __m128i a4 = _mm_unpacklo_epi16(rows[4], rows[5]);
+    __m128i a5 = _mm_unpackhi_epi16(rows[4], rows[5]);
+    __m128i a6 = _mm_unpacklo_epi16(rows[6], rows[7]);
+    __m128i a7 = _mm_unpackhi_epi16(rows[6], rows[7]);
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+    rows[0] = _mm_unpacklo_epi64(b0, b4);
+    rows[1] = _mm_unpackhi_epi64(b0, b4);
+    rows[2] = _mm_unpacklo_epi64(b1, b5);
+    rows[3] = _mm_unpackhi_epi64(b1, b5);
+    rows[4] = _mm_unpacklo_epi64(b2, b6);
+    rows[5] = _mm_unpackhi_epi64(b2, b6);
+    rows[6] = _mm_unpacklo_epi64(b3, b7);
+    rows[7] = _mm_unpackhi_epi64(b3, b7);
+  }
+
+  // Sign-extends the 16-bit lanes selected by mask and zero-extends the
+  // others, then converts to float
+  __m128 lanesToFloat(__m128i zeroExtended, __m128i signExtended, __m128i mask)
+  {
+    return _mm_cvtepi32_ps(_mm_or_si128(_mm_and_si128(mask, signExtended), _mm_andnot_si128(mask, zeroExtended)));
+  }
+#endif
+
+  void decodeVertexBlock(const char *data, size_t n, const VertexGrid &grid, Vertex *out, uint8_t *streams)
+  {
+    size_t stride = groupCount(n) * GROUP;
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+    for (int s = 0; s < VERTEX_STREAMS; ++s)
+      p = decodeStream(p, n, streams + s * stride);
+
+    constexpr float NORMAL_SCALE = 1.0f / 32767.0f;
+    uint16_t lanes[VERTEX_LANES] = {};
+    size_t i = 0;
+
+#ifdef VGL_HAS_SSE2
+    // Eight vertices at a time: each lane's deltas are joined from their
+    // two byte streams, unzigzagged and prefix-summed across the vertices
+    // in one register, then the 8 x 8 block is transposed to one register
+    // per vertex and scaled into its two halves. Same arithmetic (and
+    // results) as the scalar loop below.
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i normalLow = _mm_setr_epi32(0, 0, 0, -1);
+    const __m128i normalHigh = _mm_setr_epi32(-1, -1, 0, 0);
+    const __m128 scaleLow = _mm_setr_ps(grid.positionStep[0], grid.positionStep[1], grid.positionStep[2], NORMAL_SCALE);
+    const __m128 scaleHigh = _mm_setr_ps(NORMAL_SCALE, NORMAL_SCALE, grid.uvStep[0], grid.uvStep[1]);
+    const __m128 offsetLow = _mm_setr_ps(grid.positionMin[0], grid.positionMin[1], grid.positionMin[2], 0.0f);
+    const __m128 offsetHigh = _mm_setr_ps(0.0f, 0.0f, grid.uvMin[0], grid.uvMin[1]);
+    __m128i running[VERTEX_LANES];
+    for (int l = 0; l < VERTEX_LANES; ++l)
+      running[l] = zero;
+
+    for (; i + 8 <= n; i += 8)
+    {
+      __m128i rows[VERTEX_LANES];
+      for (int l = 0; l < VERTEX_LANES; ++l)
+      {
+        __m128i low = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(streams + (2 * l) * stride + i));
+        __m128i high = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(streams + (2 * l + 1) * stride + i));
+        __m128i z = _mm_unpacklo_epi8(low, high);
+        __m128i d = _mm_xor_si128(_mm_srli_epi16(z, 1), _mm_sub_epi16(zero, _mm_and_si128(z, one)));
+        d = _mm_add_epi16(d, _mm_slli_si128(d, 2));
+        d = _mm_add_epi16(d, _mm_slli_si128(d, 4));
+        d = _mm_add_epi16(d, _mm_slli_si128(d, 8));
+        d = _mm_add_epi16(d, running[l]);
+        __m128i last = _mm_shufflehi_epi16(d, 0xFF);
+        running[l] = _mm_unpackhi_epi64(last, last);
+        rows[l] = d;
+      }
+
+      transpose8x8(rows);
+      for (int k = 0; k < 8; ++k)
+      {
+        __m128i v = rows[k];
+        __m128 low = lanesToFloat(_mm_unpacklo_epi16(v, zero), _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), normalLow);
+        __m128 high = lanesToFloat(_mm_unpackhi_epi16(v, zero), _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16), normalHigh);
+        float *target = reinterpret_cast<float *>(out + i + k);
+        _mm_storeu_ps(target, _mm_add_ps(_mm_mul_ps(low, scaleLow), offsetLow));
+        _mm_storeu_ps(target + 4, _mm_add_ps(_mm_mul_ps(high, scaleHigh), offsetHigh));
+      }
+    }
+
+    for (int l = 0; l < VERTEX_LANES; ++l)
+      lanes[l] = static_cast<uint16_t>(_mm_cvtsi128_si32(running[l]));
+#endif
+
+    const glm::vec3 positionMin(grid.positionMin[0], grid.positionMin[1], grid.positionMin[2]);
+    const glm::vec3 positionStep(grid.positionStep[0], grid.positionStep[1], grid.positionStep[2]);
+    const glm::vec2 uvMin(grid.uvMin[0], grid.uvMin[1]);
+    const glm::vec2 uvStep(grid.uvStep[0], grid.uvStep[1]);
+    for (; i < n; ++i)
+    {
+      for (int l = 0; l < VERTEX_LANES; ++l)
+      {
+        uint16_t z = static_cast<uint16_t>(streams[(2 * l) * stride + i] | streams[(2 * l + 1) * stride + i] << 8);
+        lanes[l] = static_cast<uint16_t>(lanes[l] + unzigzag(z));
+      }
+
+      // Assembled locally and stored whole, since out may be write-combined memory
+      Vertex v;
+      v.position = positionMin + glm::vec3(lanes[0], lanes[1], lanes[2]) * positionStep;
+      v.normal = glm::vec3(static_cast<int16_t>(lanes[3]), static_cast<int16_t>(lanes[4]),
+                           static_cast<int16_t>(lanes[5])) * NORMAL_SCALE;
+      v.uv = uvMin + glm::vec2(lanes[6], lanes[7]) * uvStep;
+      out[i] = v;
+    }
+  }
+
+  void encodeIndexBlock(const unsigned int *indices, size_t n, std::vector<char> &out)
+  {
+    size_t stride = groupCount(n) * GROUP;
+    std::vector<uint8_t> streams(INDEX_STREAMS * stride, 0);
+    uint32_t previous = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      uint32_t z = zigzag(static_cast<uint32_t>(indices[i] - previous));
+      previous = indices[i];
+      for (int s = 0; s < INDEX_STREAMS; ++s)
+        streams[s * stride + i] = static_cast<uint8_t>(z >> (8 * s));
+    }
+    for (int s = 0; s < INDEX_STREAMS; ++s)
+      encodeStream(&streams[s * stride], n, out);
+  }
+
+  void decodeIndexBlock(const char *data, size_t n, unsigned int *out, uint8_t *streams)
+  {
+    size_t stride = groupCount(n) * GROUP;
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+    for (int s = 0; s < INDEX_STREAMS; ++s)
+      p = decodeStream(p, n, streams + s * stride);
+
+    uint32_t previous = 0;
+    size_t i = 0;
+
+#ifdef VGL_HAS_SSE2
+    // Sixteen indices at a time, four per register: the byte streams are
+    // interleaved back into 32-bit values, unzigzagged and prefix-summed
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i running = zero;
+    for (; i + 16 <= n; i += 16)
+    {
+      __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(streams + i));
+      __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(streams + stride + i));
+      __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(streams + 2 * stride + i));
+      __m128i b3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(streams + 3 * stride + i));
+      __m128i low = _mm_unpacklo_epi8(b0, b1), high = _mm_unpacklo_epi8(b2, b3);
+      __m128i lowRest = _mm_unpackhi_epi8(b0, b1), highRest = _mm_unpackhi_epi8(b2, b3);
+      __m128i values[4] = {_mm_unpacklo_epi16(low, high), _mm_unpackhi_epi16(low, high),
+                           _mm_unpacklo_epi16(lowRest, highRest), _mm_unpackhi_epi16(lowRest, highRest)};
+      for (int k = 0; k < 4; ++k)
+      {
+        __m128i z = values[k];
+        __m128i d = _mm_xor_si128(_mm_srli_epi32(z, 1), _mm_sub_epi32(zero, _mm_and_si128(z, one)));
+        d = _mm_add_epi32(d, _mm_slli_si128(d, 4));
+        d = _mm_add_epi32(d, _mm_slli_si128(d, 8));
+        d = _mm_add_epi32(d, running);
+        running = _mm_shuffle_epi32(d, 0xFF);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + k * 4), d);
+      }
+    }
+    previous = static_cast<uint32_t>(_mm_cvtsi128_si32(running));
+#endif
+
+    for (; i < n; ++i)
+    {
+      uint32_t z = static_cast<uint32_t>(streams[i]) | static_cast<uint32_t>(streams[stride + i]) << 8 |
+                   static_cast<uint32_t>(streams[2 * stride + i]) << 16 |
+                   static_cast<uint32_t>(streams[3 * stride + i]) << 24;
+      previous += unzigzag(z);
+      out[i] = previous;
+    }
+  }
+
+  // Decodes the blocks in parallel, each worker reusing one scratch buffer
+  // for the unpacked streams of its blocks
+  template <typename T, typename DecodeBlock>
+  void decodeBlocks(const char *data, size_t size, T *out, size_t count, size_t blockSize, int streams,
+                    DecodeBlock decodeBlock)
+  {
+    BlockView view;
+    if (!readTable(data, size, count, blockSize, view))
+      return;
+
+    size_t workers = std::min<size_t>(view.blockCount, std::max(1u, ThreadPool::shared().getThreadCount()) + 1);
+    std::atomic<size_t> nextBlock{0};
+    ThreadPool::shared().parallelFor(workers, [&](size_t)
+                                     {
+      std::vector<uint8_t> scratch(streams * groupCount(blockSize) * GROUP);
+      size_t b;
+      while ((b = nextBlock.fetch_add(1)) < view.blockCount)
+      {
+        size_t first = b * blockSize;
+        decodeBlock(view.blocks + view.begin(b), std::min(blockSize, count - first), out + first, scratch.data());
+      } });
+  }
+}
+
+std::vector<char> MeshCodec::encodeVertices(const Vertex *vertices, size_t count)
+{
+  VertexGrid grid = gridFor(vertices, count);
+  std::vector<char> out = encodeBlocks(count, VERTEX_BLOCK, sizeof(grid), [&](size_t first, size_t n, std::vector<char> &out)
+                                       { encodeVertexBlock(vertices + first, n, grid, out); });
+  std::memcpy(out.data(), &grid, sizeof(grid));
+  return out;
+}
+
+std::vector<char> MeshCodec::encodeIndices(const unsigned int *indices, size_t count)
+{
+  return encodeBlocks(count, INDEX_BLOCK, 0, [&](size_t first, size_t n, std::vector<char> &out)
+                      { encodeIndexBlock(indices + first, n, out); });
+}
+
+bool MeshCodec::checkVertices(const char *data, size_t size, size_t count)
+{
+  if (size < sizeof(VertexGrid))
+    return false;
+  return checkBlocks(data + sizeof(VertexGrid), size - sizeof(VertexGrid), count, VERTEX_BLOCK, VERTEX_STREAMS);
+}
+
+bool MeshCodec::checkIndices(const char *data, size_t size, size_t count)
+{
+  return checkBlocks(data, size, count, INDEX_BLOCK, INDEX_STREAMS);
+}
+
+void MeshCodec::decodeVertices(const char *data, size_t size, Vertex *out, size_t count)
+{
+  VertexGrid grid;
+  std::memcpy(&grid, data, sizeof(grid));
+  decodeBlocks(data + sizeof(grid), size - sizeof(grid), out, count, VERTEX_BLOCK, VERTEX_STREAMS,
+               [&](const char *block, size_t n, Vertex *blockOut, uint8_t *streams)
+               { decodeVertexBlock(block, n, grid, blockOut, streams); });
+}
+
+void MeshCodec::decodeIndices(const char *data, size_t size, unsigned int *out, size_t count)
+{
+  decodeBlocks(data, size, out, count, INDEX_BLOCK, INDEX_STREAMS, decodeIndexBlock);
+}
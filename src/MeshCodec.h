@@ -0,0 +1,42 @@
+#ifndef MESHCODEC_H
+#define MESHCODEC_H
+
+#include <vgl/Mesh.h>
+#include <cstddef>
+#include <vector>
+
+// Compact encoding of vertex and index buffers for the mesh cache. Internal
+// to the library.
+//
+// Data is cut into blocks that encode and decode independently (in parallel
+// on ThreadPool::shared()). Within a block every element is stored as the
+// zigzag-coded difference to the one before, split into byte streams (all
+// low bytes, then all high bytes, ...), and each stream is bit-packed in
+// groups of 16 bytes at 0, 2, 4 or 8 bits per byte. Vertex-cache-ordered
+// data has small differences, so most groups pack to a fraction of their
+// size, and a group unpacks with a few shifts and masks.
+//
+// Vertices are quantized first, so they do not round-trip exactly:
+// positions and texture coordinates get 16 bits over the range each
+// component spans in the whole buffer (one grid, so vertices sharing a
+// position still share it after decoding), normals 16-bit signed
+// normalized components. Indices round-trip exactly. Decoding uses SSE2
+// where available, with identical results to the scalar path.
+namespace MeshCodec
+{
+  std::vector<char> encodeVertices(const Vertex *vertices, size_t count);
+  std::vector<char> encodeIndices(const unsigned int *indices, size_t count);
+
+  // Walks the block table and stream headers (about 2% of the data): true
+  // if data decodes to exactly count elements without reading past size
+  bool checkVertices(const char *data, size_t size, size_t count);
+  bool checkIndices(const char *data, size_t size, size_t count);
+
+  // Decode into out, which may be mapped GPU memory: it is written once,
+  // front to back within each block, and never read. Data must have passed
+  // the matching check.
+  void decodeVertices(const char *data, size_t size, Vertex *out, size_t count);
+  void decodeIndices(const char *data, size_t size, unsigned int *out, size_t count);
+}
+
+#endif
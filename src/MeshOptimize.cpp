@@ -0,0 +1,688 @@
+#include <vgl/MeshOptimize.h>
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+
+float MeshOptimize::computeACMR(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize)
+{
+  if (indices.size() < 3)
+    return 0.0f;
+
+  // FIFO: a vertex is resident if fewer than cacheSize misses happened since it entered
+  std::vector<uint64_t> enteredAt(vertexCount, 0);
+  uint64_t misses = 0;
+  for (unsigned int v : indices)
+  {
+    if (v >= vertexCount)
+      continue;
+    if (enteredAt[v] == 0 || misses - enteredAt[v] >= cacheSize)
+    {
+      ++misses;
+      enteredAt[v] = misses;
+    }
+  }
+  return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+namespace
+{
+  constexpr int CACHE_SIZE = 32;
+
+  // Scores from Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+  float vertexScore(int cachePosition, unsigned int remaining)
+  {
+    if (remaining == 0)
+      return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+      // The triangle just drawn gets a fixed score so it doesn't dominate
+      if (cachePosition < 3)
+        score = 0.75f;
+      else
+        score = std::pow(1.0f - float(cachePosition - 3) / (CACHE_SIZE - 3), 1.5f);
+    }
+    // Favour vertices with few triangles left so they leave the cache for good
+    return score + 2.0f / std::sqrt(float(remaining));
+  }
+}
+
+void MeshOptimize::vertexCache(std::vector<unsigned int> &indices, size_t vertexCount)
+{
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount < 2)
+    return;
+
+  // Vertex -> triangle adjacency (CSR); entries are removed by swapping
+  // with the last live one as triangles are emitted
+  std::vector<unsigned int> remaining(vertexCount, 0);
+  for (unsigned int v : indices)
+    ++remaining[v];
+  std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; ++v)
+    adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+  std::vector<unsigned int> adjacency(indices.size());
+  {
+    std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+      adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+  }
+
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v)
+    vertexScores[v] = vertexScore(-1, remaining[v]);
+
+  std::vector<float> triangleScores(triangleCount);
+  for (size_t t = 0; t < triangleCount; ++t)
+    triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<unsigned int> cache, nextCache;
+  cache.reserve(CACHE_SIZE + 3);
+  nextCache.reserve(CACHE_SIZE + 3);
+
+  std::vector<unsigned int> result;
+  result.reserve(indices.size());
+
+  size_t scanCursor = 0;
+  size_t best = 0;
+  float bestScore = triangleScores[0];
+  for (size_t t = 1; t < triangleCount; ++t)
+  {
+    if (triangleScores[t] > bestScore)
+    {
+      bestScore = triangleScores[t];
+      best = t;
+    }
+  }
+
+  for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+  {
+    if (bestScore < 0.0f)
+    {
+      // Nothing in the cache connects to more work; continue in input order
+      while (emitted[scanCursor])
+        ++scanCursor;
+      best = scanCursor;
+    }
+
+    emitted[best] = true;
+    const unsigned int *tri = &indices[best * 3];
+    result.insert(result.end(), tri, tri + 3);
+
+    // Emitted vertices move to the front of the LRU cache
+    nextCache.assign(tri, tri + 3);
+    for (unsigned int v : cache)
+    {
+      if (v != tri[0] && v != tri[1] && v != tri[2])
+        nextCache.push_back(v);
+    }
+
+    for (int k = 0; k < 3; ++k)
+    {
+      unsigned int v = tri[k];
+      size_t begin = adjacencyStart[v];
+      size_t end = begin + remaining[v];
+      for (size_t a = begin; a < end; ++a)
+      {
+        if (adjacency[a] == best)
+        {
+          std::swap(adjacency[a], adjacency[end - 1]);
+          --remaining[v];
+          break;
+        }
+      }
+    }
+
+    // Vertices pushed past the end leave the cache
+    for (size_t i = CACHE_SIZE; i < nextCache.size(); ++i)
+    {
+      cachePosition[nextCache[i]] = -1;
+      vertexScores[nextCache[i]] = vertexScore(-1, remaining[nextCache[i]]);
+    }
+    nextCache.resize(std::min<size_t>(nextCache.size(), CACHE_SIZE));
+    cache.swap(nextCache);
+
+    for (size_t i = 0; i < cache.size(); ++i)
+    {
+      cachePosition[cache[i]] = static_cast<int>(i);
+      vertexScores[cache[i]] = vertexScore(static_cast<int>(i), remaining[cache[i]]);
+    }
+
+    // Only triangles touching the cache can have changed score
+    bestScore = -1.0f;
+    for (unsigned int v : cache)
+    {
+      size_t begin = adjacencyStart[v];
+      for (size_t a = begin; a < begin + remaining[v]; ++a)
+      {
+        unsigned int t = adjacency[a];
+        float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        triangleScores[t] = score;
+        if (score > bestScore)
+        {
+          bestScore = score;
+          best = t;
+        }
+      }
+    }
+  }
+
+  indices.swap(result);
+}
+
+void MeshOptimize::overdraw(std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices, float threshold)
+{
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount < 2)
+    return;
+
+  const unsigned int cacheSize = 16;
+  float targetACMR = computeACMR(indices, vertices.size(), cacheSize) * threshold;
+
+  // Walk the order with a FIFO cache simulation. A cluster ends where all
+  // three vertices miss (the cache restarts anyway), or once its own miss
+  // ratio is back under the target, in which case the next cluster starts
+  // with a cold cache.
+  std::vector<uint64_t> enteredAt(vertices.size(), 0);
+  uint64_t misses = 0;
+  uint64_t clusterBase = 0;
+  size_t clusterMisses = 0;
+  std::vector<size_t> clusterStarts = {0};
+  for (size_t t = 0; t < triangleCount; ++t)
+  {
+    int triangleMisses = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+      unsigned int v = indices[t * 3 + k];
+      if (enteredAt[v] <= clusterBase || misses - enteredAt[v] >= cacheSize)
+      {
+        ++misses;
+        enteredAt[v] = misses;
+        ++triangleMisses;
+      }
+    }
+
+    if (triangleMisses == 3 && t > clusterStarts.back())
+    {
+      clusterStarts.push_back(t);
+      clusterMisses = 0;
+    }
+    clusterMisses += triangleMisses;
+
+    if (clusterMisses <= targetACMR * (t + 1 - clusterStarts.back()) && t + 1 < triangleCount)
+    {
+      clusterStarts.push_back(t + 1);
+      clusterBase = misses;
+      clusterMisses = 0;
+    }
+  }
+  clusterStarts.push_back(triangleCount);
+  size_t clusterCount = clusterStarts.size() - 1;
+  if (clusterCount < 2)
+    return;
+
+  glm::vec3 meshCenter(0.0f);
+  for (const auto &v : vertices)
+    meshCenter += v.position;
+  meshCenter /= static_cast<float>(vertices.size());
+
+  // Clusters facing away from the center are likely in front of the ones
+  // behind them from most viewpoints, so they go first
+  std::vector<float> sortKey(clusterCount);
+  for (size_t c = 0; c < clusterCount; ++c)
+  {
+    glm::vec3 centroid(0.0f);
+    glm::vec3 normal(0.0f);
+    float area = 0.0f;
+    for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+    {
+      const glm::vec3 &a = vertices[indices[t * 3]].position;
+      const glm::vec3 &b = vertices[indices[t * 3 + 1]].position;
+      const glm::vec3 &d = vertices[indices[t * 3 + 2]].position;
+      glm::vec3 n = glm::cross(b - a, d - a);
+      float triangleArea = glm::length(n);
+      centroid += (a + b + d) * (triangleArea / 3.0f);
+      normal += n;
+      area += triangleArea;
+    }
+    if (area > 0.0f)
+      centroid /= area;
+    float normalLength = glm::length(normal);
+    sortKey[c] = normalLength > 0.0f ? glm::dot(centroid - meshCenter, normal / normalLength) : 0.0f;
+  }
+
+  std::vector<size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), size_t(0));
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                   { return sortKey[a] > sortKey[b]; });
+
+  std::vector<unsigned int> result;
+  result.reserve(indices.size());
+  for (size_t c : order)
+    result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+  indices.swap(result);
+}
+
+void MeshOptimize::vertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                               std::vector<unsigned int> *companion)
+{
+  const unsigned int unused = 0xFFFFFFFFu;
+  std::vector<unsigned int> remap(vertices.size(), unused);
+  std::vector<Vertex> result;
+  result.reserve(vertices.size());
+  std::vector<unsigned int> companionResult;
+  if (companion)
+    companionResult.reserve(vertices.size());
+
+  for (unsigned int &index : indices)
+  {
+    if (remap[index] == unused)
+    {
+      remap[index] = static_cast<unsigned int>(result.size());
+      result.push_back(vertices[index]);
+      if (companion)
+        companionResult.push_back((*companion)[index]);
+    }
+    index = remap[index];
+  }
+
+  // Vertices no triangle uses are dropped
+  vertices.swap(result);
+  if (companion)
+    companion->swap(companionResult);
+}
+
+namespace
+{
+  // Sum of squared distances to a set of planes, each weighted by the area
+  // of the triangle it came from
+  struct Quadric
+  {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0;
+
+    void addPlane(const glm::dvec3 &n, double d, double w)
+    {
+      a00 += w * n.x * n.x;
+      a01 += w * n.x * n.y;
+      a02 += w * n.x * n.z;
+      a11 += w * n.y * n.y;
+      a12 += w * n.y * n.z;
+      a22 += w * n.z * n.z;
+      b0 += w * n.x * d;
+      b1 += w * n.y * d;
+      b2 += w * n.z * d;
+      c += w * d * d;
+      weight += w;
+    }
+
+    void add(const Quadric &q)
+    {
+      a00 += q.a00;
+      a01 += q.a01;
+      a02 += q.a02;
+      a11 += q.a11;
+      a12 += q.a12;
+      a22 += q.a22;
+      b0 += q.b0;
+      b1 += q.b1;
+      b2 += q.b2;
+      c += q.c;
+      weight += q.weight;
+    }
+
+    double error(const glm::vec3 &p) const
+    {
+      double x = p.x, y = p.y, z = p.z;
+      double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+      return std::max(e, 0.0);
+    }
+  };
+
+  struct Collapse
+  {
+    float cost;
+    unsigned int from;
+    unsigned int to;
+  };
+}
+
+std::vector<unsigned int> MeshOptimize::simplify(const std::vector<unsigned int> &indices,
+                                                 const std::vector<Vertex> &vertices, size_t targetIndexCount,
+                                                 float *error)
+{
+  std::vector<unsigned int> result = indices;
+  if (error)
+    *error = 0.0f;
+  size_t vertexCount = vertices.size();
+  if (result.size() <= targetIndexCount || vertexCount == 0)
+    return result;
+
+  // Weld by position: welded[v] is the first vertex at v's position.
+  // Topology is judged on welded ids, so attribute seams are not holes.
+  std::vector<unsigned int> welded(vertexCount);
+  {
+    auto key = [&](unsigned int v)
+    {
+      const glm::vec3 &p = vertices[v].position;
+      return std::array<float, 3>{p.x, p.y, p.z};
+    };
+    std::vector<unsigned int> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+              { return key(a) < key(b); });
+    for (size_t i = 0; i < vertexCount;)
+    {
+      size_t end = i + 1;
+      while (end < vertexCount && key(order[end]) == key(order[i]))
+        ++end;
+      unsigned int first = *std::min_element(order.begin() + i, order.begin() + end);
+      for (size_t j = i; j < end; ++j)
+        welded[order[j]] = first;
+      i = end;
+    }
+  }
+
+  // Each triangle edge by its welded ends and by its actual vertices
+  struct Edge
+  {
+    uint64_t welded;
+    uint64_t vertices;
+    bool operator<(const Edge &other) const
+    {
+      return welded != other.welded ? welded < other.welded : vertices < other.vertices;
+    }
+  };
+  auto edgeKey = [](uint64_t a, uint64_t b) { return a < b ? (a << 32 | b) : (b << 32 | a); };
+  std::vector<Edge> edges;
+
+  // Open and non-manifold edges are used by other than two triangles. The
+  // submesh's material boundaries are open edges, so they never move.
+  std::vector<unsigned char> locked(vertexCount, 0);
+  {
+    edges.reserve(result.size());
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        unsigned int a = result[i + k];
+        unsigned int b = result[i + (k + 1) % 3];
+        edges.push_back({edgeKey(welded[a], welded[b]), edgeKey(a, b)});
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();)
+    {
+      size_t end = i + 1;
+      while (end < edges.size() && edges[end].welded == edges[i].welded)
+        ++end;
+      if (end - i != 2)
+      {
+        locked[edges[i].welded >> 32] = 1;
+        locked[edges[i].welded & 0xFFFFFFFFu] = 1;
+      }
+      i = end;
+    }
+  }
+
+  std::vector<Quadric> quadrics(vertexCount);
+  glm::vec3 boundsMin(vertices[0].position);
+  glm::vec3 boundsMax(vertices[0].position);
+  for (const auto &v : vertices)
+  {
+    boundsMin = glm::min(boundsMin, v.position);
+    boundsMax = glm::max(boundsMax, v.position);
+  }
+  for (size_t i = 0; i < result.size(); i += 3)
+  {
+    glm::dvec3 p0(vertices[result[i]].position);
+    glm::dvec3 p1(vertices[result[i + 1]].position);
+    glm::dvec3 p2(vertices[result[i + 2]].position);
+    glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+    double length = glm::length(n);
+    if (length <= 0.0)
+      continue;
+    n /= length;
+    for (int k = 0; k < 3; ++k)
+      quadrics[welded[result[i + k]]].addPlane(n, -glm::dot(n, p0), length * 0.5);
+  }
+
+  // Collapses run in passes over the cheapest edges first. Within a pass a
+  // position whose neighbourhood changed is left for the next one, so every
+  // flip test sees current positions. Positions (welded ids) collapse as a
+  // whole: every vertex at the moving position goes to a vertex at the
+  // target position.
+  enum : unsigned char
+  {
+    FREE,
+    MOVED,   // collapsed onto another position
+    TOUCHED, // the target of a collapse
+    FROZEN   // neighbour of a collapsed position
+  };
+  std::vector<unsigned char> state(vertexCount);
+  std::vector<unsigned int> collapseTo(vertexCount);
+  std::vector<unsigned int> triangleStart(vertexCount + 1);
+  std::vector<unsigned int> triangles;
+  std::vector<unsigned int> copyStart(vertexCount + 1);
+  std::vector<unsigned int> copies;
+  std::vector<unsigned char> seamDegree(vertexCount);
+  std::vector<uint64_t> seamEdges;
+  std::vector<std::pair<unsigned int, unsigned int>> moves;
+  std::vector<Collapse> candidates;
+  double maxError = 0.0;
+  double maxWeight = 0.0;
+
+  while (result.size() > targetIndexCount)
+  {
+    size_t triangleCount = result.size() / 3;
+
+    std::fill(triangleStart.begin(), triangleStart.end(), 0u);
+    for (unsigned int v : result)
+      ++triangleStart[v + 1];
+    std::partial_sum(triangleStart.begin(), triangleStart.end(), triangleStart.begin());
+    triangles.resize(result.size());
+    {
+      std::vector<unsigned int> fill(triangleStart.begin(), triangleStart.end() - 1);
+      for (size_t i = 0; i < result.size(); ++i)
+        triangles[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    // The vertices still in use at each position
+    std::fill(copyStart.begin(), copyStart.end(), 0u);
+    for (size_t v = 0; v < vertexCount; ++v)
+      if (triangleStart[v + 1] > triangleStart[v])
+        ++copyStart[welded[v] + 1];
+    std::partial_sum(copyStart.begin(), copyStart.end(), copyStart.begin());
+    copies.resize(copyStart[vertexCount]);
+    {
+      std::vector<unsigned int> fill(copyStart.begin(), copyStart.end() - 1);
+      for (size_t v = 0; v < vertexCount; ++v)
+        if (triangleStart[v + 1] > triangleStart[v])
+          copies[fill[welded[v]]++] = static_cast<unsigned int>(v);
+    }
+
+    // Seam edges join two triangles that use different vertices at the
+    // edge's ends (UV or normal splits). A position on a seam line has two
+    // of them and may only slide along the line; seam corners and ends stay.
+    edges.clear();
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        unsigned int a = result[i + k];
+        unsigned int b = result[i + (k + 1) % 3];
+        edges.push_back({edgeKey(welded[a], welded[b]), edgeKey(a, b)});
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    std::fill(seamDegree.begin(), seamDegree.end(), 0);
+    seamEdges.clear();
+    for (size_t i = 0; i + 1 < edges.size();)
+    {
+      if (edges[i + 1].welded != edges[i].welded)
+      {
+        ++i;
+        continue;
+      }
+      if (edges[i + 1].vertices != edges[i].vertices)
+      {
+        uint64_t a = edges[i].welded >> 32, b = edges[i].welded & 0xFFFFFFFFu;
+        seamDegree[a] = static_cast<unsigned char>(std::min(seamDegree[a] + 1, 3));
+        seamDegree[b] = static_cast<unsigned char>(std::min(seamDegree[b] + 1, 3));
+        seamEdges.push_back(edges[i].welded);
+      }
+      i += 2;
+    }
+    auto canMove = [&](unsigned int from, unsigned int to)
+    {
+      if (locked[from])
+        return false;
+      if (seamDegree[from] == 0)
+        return copyStart[from + 1] - copyStart[from] == 1;
+      return seamDegree[from] == 2 &&
+             std::binary_search(seamEdges.begin(), seamEdges.end(), edgeKey(from, to));
+    };
+
+    // Each interior edge appears in its two triangles with opposite
+    // directions; taking it where it runs from lower to higher welded id
+    // lists it once. The cheaper movable end is moved onto the other.
+    candidates.clear();
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        unsigned int a = welded[result[i + k]];
+        unsigned int b = welded[result[i + (k + 1) % 3]];
+        if (a >= b)
+          continue;
+        bool moveA = canMove(a, b);
+        bool moveB = canMove(b, a);
+        if (!moveA && !moveB)
+          continue;
+
+        Quadric q = quadrics[a];
+        q.add(quadrics[b]);
+        double toB = moveA ? q.error(vertices[b].position) : HUGE_VAL;
+        double toA = moveB ? q.error(vertices[a].position) : HUGE_VAL;
+        if (toB <= toA)
+          candidates.push_back({static_cast<float>(toB), a, b});
+        else
+          candidates.push_back({static_cast<float>(toA), b, a});
+      }
+    }
+    if (candidates.empty())
+      break;
+    std::sort(candidates.begin(), candidates.end(), [](const Collapse &x, const Collapse &y)
+              { return x.cost < y.cost; });
+
+    std::fill(state.begin(), state.end(), FREE);
+    std::iota(collapseTo.begin(), collapseTo.end(), 0u);
+    size_t wanted = triangleCount - targetIndexCount / 3;
+    size_t removed = 0;
+    for (const Collapse &collapse : candidates)
+    {
+      if (removed >= wanted)
+        break;
+      unsigned int from = collapse.from;
+      unsigned int to = collapse.to;
+      if (state[from] != FREE || state[to] == MOVED)
+        continue;
+
+      // Each vertex at the moving position goes to the one vertex at the
+      // target it shares an edge with, which keeps its side of a seam.
+      // Reject collapses where that is ambiguous or would turn a surviving
+      // triangle over.
+      const glm::vec3 &source = vertices[from].position;
+      const glm::vec3 &target = vertices[to].position;
+      bool rejected = false;
+      size_t dying = 0;
+      moves.clear();
+      for (unsigned int c = copyStart[from]; c < copyStart[from + 1] && !rejected; ++c)
+      {
+        unsigned int copy = copies[c];
+        unsigned int partner = UINT_MAX;
+        for (unsigned int t = triangleStart[copy]; t < triangleStart[copy + 1] && !rejected; ++t)
+        {
+          const unsigned int *tri = &result[triangles[t] * 3];
+          int k = tri[0] == copy ? 0 : (tri[1] == copy ? 1 : 2);
+          unsigned int o1 = tri[(k + 1) % 3];
+          unsigned int o2 = tri[(k + 2) % 3];
+          if (welded[o1] == to || welded[o2] == to)
+          {
+            unsigned int other = welded[o1] == to ? o1 : o2;
+            rejected = partner != UINT_MAX && partner != other;
+            partner = other;
+            ++dying;
+            continue;
+          }
+          const glm::vec3 &p1 = vertices[o1].position;
+          const glm::vec3 &p2 = vertices[o2].position;
+          glm::vec3 before = glm::cross(p1 - source, p2 - source);
+          glm::vec3 after = glm::cross(p1 - target, p2 - target);
+          rejected = glm::dot(before, after) <= 0.0f;
+        }
+        rejected = rejected || partner == UINT_MAX;
+        moves.push_back({copy, partner});
+      }
+      if (rejected)
+        continue;
+
+      for (const auto &move : moves)
+      {
+        collapseTo[move.first] = move.second;
+        for (unsigned int t = triangleStart[move.first]; t < triangleStart[move.first + 1]; ++t)
+        {
+          for (int k = 0; k < 3; ++k)
+          {
+            unsigned int v = welded[result[triangles[t] * 3 + k]];
+            if (state[v] == FREE)
+              state[v] = FROZEN;
+          }
+        }
+      }
+      state[from] = MOVED;
+      state[to] = TOUCHED;
+
+      quadrics[to].add(quadrics[from]);
+      if (collapse.cost > maxError)
+      {
+        maxError = collapse.cost;
+        maxWeight = quadrics[to].weight;
+      }
+      // Triangles around an edge are counted from both sides' vertices,
+      // but each holds exactly one vertex at the moving position
+      removed += dying;
+    }
+    if (removed == 0)
+      break;
+
+    size_t out = 0;
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      unsigned int a = collapseTo[result[i]];
+      unsigned int b = collapseTo[result[i + 1]];
+      unsigned int c = collapseTo[result[i + 2]];
+      if (welded[a] == welded[b] || welded[b] == welded[c] || welded[a] == welded[c])
+        continue;
+      result[out++] = a;
+      result[out++] = b;
+      result[out++] = c;
+    }
+    result.resize(out);
+  }
+
+  // Quadric error is area times squared distance; back to a distance
+  float extent = glm::length(boundsMax - boundsMin);
+  if (error && extent > 0.0f && maxWeight > 0.0)
+    *error = static_cast<float>(std::sqrt(maxError / maxWeight)) / extent;
+  return result;
+}
@@ -0,0 +1,150 @@
+#include <vgl/MeshRegistry.h>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+MeshRegistry::MeshRegistry(size_t memoryCap) : m_memoryCap(memoryCap) {}
+
+std::string MeshRegistry::makeKey(const std::string &path, const OBJLoadOptions &options)
+{
+  std::error_code error;
+  std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+  std::string key = error ? path : canonical.string();
+
+  // Only options that change the uploaded geometry split an asset
+  key += options.optimizeVertexCache ? "|vc" : "|-";
+  key += options.optimizeOverdraw ? "|od" : "|-";
+  key += options.generateNormals ? "|n" + std::to_string(options.creaseAngle) : "|-";
+  key += options.lodCount > 0 ? "|lod" + std::to_string(options.lodCount) + "x" + std::to_string(options.lodReduction)
+                              : "|-";
+  key += options.vertexScalars ? "|s" : "|-";
+  key += options.useCache && options.compressCache ? "|z" : "|-";
+  // Streamed loads build no LODs and duplicate vertices along batch
+  // boundaries, which move with the budget
+  key += options.streamingBudget > 0 ? "|st" + std::to_string(options.streamingBudget) : "|-";
+  return key;
+}
+
+MeshRegistry::Asset *MeshRegistry::lookup(const std::string &key)
+{
+  auto it = m_assets.find(key);
+  if (it == m_assets.end())
+    return nullptr;
+
+  // A load that failed is retried rather than handed out again. A file
+  // with nothing to draw loaded fine and stays.
+  const OBJMesh &mesh = *it->second.mesh;
+  if (!mesh.isLoading() && !mesh.getError().empty())
+  {
+    m_assets.erase(it);
+    return nullptr;
+  }
+
+  it->second.lastUsed = ++m_clock;
+  return &it->second;
+}
+
+std::shared_ptr<OBJMesh> MeshRegistry::load(const std::string &path, const OBJLoadOptions &options)
+{
+  std::string key = makeKey(path, options);
+  if (Asset *asset = lookup(key))
+  {
+    // Finishes an asynchronous load of the asset rather than handing it
+    // out half uploaded
+    std::shared_ptr<OBJMesh> mesh = asset->mesh;
+    if (mesh->isLoading())
+    {
+      if (!mesh->finishLoading())
+      {
+        m_error = mesh->getError();
+        m_assets.erase(key);
+        return nullptr;
+      }
+      trim();
+    }
+    return mesh;
+  }
+
+  auto mesh = std::make_shared<OBJMesh>();
+  if (!mesh->load(path, options))
+  {
+    m_error = mesh->getError();
+    return nullptr;
+  }
+
+  m_assets[key] = Asset{mesh, ++m_clock};
+  trim();
+  return mesh;
+}
+
+std::shared_ptr<OBJMesh> MeshRegistry::loadAsync(const std::string &path, const OBJLoadOptions &options)
+{
+  std::string key = makeKey(path, options);
+  if (Asset *asset = lookup(key))
+    return asset->mesh;
+
+  auto mesh = std::make_shared<OBJMesh>();
+  mesh->loadAsync(path, options);
+
+  m_assets[key] = Asset{mesh, ++m_clock};
+  trim();
+  return mesh;
+}
+
+std::shared_ptr<OBJMesh> MeshRegistry::find(const std::string &path, const OBJLoadOptions &options)
+{
+  Asset *asset = lookup(makeKey(path, options));
+  return asset ? asset->mesh : nullptr;
+}
+
+void MeshRegistry::setMemoryCap(size_t bytes)
+{
+  m_memoryCap = bytes;
+  trim();
+}
+
+size_t MeshRegistry::getResidentBytes() const
+{
+  size_t total = 0;
+  for (const auto &entry : m_assets)
+    total += entry.second.mesh->getGPUBytes();
+  return total;
+}
+
+void MeshRegistry::purge()
+{
+  for (auto it = m_assets.begin(); it != m_assets.end();)
+  {
+    if (it->second.mesh.use_count() == 1)
+      it = m_assets.erase(it);
+    else
+      ++it;
+  }
+}
+
+void MeshRegistry::trim()
+{
+  size_t resident = getResidentBytes();
+  if (resident <= m_memoryCap)
+    return;
+
+  // Only the registry's own reference left
+  std::vector<std::pair<uint64_t, std::string>> candidates;
+  for (const auto &entry : m_assets)
+  {
+    if (entry.second.mesh.use_count() == 1)
+      candidates.emplace_back(entry.second.lastUsed, entry.first);
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  for (const auto &candidate : candidates)
+  {
+    if (resident <= m_memoryCap)
+      break;
+    auto it = m_assets.find(candidate.second);
+    resident -= it->second.mesh->getGPUBytes();
+    m_assets.erase(it);
+  }
+}
@@ -1,7 +1,23 @@
 #include <vgl/OBJMesh.h>
-#include <fstream>
-#include <sstream>
+#include <vgl/MeshOptimize.h>
+#include <vgl/ThreadPool.h>
+#include "ImageFile.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshCodec.h"
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string_view>
 
 static std::string getDirectory(const std::string &path)
 {
@@ -9,66 +25,287 @@ static std::string getDirectory(const std::string &path)
   return (pos == std::string::npos) ? "" : path.substr(0, pos + 1);
 }
 
-static std::vector<std::string> split(const std::string &s, char delim)
+// The parsers below work directly on the mapped file: each line is a
+// [begin, end) range and tokens are string_views into it, so nothing is
+// allocated per line. Whitespace matches what istream extraction skips.
+
+static bool isSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static const char *skipSpace(const char *p, const char *end)
+{
+  while (p < end && isSpace(*p))
+    ++p;
+  return p;
+}
+
+// Returns the next line (without the '\n') and advances cursor past it
+static bool nextLine(const char *&cursor, const char *fileEnd, const char *&lineBegin, const char *&lineEnd)
+{
+  if (cursor >= fileEnd)
+    return false;
+
+  lineBegin = cursor;
+  const char *newline = static_cast<const char *>(std::memchr(cursor, '\n', fileEnd - cursor));
+  lineEnd = newline ? newline : fileEnd;
+  cursor = newline ? newline + 1 : fileEnd;
+  return true;
+}
+
+static std::string_view nextToken(const char *&p, const char *end)
+{
+  p = skipSpace(p, end);
+  const char *begin = p;
+  while (p < end && !isSpace(*p))
+    ++p;
+  return std::string_view(begin, p - begin);
+}
+
+// Parses one whitespace-separated float. Missing or malformed values read as 0.
+static float parseFloat(const char *&p, const char *end)
+{
+  p = skipSpace(p, end);
+  if (p < end && *p == '+')
+    ++p;
+
+  float value = 0.0f;
+#if defined(__cpp_lib_to_chars)
+  auto result = std::from_chars(p, end, value);
+  if (result.ec == std::errc())
+    p = result.ptr;
+  else
+    value = 0.0f;
+#else
+  // strtof needs a terminated string; numbers in OBJ files are short
+  char buffer[64];
+  size_t length = 0;
+  while (p + length < end && !isSpace(p[length]) && length < sizeof(buffer) - 1)
+  {
+    buffer[length] = p[length];
+    ++length;
+  }
+  buffer[length] = '\0';
+  char *parsedEnd = nullptr;
+  value = std::strtof(buffer, &parsedEnd);
+  p += parsedEnd - buffer;
+#endif
+  return value;
+}
+
+// Parses one index field of a face vertex ("12", "-3", or empty in "1//2")
+static int parseIndex(const char *&p, const char *end)
+{
+  if (p < end && *p == '+')
+    ++p;
+
+  int value = 0;
+  auto result = std::from_chars(p, end, value);
+  if (result.ec == std::errc())
+    p = result.ptr;
+  return value;
+}
+
+// File name of a texture map statement ("map_Kd -s 2 2 1 wood.tga"): the
+// rest of the line after any options, so names may contain spaces
+static std::string_view parseMapFile(const char *&p, const char *end)
+{
+  while (true)
+  {
+    p = skipSpace(p, end);
+    if (p >= end || *p != '-')
+      break;
+    std::string_view option = nextToken(p, end);
+    // -o, -s and -t take up to three numbers, every other option one argument
+    if (option == "-o" || option == "-s" || option == "-t")
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        const char *next = skipSpace(p, end);
+        if (next < end && (*next == '-' || *next == '+'))
+          ++next;
+        if (next >= end || !(std::isdigit(static_cast<unsigned char>(*next)) || *next == '.'))
+          break;
+        nextToken(p, end);
+      }
+    }
+    else if (option == "-mm")
+    {
+      nextToken(p, end);
+      nextToken(p, end);
+    }
+    else
+    {
+      nextToken(p, end);
+    }
+  }
+
+  const char *last = end;
+  while (last > p && isSpace(last[-1]))
+    --last;
+  return std::string_view(p, last - p);
+}
+
+struct OBJMesh::TextureLayers
+{
+  int width = 0;
+  int height = 0;
+  size_t layerCount = 0;
+  std::vector<unsigned char> pixels; // RGBA8, layer after layer
+};
+
+struct OBJMesh::Geometry
+{
+  bool ok = false;
+  std::string error;
+  std::vector<SubMesh> subMeshes;
+  OBJLoadStats stats;
+  float lodReduction = 0.5f;
+
+  // Built geometry owns its arrays; a cache hit points into the mapped file
+  std::vector<Vertex> vertexStorage;
+  std::vector<unsigned int> indexStorage;
+  std::vector<unsigned int> positionMap;
+  size_t sourcePositionCount = 0;
+  std::vector<TextureLayers> textures;
+  MappedFile cacheFile;
+  const Vertex *vertices = nullptr;
+  size_t vertexCount = 0;
+  const unsigned int *indices = nullptr;
+  size_t indexCount = 0;
+  // Packed cache hit (MeshCodec data in the mapping); vertices and indices
+  // are null until it is decoded
+  const char *packedVertices = nullptr;
+  size_t packedVertexBytes = 0;
+  const char *packedIndices = nullptr;
+  size_t packedIndexBytes = 0;
+
+  // Upload progress inside the first submesh not yet on the GPU
+  size_t verticesDone = 0;
+  size_t indicesDone = 0;
+};
+
+OBJMesh::~OBJMesh() { cleanup(); }
+
+OBJMesh::OBJMesh(OBJMesh &&other) noexcept
+    : m_subMeshes(std::move(other.m_subMeshes)), m_readyCount(other.m_readyCount), m_mesh(std::move(other.m_mesh)),
+      m_materialBuffer(other.m_materialBuffer), m_materialTexture(other.m_materialTexture),
+      m_instanceBuffer(other.m_instanceBuffer), m_textureArrays(std::move(other.m_textureArrays)),
+      m_textureBytes(other.m_textureBytes), m_loadJob(std::move(other.m_loadJob)), m_upload(std::move(other.m_upload)),
+      m_error(std::move(other.m_error)), m_stats(other.m_stats), m_bounds(other.m_bounds),
+      m_sphere(other.m_sphere), m_lodReduction(other.m_lodReduction),
+      m_positionMap(std::move(other.m_positionMap)), m_sourcePositionCount(other.m_sourcePositionCount)
 {
-  std::vector<std::string> result;
-  std::stringstream ss(s);
-  std::string item;
-  while (std::getline(ss, item, delim))
+  other.m_materialBuffer = other.m_materialTexture = other.m_instanceBuffer = 0;
+  other.m_textureArrays.clear();
+  other.m_textureBytes = 0;
+  other.m_readyCount = 0;
+}
+
+OBJMesh &OBJMesh::operator=(OBJMesh &&other) noexcept
+{
+  if (this != &other)
   {
-    if (!item.empty())
-      result.push_back(item);
+    cleanup();
+    m_subMeshes = std::move(other.m_subMeshes);
+    m_readyCount = other.m_readyCount;
+    m_mesh = std::move(other.m_mesh);
+    m_materialBuffer = other.m_materialBuffer;
+    m_materialTexture = other.m_materialTexture;
+    m_instanceBuffer = other.m_instanceBuffer;
+    m_textureArrays = std::move(other.m_textureArrays);
+    m_textureBytes = other.m_textureBytes;
+    m_loadJob = std::move(other.m_loadJob);
+    m_upload = std::move(other.m_upload);
+    m_error = std::move(other.m_error);
+    m_stats = other.m_stats;
+    m_bounds = other.m_bounds;
+    m_sphere = other.m_sphere;
+    m_lodReduction = other.m_lodReduction;
+    m_positionMap = std::move(other.m_positionMap);
+    m_sourcePositionCount = other.m_sourcePositionCount;
+    other.m_materialBuffer = other.m_materialTexture = other.m_instanceBuffer = 0;
+    other.m_textureArrays.clear();
+    other.m_textureBytes = 0;
+    other.m_readyCount = 0;
   }
-  return result;
+  return *this;
+}
+
+void OBJMesh::cleanup()
+{
+  if (m_materialTexture)
+    glDeleteTextures(1, &m_materialTexture);
+  if (m_materialBuffer)
+    glDeleteBuffers(1, &m_materialBuffer);
+  if (m_instanceBuffer)
+    glDeleteBuffers(1, &m_instanceBuffer);
+  if (!m_textureArrays.empty())
+    glDeleteTextures(static_cast<GLsizei>(m_textureArrays.size()), m_textureArrays.data());
+  m_materialBuffer = m_materialTexture = m_instanceBuffer = 0;
+  m_textureArrays.clear();
+  m_textureBytes = 0;
 }
 
-bool OBJMesh::loadMTL(const std::string &path)
+bool OBJMesh::loadMTL(const std::string &path, std::unordered_map<std::string, Material> &materials)
 {
-  std::ifstream file(path);
-  if (!file.is_open())
+  MappedFile file;
+  if (!file.open(path))
   {
     return false; // MTL file is optional
   }
 
+  std::string directory = getDirectory(path);
   Material *currentMat = nullptr;
-  std::string line;
+  const char *cursor = file.data();
+  const char *fileEnd = cursor + file.size();
+  const char *p;
+  const char *lineEnd;
 
-  while (std::getline(file, line))
+  while (nextLine(cursor, fileEnd, p, lineEnd))
   {
-    // Remove carriage return if present
-    if (!line.empty() && line.back() == '\r')
-    {
-      line.pop_back();
-    }
-
-    std::istringstream iss(line);
-    std::string token;
-    iss >> token;
+    std::string_view token = nextToken(p, lineEnd);
 
     if (token == "newmtl")
     {
-      std::string name;
-      iss >> name;
-      m_materials[name] = Material{name};
-      currentMat = &m_materials[name];
+      std::string name(nextToken(p, lineEnd));
+      currentMat = &materials[name];
+      *currentMat = Material{};
+      currentMat->name = name;
     }
     else if (currentMat)
     {
       if (token == "Kd")
       {
-        iss >> currentMat->diffuse.r >> currentMat->diffuse.g >> currentMat->diffuse.b;
+        currentMat->diffuse.r = parseFloat(p, lineEnd);
+        currentMat->diffuse.g = parseFloat(p, lineEnd);
+        currentMat->diffuse.b = parseFloat(p, lineEnd);
       }
       else if (token == "Ka")
       {
-        iss >> currentMat->ambient.r >> currentMat->ambient.g >> currentMat->ambient.b;
+        currentMat->ambient.r = parseFloat(p, lineEnd);
+        currentMat->ambient.g = parseFloat(p, lineEnd);
+        currentMat->ambient.b = parseFloat(p, lineEnd);
       }
       else if (token == "Ks")
       {
-        iss >> currentMat->specular.r >> currentMat->specular.g >> currentMat->specular.b;
+        currentMat->specular.r = parseFloat(p, lineEnd);
+        currentMat->specular.g = parseFloat(p, lineEnd);
+        currentMat->specular.b = parseFloat(p, lineEnd);
       }
       else if (token == "Ns")
       {
-        iss >> currentMat->shininess;
+        currentMat->shininess = parseFloat(p, lineEnd);
+      }
+      else if (token == "map_Kd")
+      {
+        std::string_view file = parseMapFile(p, lineEnd);
+        if (!file.empty())
+        {
+          bool absolute = file[0] == '/' || file[0] == '\\' || (file.size() > 1 && file[1] == ':');
+          currentMat->diffuseMap = (absolute ? std::string() : directory) + std::string(file);
+        }
       }
     }
   }
@@ -76,217 +313,1577 @@ bool OBJMesh::loadMTL(const std::string &path)
   return true;
 }
 
-bool OBJMesh::load(const std::string &path)
+namespace
 {
-  std::ifstream file(path);
-  if (!file.is_open())
-  {
-    m_error = "Failed to open file: " + path;
-    return false;
-  }
+  // Files are split into chunks of at least this many bytes
+  constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
 
-  std::string directory = getDirectory(path);
+  // A chunk cannot resolve relative (negative) indices on its own since it
+  // does not know how many elements earlier chunks defined. They are stored
+  // as (chunk-local 1-based index - RELATIVE_BIAS), which is always negative,
+  // and rebased by the merge once the chunk offsets are known.
+  constexpr int RELATIVE_BIAS = 1 << 30;
 
-  std::vector<glm::vec3> positions;
-  std::vector<glm::vec3> normals;
-  std::vector<glm::vec2> texCoords;
+  // Position map entry of a vertex whose corner had no position
+  constexpr unsigned int NO_POSITION = 0xFFFFFFFFu;
+  // Vertices per job when scalars are gathered in parallel
+  constexpr size_t SCALAR_GATHER_BATCH = 64 << 10;
 
-  // Faces grouped by material: (materialName, faces)
-  // Each face is 3 vertices, each vertex has 3 indices: position/texcoord/normal
-  std::vector<std::tuple<std::string, std::vector<std::array<int, 9>>>> materialFaces;
-  std::string currentMaterial = "";
+  // Streaming reads at least this much text per batch
+  constexpr size_t MIN_STREAM_BATCH_BYTES = 64 << 10;
+  // Peak heap per byte of face text while a batch is parsed and built
+  // (triangles, corner map, vertices, optimizer tables, and the smoothing
+  // tables and generated normals, which are sized by the batch too)
+  constexpr size_t STREAM_HEAP_PER_TEXT_BYTE = 14;
 
-  std::string line;
-  while (std::getline(file, line))
+  struct FaceGroup
   {
-    // Remove carriage return if present
-    if (!line.empty() && line.back() == '\r')
-    {
-      line.pop_back();
-    }
+    std::string material;
+    // Faces before the chunk's first usemtl belong to the previous group
+    bool continuesPrevious = false;
+    std::vector<std::array<int, 9>> faces;
+  };
 
-    std::istringstream iss(line);
-    std::string token;
-    iss >> token;
+  struct OBJChunk
+  {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<FaceGroup> groups;
+    std::vector<std::string> mtlLibs;
+  };
 
-    if (token == "mtllib")
-    {
-      std::string mtlFile;
-      iss >> mtlFile;
-      loadMTL(directory + mtlFile);
-    }
-    else if (token == "usemtl")
-    {
-      iss >> currentMaterial;
-      // Start a new group for this material
-      materialFaces.push_back({currentMaterial, {}});
-    }
-    else if (token == "v")
-    {
-      glm::vec3 pos;
-      iss >> pos.x >> pos.y >> pos.z;
-      positions.push_back(pos);
-    }
-    else if (token == "vn")
-    {
-      glm::vec3 normal;
-      iss >> normal.x >> normal.y >> normal.z;
-      normals.push_back(normal);
-    }
-    else if (token == "vt")
-    {
-      glm::vec2 uv;
-      iss >> uv.x >> uv.y;
-      texCoords.push_back(uv);
-    }
-    else if (token == "f")
+  int localIndex(int index, size_t count)
+  {
+    if (index < 0)
+      return static_cast<int>(count) + index + 1 - RELATIVE_BIAS;
+    return index;
+  }
+
+  void parseChunk(const char *cursor, const char *chunkEnd, OBJChunk &chunk)
+  {
+    // Reused for every face so polygon lines don't allocate
+    std::vector<std::array<int, 3>> faceVerts;
+
+    const char *p;
+    const char *lineEnd;
+    while (nextLine(cursor, chunkEnd, p, lineEnd))
     {
-      // Parse face - support triangles and quads
-      std::vector<std::array<int, 3>> faceVerts;
-      std::string vertStr;
+      std::string_view token = nextToken(p, lineEnd);
+      if (token.empty())
+        continue;
 
-      while (iss >> vertStr)
+      if (token == "v")
+      {
+        glm::vec3 pos;
+        pos.x = parseFloat(p, lineEnd);
+        pos.y = parseFloat(p, lineEnd);
+        pos.z = parseFloat(p, lineEnd);
+        chunk.positions.push_back(pos);
+      }
+      else if (token == "vn")
+      {
+        glm::vec3 normal;
+        normal.x = parseFloat(p, lineEnd);
+        normal.y = parseFloat(p, lineEnd);
+        normal.z = parseFloat(p, lineEnd);
+        chunk.normals.push_back(normal);
+      }
+      else if (token == "vt")
+      {
+        glm::vec2 uv;
+        uv.x = parseFloat(p, lineEnd);
+        uv.y = parseFloat(p, lineEnd);
+        chunk.texCoords.push_back(uv);
+      }
+      else if (token == "f")
       {
-        std::array<int, 3> indices = {0, 0, 0}; // pos, uv, normal
-        auto parts = split(vertStr, '/');
+        // Parse face - support triangles and quads
+        faceVerts.clear();
 
-        if (parts.size() >= 1 && !parts[0].empty())
+        std::string_view vertStr;
+        while (!(vertStr = nextToken(p, lineEnd)).empty())
         {
-          indices[0] = std::stoi(parts[0]);
+          // pos[/uv[/normal]], any field may be empty
+          std::array<int, 3> indices = {0, 0, 0};
+          const char *q = vertStr.data();
+          const char *qEnd = q + vertStr.size();
+          for (int field = 0; field < 3 && q < qEnd; ++field)
+          {
+            indices[field] = parseIndex(q, qEnd);
+            q = static_cast<const char *>(std::memchr(q, '/', qEnd - q));
+            if (!q)
+              break;
+            ++q;
+          }
+
+          indices[0] = localIndex(indices[0], chunk.positions.size());
+          indices[1] = localIndex(indices[1], chunk.texCoords.size());
+          indices[2] = localIndex(indices[2], chunk.normals.size());
+          faceVerts.push_back(indices);
         }
-        if (parts.size() >= 2 && !parts[1].empty())
+
+        if (chunk.groups.empty())
         {
-          indices[1] = std::stoi(parts[1]);
+          chunk.groups.push_back({"", true, {}});
         }
-        if (parts.size() >= 3 && !parts[2].empty())
+
+        auto &currentFaces = chunk.groups.back().faces;
+
+        // Triangulate: fan triangulation for convex polygons
+        for (size_t i = 1; i + 1 < faceVerts.size(); ++i)
         {
-          indices[2] = std::stoi(parts[2]);
+          std::array<int, 9> tri;
+          // Vertex 0
+          tri[0] = faceVerts[0][0];
+          tri[1] = faceVerts[0][1];
+          tri[2] = faceVerts[0][2];
+          // Vertex 1
+          tri[3] = faceVerts[i][0];
+          tri[4] = faceVerts[i][1];
+          tri[5] = faceVerts[i][2];
+          // Vertex 2
+          tri[6] = faceVerts[i + 1][0];
+          tri[7] = faceVerts[i + 1][1];
+          tri[8] = faceVerts[i + 1][2];
+          currentFaces.push_back(tri);
         }
-
-        faceVerts.push_back(indices);
       }
-
-      // Ensure we have a material group
-      if (materialFaces.empty())
+      else if (token == "usemtl")
       {
-        materialFaces.push_back({"", {}});
+        // Start a new group for this material
+        chunk.groups.push_back({std::string(nextToken(p, lineEnd)), false, {}});
       }
-
-      auto &currentFaces = std::get<1>(materialFaces.back());
-
-      // Triangulate: fan triangulation for convex polygons
-      for (size_t i = 1; i + 1 < faceVerts.size(); ++i)
+      else if (token == "mtllib")
       {
-        std::array<int, 9> tri;
-        // Vertex 0
-        tri[0] = faceVerts[0][0];
-        tri[1] = faceVerts[0][1];
-        tri[2] = faceVerts[0][2];
-        // Vertex 1
-        tri[3] = faceVerts[i][0];
-        tri[4] = faceVerts[i][1];
-        tri[5] = faceVerts[i][2];
-        // Vertex 2
-        tri[6] = faceVerts[i + 1][0];
-        tri[7] = faceVerts[i + 1][1];
-        tri[8] = faceVerts[i + 1][2];
-        currentFaces.push_back(tri);
+        chunk.mtlLibs.emplace_back(nextToken(p, lineEnd));
       }
     }
   }
 
-  if (positions.empty())
+  // Splits [data, data + size) into count ranges that start at line starts
+  std::vector<const char *> chunkBounds(const char *data, size_t size, size_t count)
   {
-    m_error = "No vertices found in file";
-    return false;
+    std::vector<const char *> bounds(count + 1);
+    bounds[0] = data;
+    bounds[count] = data + size;
+    for (size_t i = 1; i < count; ++i)
+    {
+      const char *p = std::max(data + size / count * i, bounds[i - 1]);
+      const char *newline = static_cast<const char *>(std::memchr(p, '\n', data + size - p));
+      bounds[i] = newline ? newline + 1 : data + size;
+    }
+    return bounds;
   }
 
-  buildMeshes(positions, normals, texCoords, materialFaces);
-  return true;
-}
+  template <typename T>
+  void concatenate(std::vector<OBJChunk> &chunks, std::vector<T> OBJChunk::*member,
+                   std::vector<T> &out, ThreadPool &pool)
+  {
+    if (chunks.size() == 1)
+    {
+      out = std::move(chunks[0].*member);
+      return;
+    }
 
-void OBJMesh::buildMeshes(
-    const std::vector<glm::vec3> &positions,
-    const std::vector<glm::vec3> &normals,
-    const std::vector<glm::vec2> &texCoords,
-    const std::vector<std::tuple<std::string, std::vector<std::array<int, 9>>>> &materialFaces)
-{
-  m_subMeshes.clear();
+    std::vector<size_t> offsets(chunks.size() + 1, 0);
+    for (size_t i = 0; i < chunks.size(); ++i)
+      offsets[i + 1] = offsets[i] + (chunks[i].*member).size();
 
-  for (const auto &[matName, faces] : materialFaces)
-  {
-    if (faces.empty())
-      continue;
+    out.resize(offsets.back());
+    pool.parallelFor(chunks.size(), [&](size_t i)
+                     {
+      auto &source = chunks[i].*member;
+      std::copy(source.begin(), source.end(), out.begin() + offsets[i]);
+      source = std::vector<T>(); });
+  }
 
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
+  using FaceList = std::vector<std::array<int, 9>>;
 
-    // For each triangle
-    for (const auto &tri : faces)
+  // Smooth normals for every corner whose normal index is missing. Each
+  // corner gathers the normals of the faces around its position, weighted by
+  // face area and by the face's angle at that position. With a crease angle
+  // below 180 degrees a corner only gathers faces within that angle of its
+  // own face, so a position can end up with several normals.
+  //
+  // Corners are bucketed by position (counting sort), and every position is
+  // then resolved by exactly one task, which is what keeps the gather free of
+  // locks and atomics. The generated normals are appended to normals and the
+  // corners' normal indices patched to point at them, so everything after
+  // this treats them like normals read from the file.
+  void generateNormals(const std::vector<glm::vec3> &positions, std::vector<glm::vec3> &normals,
+                       const std::vector<FaceList *> &faceLists, float creaseAngle)
+  {
+    const size_t normalCount = normals.size();
+    const size_t positionCount = positions.size();
+    auto needsNormal = [&](const std::array<int, 9> &tri, int k)
     {
-      for (int v = 0; v < 3; ++v)
-      {
-        int posIdx = tri[v * 3 + 0];
-        int uvIdx = tri[v * 3 + 1];
-        int normIdx = tri[v * 3 + 2];
+      int position = tri[k * 3];
+      int normal = tri[k * 3 + 2];
+      return position > 0 && static_cast<size_t>(position) <= positionCount &&
+             (normal <= 0 || static_cast<size_t>(normal) > normalCount);
+    };
 
-        Vertex vert;
+    std::vector<size_t> listStart(faceLists.size() + 1, 0);
+    for (size_t i = 0; i < faceLists.size(); ++i)
+      listStart[i + 1] = listStart[i] + faceLists[i]->size();
+    const size_t faceCount = listStart.back();
+    auto faceAt = [&](size_t face) -> std::array<int, 9> &
+    {
+      size_t list = std::upper_bound(listStart.begin(), listStart.end(), face) - listStart.begin() - 1;
+      return (*faceLists[list])[face - listStart[list]];
+    };
 
-        // OBJ indices are 1-based, negative means relative to end
-        if (posIdx > 0)
+    // Corner ids (face * 3 + k) grouped by position
+    std::vector<uint32_t> cornerStart(positionCount + 1, 0);
+    for (const FaceList *faces : faceLists)
+    {
+      for (const auto &tri : *faces)
+      {
+        for (int k = 0; k < 3; ++k)
         {
-          vert.position = positions[posIdx - 1];
+          if (needsNormal(tri, k))
+            ++cornerStart[tri[k * 3]];
         }
-        else if (posIdx < 0)
+      }
+    }
+    for (size_t p = 0; p < positionCount; ++p)
+      cornerStart[p + 1] += cornerStart[p];
+    if (cornerStart[positionCount] == 0)
+      return;
+
+    std::vector<uint32_t> corners(cornerStart[positionCount]);
+    {
+      std::vector<uint32_t> cursor(cornerStart.begin(), cornerStart.end() - 1);
+      size_t face = 0;
+      for (const FaceList *faces : faceLists)
+      {
+        for (const auto &tri : *faces)
         {
-          vert.position = positions[positions.size() + posIdx];
+          for (int k = 0; k < 3; ++k)
+          {
+            if (needsNormal(tri, k))
+              corners[cursor[tri[k * 3] - 1]++] = static_cast<uint32_t>(face * 3 + k);
+          }
+          ++face;
         }
+      }
+    }
+
+    ThreadPool &pool = ThreadPool::shared();
+    auto forBlocks = [&](size_t count, const std::function<void(size_t, size_t)> &body)
+    {
+      size_t blocks = std::min(count, static_cast<size_t>(std::max(1u, pool.getThreadCount())) * 16);
+      pool.parallelFor(blocks, [&](size_t b)
+                       { body(count * b / blocks, count * (b + 1) / blocks); });
+    };
 
-        if (uvIdx > 0 && static_cast<size_t>(uvIdx) <= texCoords.size())
+    // Area-weighted face normals (the cross product's length is twice the area)
+    std::vector<glm::vec3> faceNormals(faceCount);
+    forBlocks(faceCount, [&](size_t begin, size_t end)
+              {
+      for (size_t f = begin; f < end; ++f)
+      {
+        const auto &tri = faceAt(f);
+        glm::vec3 normal(0.0f);
+        if (tri[0] > 0 && tri[3] > 0 && tri[6] > 0 && static_cast<size_t>(std::max({tri[0], tri[3], tri[6]})) <= positionCount)
         {
-          vert.uv = texCoords[uvIdx - 1];
+          const glm::vec3 &p0 = positions[tri[0] - 1];
+          normal = glm::cross(positions[tri[3] - 1] - p0, positions[tri[6] - 1] - p0);
         }
-        else if (uvIdx < 0)
+        faceNormals[f] = normal;
+      } });
+
+    auto contribution = [&](uint32_t corner)
+    {
+      const glm::vec3 &faceNormal = faceNormals[corner / 3];
+      if (faceNormal == glm::vec3(0.0f))
+        return faceNormal;
+
+      const auto &tri = faceAt(corner / 3);
+      int k = corner % 3;
+      const glm::vec3 &p = positions[tri[k * 3] - 1];
+      glm::vec3 e1 = positions[tri[(k + 1) % 3 * 3] - 1] - p;
+      glm::vec3 e2 = positions[tri[(k + 2) % 3 * 3] - 1] - p;
+      float lengths = glm::length(e1) * glm::length(e2);
+      float angle = lengths > 0.0f ? std::acos(glm::clamp(glm::dot(e1, e2) / lengths, -1.0f, 1.0f)) : 0.0f;
+      return faceNormal * angle;
+    };
+
+    // Distinct normal sums at one position, and which one each corner takes.
+    // Sums over the same faces are added in the same order, so corners that
+    // gather the same set compare bit-equal.
+    const bool smooth = creaseAngle >= 180.0f;
+    const float creaseCos = std::cos(glm::radians(creaseAngle));
+    struct Clusters
+    {
+      std::vector<glm::vec3> sums;
+      std::vector<uint32_t> cornerCluster;
+      // Per corner of the position, computed once
+      std::vector<glm::vec3> weighted;
+      std::vector<glm::vec3> unit;
+    };
+    auto cluster = [&](size_t p, Clusters &out)
+    {
+      out.sums.clear();
+      out.cornerCluster.clear();
+      uint32_t first = cornerStart[p];
+      uint32_t count = cornerStart[p + 1] - first;
+      if (count == 0)
+        return;
+
+      out.weighted.resize(count);
+      for (uint32_t i = 0; i < count; ++i)
+        out.weighted[i] = contribution(corners[first + i]);
+
+      if (smooth)
+      {
+        glm::vec3 sum(0.0f);
+        for (uint32_t i = 0; i < count; ++i)
+          sum += out.weighted[i];
+        out.sums.push_back(sum);
+        out.cornerCluster.assign(count, 0);
+        return;
+      }
+
+      out.unit.resize(count);
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        const glm::vec3 &faceNormal = faceNormals[corners[first + i] / 3];
+        float length = glm::length(faceNormal);
+        out.unit[i] = length > 0.0f ? faceNormal / length : glm::vec3(0.0f);
+      }
+
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        glm::vec3 sum(0.0f);
+        for (uint32_t j = 0; j < count; ++j)
         {
-          vert.uv = texCoords[texCoords.size() + uvIdx];
+          if (j == i || glm::dot(out.unit[i], out.unit[j]) >= creaseCos)
+            sum += out.weighted[j];
         }
-        else
+
+        uint32_t id = 0;
+        while (id < out.sums.size() && std::memcmp(&out.sums[id], &sum, sizeof(sum)) != 0)
+          ++id;
+        if (id == out.sums.size())
+          out.sums.push_back(sum);
+        out.cornerCluster.push_back(id);
+      }
+    };
+
+    // Pass 1 counts each position's normals so pass 2 knows where to write
+    std::vector<uint32_t> normalStart(positionCount + 1, 0);
+    forBlocks(positionCount, [&](size_t begin, size_t end)
+              {
+      Clusters clusters;
+      for (size_t p = begin; p < end; ++p)
+      {
+        if (smooth)
         {
-          vert.uv = {0, 0};
+          normalStart[p + 1] = cornerStart[p + 1] > cornerStart[p] ? 1 : 0;
+          continue;
         }
+        cluster(p, clusters);
+        normalStart[p + 1] = static_cast<uint32_t>(clusters.sums.size());
+      } });
+    for (size_t p = 0; p < positionCount; ++p)
+      normalStart[p + 1] += normalStart[p];
 
-        if (normIdx > 0 && static_cast<size_t>(normIdx) <= normals.size())
+    normals.resize(normalCount + normalStart[positionCount]);
+    forBlocks(positionCount, [&](size_t begin, size_t end)
+              {
+      Clusters clusters;
+      for (size_t p = begin; p < end; ++p)
+      {
+        cluster(p, clusters);
+        for (size_t c = 0; c < clusters.sums.size(); ++c)
         {
-          vert.normal = normals[normIdx - 1];
+          float length = glm::length(clusters.sums[c]);
+          normals[normalCount + normalStart[p] + c] = length > 0.0f ? clusters.sums[c] / length : glm::vec3(0, 1, 0);
         }
-        else if (normIdx < 0)
+        for (uint32_t i = cornerStart[p]; i < cornerStart[p + 1]; ++i)
         {
-          vert.normal = normals[normals.size() + normIdx];
+          uint32_t corner = corners[i];
+          uint32_t normal = normalStart[p] + clusters.cornerCluster[i - cornerStart[p]];
+          faceAt(corner / 3)[corner % 3 * 3 + 2] = static_cast<int>(normalCount + normal + 1);
         }
-        else
+      } });
+  }
+
+  // generateNormals for one streamed batch. The faces' position indices are
+  // remapped to a compact range holding just the positions they use, so the
+  // per-position tables and the work scale with the batch rather than with
+  // every position read so far; the original indices are put back after.
+  void generateBatchNormals(const std::vector<glm::vec3> &positions, std::vector<glm::vec3> &normals,
+                            const std::vector<FaceList *> &faceLists, float creaseAngle)
+  {
+    const size_t positionCount = positions.size();
+    auto valid = [&](int position)
+    { return position > 0 && static_cast<size_t>(position) <= positionCount; };
+
+    std::vector<int> original;
+    for (const FaceList *faces : faceLists)
+    {
+      for (const auto &tri : *faces)
+        original.insert(original.end(), {tri[0], tri[3], tri[6]});
+    }
+    std::vector<int> used;
+    used.reserve(original.size());
+    for (int position : original)
+    {
+      if (valid(position))
+        used.push_back(position);
+    }
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+
+    // Local indices are 1-based like the file's; invalid ones become 0
+    for (FaceList *faces : faceLists)
+    {
+      for (auto &tri : *faces)
+      {
+        for (int k = 0; k < 3; ++k)
         {
-          vert.normal = {0, 1, 0}; // default up normal
+          int &position = tri[k * 3];
+          position = valid(position) ? static_cast<int>(std::lower_bound(used.begin(), used.end(), position) - used.begin()) + 1 : 0;
         }
+      }
+    }
+    std::vector<glm::vec3> localPositions(used.size());
+    for (size_t i = 0; i < used.size(); ++i)
+      localPositions[i] = positions[used[i] - 1];
+    used = std::vector<int>();
 
-        indices.push_back(static_cast<unsigned int>(vertices.size()));
-        vertices.push_back(vert);
+    generateNormals(localPositions, normals, faceLists, creaseAngle);
+
+    size_t corner = 0;
+    for (FaceList *faces : faceLists)
+    {
+      for (auto &tri : *faces)
+      {
+        for (int k = 0; k < 3; ++k)
+          tri[k * 3] = original[corner++];
       }
     }
+  }
+}
 
-    SubMesh subMesh;
-    subMesh.mesh.upload(vertices, indices);
+// Options that change the built geometry; a cache only matches the same set
+static uint32_t cacheFlags(const OBJLoadOptions &options)
+{
+  uint32_t flags = (options.optimizeVertexCache ? 1u : 0u) | (options.optimizeOverdraw ? 2u : 0u);
+  // Crease angle in whole degrees from bit 8
+  if (options.generateNormals)
+    flags |= 4u | static_cast<uint32_t>(std::lround(std::clamp(options.creaseAngle, 0.0f, 180.0f))) << 8;
+  // LOD count from bit 16, reduction in percent from bit 24
+  if (options.lodCount > 0)
+  {
+    flags |= std::min(options.lodCount, 255u) << 16 |
+             static_cast<uint32_t>(std::lround(std::clamp(options.lodReduction, 0.0f, 1.0f) * 100.0f)) << 24;
+  }
+  if (options.vertexScalars)
+    flags |= 8u;
+  // A packed cache holds quantized geometry
+  if (options.compressCache)
+    flags |= 16u;
+  return flags;
+}
 
-    // Find material
-    auto it = m_materials.find(matName);
-    if (it != m_materials.end())
+bool OBJMesh::load(const std::string &path, const OBJLoadOptions &options)
+{
+  m_error.clear();
+  auto geometry = std::make_shared<Geometry>();
+  if (options.streamingBudget > 0)
+  {
+    // Only a valid cache beats streaming; streamed results are never cached
+    if (!options.useCache || !loadCache(MeshCache::pathFor(path, options.cacheDir), path, options, *geometry))
+      return loadStreaming(path, options);
+  }
+  else
+  {
+    loadGeometry(path, options, *geometry);
+  }
+
+  if (!geometry->ok)
+  {
+    m_error = geometry->error;
+    return false;
+  }
+  decodeTextures(geometry->subMeshes, geometry->textures, geometry->stats);
+
+  // Replaces any asynchronous load still in flight
+  m_loadJob = {};
+  beginUpload(std::move(geometry));
+  if (m_upload->packedVertices)
+    uploadPacked();
+  uploadPending(SIZE_MAX);
+  return true;
+}
+
+void OBJMesh::loadAsync(const std::string &path, const OBJLoadOptions &options)
+{
+  m_error.clear();
+  m_upload.reset();
+  m_loadJob = ThreadPool::shared().submit([path, options]()
+                                          {
+    auto geometry = std::make_shared<Geometry>();
+    loadGeometry(path, options, *geometry);
+    if (geometry->ok)
     {
-      subMesh.material = it->second;
+      // Decoded here so uploadPending can keep to its budget
+      unpack(*geometry);
+      decodeTextures(geometry->subMeshes, geometry->textures, geometry->stats);
     }
-    else
+    return geometry; });
+}
+
+void OBJMesh::loadGeometry(const std::string &path, const OBJLoadOptions &options, Geometry &geometry)
+{
+  std::string cachePath;
+  if (options.useCache)
+  {
+    cachePath = MeshCache::pathFor(path, options.cacheDir);
+    if (loadCache(cachePath, path, options, geometry))
+      return;
+  }
+
+  MappedFile file;
+  if (!file.open(path))
+  {
+    geometry.error = "Failed to open file: " + path;
+    return;
+  }
+
+  std::string directory = getDirectory(path);
+
+  ThreadPool &pool = ThreadPool::shared();
+  size_t threads = options.threadCount ? options.threadCount : std::max(1u, pool.getThreadCount());
+
+  // Several chunks per thread so uneven sections (vertex block vs face block) balance out
+  size_t chunkCount = 1;
+  if (threads > 1)
+    chunkCount = std::max<size_t>(1, std::min(threads * 4, file.size() / MIN_CHUNK_BYTES));
+
+  std::vector<const char *> bounds = chunkBounds(file.data(), file.size(), chunkCount);
+  std::vector<OBJChunk> chunks(chunkCount);
+
+  if (chunkCount == 1)
+  {
+    parseChunk(bounds[0], bounds[1], chunks[0]);
+  }
+  else
+  {
+    // At most `threads` lanes, each pulling the next unparsed chunk
+    std::atomic<size_t> nextChunk{0};
+    pool.parallelFor(std::min(threads, chunkCount), [&](size_t)
+                     {
+      size_t i;
+      while ((i = nextChunk.fetch_add(1)) < chunkCount)
+        parseChunk(bounds[i], bounds[i + 1], chunks[i]); });
+  }
+
+  // Element counts before each chunk, per attribute (position, uv, normal)
+  std::vector<std::array<int, 3>> chunkOffsets(chunkCount);
+  std::array<size_t, 3> totals = {0, 0, 0};
+  std::vector<std::string> sources = {path};
+  std::unordered_map<std::string, Material> materials;
+  for (size_t i = 0; i < chunkCount; ++i)
+  {
+    chunkOffsets[i] = {static_cast<int>(totals[0]), static_cast<int>(totals[1]), static_cast<int>(totals[2])};
+    totals[0] += chunks[i].positions.size();
+    totals[1] += chunks[i].texCoords.size();
+    totals[2] += chunks[i].normals.size();
+
+    for (const auto &mtlFile : chunks[i].mtlLibs)
     {
-      subMesh.material.name = matName;
+      loadMTL(directory + mtlFile, materials);
+      sources.push_back(directory + mtlFile);
+    }
+  }
+
+  if (totals[0] == 0)
+  {
+    geometry.error = "No vertices found in file";
+    return;
+  }
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> texCoords;
+  concatenate(chunks, &OBJChunk::positions, positions, pool);
+  concatenate(chunks, &OBJChunk::normals, normals, pool);
+  concatenate(chunks, &OBJChunk::texCoords, texCoords, pool);
+
+  // Faces grouped by material: (materialName, faces)
+  // Each face is 3 vertices, each vertex has 3 indices: position/texcoord/normal
+  std::vector<std::tuple<std::string, std::vector<std::array<int, 9>>>> materialFaces;
+
+  // Lay out every chunk group inside its destination group, in file order,
+  // then copy and rebase relative indices in parallel
+  struct Placement
+  {
+    size_t group;
+    size_t offset;
+  };
+  std::vector<std::vector<Placement>> placements(chunkCount);
+  std::vector<size_t> groupSizes;
+  for (size_t i = 0; i < chunkCount; ++i)
+  {
+    for (const auto &group : chunks[i].groups)
+    {
+      if (!group.continuesPrevious || materialFaces.empty())
+      {
+        materialFaces.push_back({group.material, {}});
+        groupSizes.push_back(0);
+      }
+      placements[i].push_back({materialFaces.size() - 1, groupSizes.back()});
+      groupSizes.back() += group.faces.size();
     }
+  }
+  for (size_t g = 0; g < materialFaces.size(); ++g)
+    std::get<1>(materialFaces[g]).resize(groupSizes[g]);
 
-    m_subMeshes.push_back(std::move(subMesh));
+  pool.parallelFor(chunkCount, [&](size_t i)
+                   {
+    const std::array<int, 3> &offset = chunkOffsets[i];
+    for (size_t g = 0; g < chunks[i].groups.size(); ++g)
+    {
+      auto &source = chunks[i].groups[g].faces;
+      auto dest = std::get<1>(materialFaces[placements[i][g].group]).begin() + placements[i][g].offset;
+      for (const auto &tri : source)
+      {
+        std::array<int, 9> resolved = tri;
+        for (int k = 0; k < 9; ++k)
+        {
+          if (resolved[k] < 0)
+            resolved[k] += RELATIVE_BIAS + offset[k % 3];
+        }
+        *dest++ = resolved;
+      }
+      source = std::vector<std::array<int, 9>>();
+    } });
+
+  if (options.generateNormals)
+  {
+    std::vector<FaceList *> faceLists;
+    for (auto &group : materialFaces)
+      faceLists.push_back(&std::get<1>(group));
+    generateNormals(positions, normals, faceLists, options.creaseAngle);
+  }
+
+  buildMeshes(positions, normals, texCoords, materialFaces, materials, options, cachePath, sources, geometry);
+  geometry.ok = true;
+}
+
+bool OBJMesh::loadCache(const std::string &cachePath, const std::string &source, const OBJLoadOptions &options,
+                        Geometry &geometry)
+{
+  MeshCache::Contents contents;
+  if (!MeshCache::read(cachePath, source, cacheFlags(options), geometry.cacheFile, contents))
+    return false;
+
+  // Uploaded straight from the mapping, which the Geometry keeps open
+  geometry.subMeshes = std::move(contents.subMeshes);
+  geometry.vertices = contents.vertices;
+  geometry.vertexCount = contents.vertexCount;
+  geometry.indices = contents.indices;
+  geometry.indexCount = contents.indexCount;
+  geometry.packedVertices = contents.packedVertices;
+  geometry.packedVertexBytes = contents.packedVertexBytes;
+  geometry.packedIndices = contents.packedIndices;
+  geometry.packedIndexBytes = contents.packedIndexBytes;
+  geometry.lodReduction = options.lodReduction;
+  geometry.positionMap.assign(contents.positionMap, contents.positionMap + (contents.positionMap ? contents.vertexCount : 0));
+  geometry.sourcePositionCount = contents.sourcePositionCount;
+
+  // The index data also holds the LOD levels
+  for (const auto &subMesh : geometry.subMeshes)
+    geometry.stats.triangleCount += subMesh.indexCount / 3;
+  geometry.stats.vertexCount = contents.vertexCount;
+  geometry.stats.acmrBefore = contents.acmrBefore;
+  geometry.stats.acmrAfter = contents.acmrAfter;
+  geometry.ok = true;
+  return true;
+}
+
+namespace
+{
+  // Open-addressing (linear probing) map from a corner's (pos, uv, normal)
+  // index triple to its vertex index. Slots are 16 bytes and the table stays
+  // at most half full, doubling as it grows.
+  class CornerMap
+  {
+  public:
+    explicit CornerMap(size_t expected)
+    {
+      size_t capacity = 64;
+      while (capacity < expected * 2)
+        capacity *= 2;
+      m_slots.assign(capacity, Slot{{0, 0, 0}, EMPTY});
+    }
+
+    // Returns the existing vertex index for key, or inserts next and returns it
+    unsigned int findOrInsert(const std::array<int, 3> &key, unsigned int next)
+    {
+      if ((m_count + 1) * 2 > m_slots.size())
+        grow();
+
+      size_t mask = m_slots.size() - 1;
+      for (size_t i = hash(key) & mask;; i = (i + 1) & mask)
+      {
+        Slot &slot = m_slots[i];
+        if (slot.value == EMPTY)
+        {
+          slot.key = key;
+          slot.value = next;
+          ++m_count;
+          return next;
+        }
+        if (slot.key == key)
+          return slot.value;
+      }
+    }
+
+  private:
+    static constexpr unsigned int EMPTY = 0xFFFFFFFFu;
+
+    struct Slot
+    {
+      std::array<int, 3> key;
+      unsigned int value;
+    };
+
+    static size_t hash(const std::array<int, 3> &key)
+    {
+      uint64_t h = static_cast<uint32_t>(key[0]) * 0x9E3779B97F4A7C15ull;
+      h ^= static_cast<uint32_t>(key[1]) * 0xC2B2AE3D27D4EB4Full;
+      h ^= static_cast<uint32_t>(key[2]) * 0x165667B19E3779F9ull;
+      return static_cast<size_t>(h ^ (h >> 29));
+    }
+
+    void grow()
+    {
+      std::vector<Slot> old(m_slots.size() * 2, Slot{{0, 0, 0}, EMPTY});
+      old.swap(m_slots);
+
+      size_t mask = m_slots.size() - 1;
+      for (const Slot &slot : old)
+      {
+        if (slot.value == EMPTY)
+          continue;
+        size_t i = hash(slot.key) & mask;
+        while (m_slots[i].value != EMPTY)
+          i = (i + 1) & mask;
+        m_slots[i] = slot;
+      }
+    }
+
+    std::vector<Slot> m_slots;
+    size_t m_count = 0;
+  };
+
+  struct BuiltGroup
+  {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<std::vector<unsigned int>> lods;
+    std::vector<unsigned int> positionMap; // with OBJLoadOptions::vertexScalars
+    AABB bounds;
+    BoundingSphere sphere;
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+  };
+
+  // Deduplicates one material group's corners into an indexed vertex list,
+  // applies the optimization passes selected in options, measures its
+  // bounds and simplifies it into the LOD chain
+  void buildGroup(const std::vector<std::array<int, 9>> &faces,
+                  const std::vector<glm::vec3> &positions,
+                  const std::vector<glm::vec3> &normals,
+                  const std::vector<glm::vec2> &texCoords,
+                  const OBJLoadOptions &options,
+                  BuiltGroup &built)
+  {
+    if (faces.empty())
+      return;
+
+    std::vector<Vertex> &vertices = built.vertices;
+    std::vector<unsigned int> &indices = built.indices;
+    indices.reserve(faces.size() * 3);
+    // Closed meshes share each vertex between ~6 corners
+    CornerMap corners(faces.size() / 2);
+
+    // For each triangle
+    for (const auto &tri : faces)
+    {
+      for (int v = 0; v < 3; ++v)
+      {
+        int posIdx = tri[v * 3 + 0];
+        int uvIdx = tri[v * 3 + 1];
+        int normIdx = tri[v * 3 + 2];
+
+        // Indices were made absolute while parsing; out of range means absent
+        if (posIdx <= 0 || static_cast<size_t>(posIdx) > positions.size())
+          posIdx = 0;
+        if (uvIdx <= 0 || static_cast<size_t>(uvIdx) > texCoords.size())
+          uvIdx = 0;
+        if (normIdx <= 0 || static_cast<size_t>(normIdx) > normals.size())
+          normIdx = 0;
+
+        unsigned int next = static_cast<unsigned int>(vertices.size());
+        unsigned int index = corners.findOrInsert({posIdx, uvIdx, normIdx}, next);
+        indices.push_back(index);
+        if (index != next)
+          continue;
+
+        Vertex vert;
+        vert.position = posIdx ? positions[posIdx - 1] : glm::vec3(0, 0, 0);
+        vert.uv = uvIdx ? texCoords[uvIdx - 1] : glm::vec2(0, 0);
+        vert.normal = normIdx ? normals[normIdx - 1] : glm::vec3(0, 1, 0); // default up normal
+        vertices.push_back(vert);
+        if (options.vertexScalars)
+          built.positionMap.push_back(posIdx ? static_cast<unsigned int>(posIdx - 1) : NO_POSITION);
+      }
+    }
+
+    built.acmrBefore = built.acmrAfter = MeshOptimize::computeACMR(indices, vertices.size());
+    if (options.optimizeVertexCache)
+      MeshOptimize::vertexCache(indices, vertices.size());
+    if (options.optimizeOverdraw)
+      MeshOptimize::overdraw(indices, vertices);
+    if (options.optimizeVertexCache || options.optimizeOverdraw)
+    {
+      MeshOptimize::vertexFetch(vertices, indices, options.vertexScalars ? &built.positionMap : nullptr);
+      built.acmrAfter = MeshOptimize::computeACMR(indices, vertices.size());
+    }
+    built.bounds = AABB::fromVertices(vertices.data(), vertices.size());
+    built.sphere = BoundingSphere::fromVertices(vertices.data(), vertices.size(), built.bounds);
+
+    // Each level simplifies the one before, which is much cheaper than
+    // starting over from the full mesh
+    for (unsigned int level = 0; level < options.lodCount; ++level)
+    {
+      const std::vector<unsigned int> &previous = level == 0 ? indices : built.lods.back();
+      size_t target = static_cast<size_t>(previous.size() / 3 * options.lodReduction) * 3;
+      std::vector<unsigned int> lod = MeshOptimize::simplify(previous, vertices, target);
+      // Mostly seams and borders left: more levels would just repeat this one
+      if (lod.empty() || lod.size() * 10 > previous.size() * 9)
+        break;
+      if (options.optimizeVertexCache)
+        MeshOptimize::vertexCache(lod, vertices.size());
+      built.lods.push_back(std::move(lod));
+    }
+  }
+}
+
+void OBJMesh::buildMeshes(
+    const std::vector<glm::vec3> &positions,
+    const std::vector<glm::vec3> &normals,
+    const std::vector<glm::vec2> &texCoords,
+    const std::vector<std::tuple<std::string, std::vector<std::array<int, 9>>>> &materialFaces,
+    const std::unordered_map<std::string, Material> &materials,
+    const OBJLoadOptions &options,
+    const std::string &cachePath,
+    const std::vector<std::string> &sources,
+    Geometry &geometry)
+{
+  std::vector<SubMesh> &subMeshes = geometry.subMeshes;
+  OBJLoadStats &stats = geometry.stats;
+
+  std::vector<BuiltGroup> built(materialFaces.size());
+
+  // Groups are independent, so they are deduplicated and simplified in parallel
+  ThreadPool::shared().parallelFor(materialFaces.size(), [&](size_t g)
+                                   { buildGroup(std::get<1>(materialFaces[g]), positions, normals, texCoords, options, built[g]); });
+
+  // Pack the groups back to back into one vertex and one index buffer.
+  // Indices stay local to each group and are offset by its base vertex.
+  // A group's LOD levels follow its own indices.
+  std::vector<size_t> slot(materialFaces.size());
+  size_t vertexTotal = 0;
+  size_t indexTotal = 0;
+  size_t triangleTotal = 0;
+  for (size_t g = 0; g < materialFaces.size(); ++g)
+  {
+    if (built[g].indices.empty())
+      continue;
+
+    const std::string &matName = std::get<0>(materialFaces[g]);
+
+    SubMesh subMesh;
+    subMesh.indexOffset = indexTotal;
+    subMesh.indexCount = built[g].indices.size();
+    subMesh.baseVertex = static_cast<int>(vertexTotal);
+    subMesh.vertexCount = built[g].vertices.size();
+    subMesh.bounds = built[g].bounds;
+    subMesh.sphere = built[g].sphere;
+
+    // Find material
+    auto it = materials.find(matName);
+    if (it != materials.end())
+    {
+      subMesh.material = it->second;
+    }
+    else
+    {
+      subMesh.material.name = matName;
+    }
+
+    vertexTotal += subMesh.vertexCount;
+    indexTotal += subMesh.indexCount;
+    triangleTotal += subMesh.indexCount / 3;
+    for (const auto &lod : built[g].lods)
+    {
+      subMesh.lods.push_back({indexTotal, lod.size()});
+      indexTotal += lod.size();
+    }
+    stats.acmrBefore += built[g].acmrBefore * (subMesh.indexCount / 3);
+    stats.acmrAfter += built[g].acmrAfter * (subMesh.indexCount / 3);
+    slot[g] = subMeshes.size();
+    subMeshes.push_back(std::move(subMesh));
+  }
+
+  std::vector<Vertex> &vertices = geometry.vertexStorage;
+  std::vector<unsigned int> &indices = geometry.indexStorage;
+  vertices.resize(vertexTotal);
+  indices.resize(indexTotal);
+  if (options.vertexScalars)
+    geometry.positionMap.resize(vertexTotal);
+  geometry.sourcePositionCount = positions.size();
+  ThreadPool::shared().parallelFor(materialFaces.size(), [&](size_t g)
+                                   {
+    if (built[g].indices.empty())
+      return;
+    const SubMesh &subMesh = subMeshes[slot[g]];
+    std::copy(built[g].vertices.begin(), built[g].vertices.end(), vertices.begin() + subMesh.baseVertex);
+    std::copy(built[g].positionMap.begin(), built[g].positionMap.end(), geometry.positionMap.begin() + subMesh.baseVertex);
+    std::copy(built[g].indices.begin(), built[g].indices.end(), indices.begin() + subMesh.indexOffset);
+    for (size_t level = 0; level < subMesh.lods.size(); ++level)
+      std::copy(built[g].lods[level].begin(), built[g].lods[level].end(), indices.begin() + subMesh.lods[level].indexOffset);
+    built[g] = BuiltGroup{}; });
+
+  geometry.vertices = vertices.data();
+  geometry.vertexCount = vertices.size();
+  geometry.indices = indices.data();
+  geometry.indexCount = indices.size();
+  geometry.lodReduction = options.lodReduction;
+
+  stats.triangleCount = triangleTotal;
+  stats.vertexCount = vertexTotal;
+  if (stats.triangleCount > 0)
+  {
+    stats.acmrBefore /= stats.triangleCount;
+    stats.acmrAfter /= stats.triangleCount;
+  }
+
+  // A failed write only costs the next load a re-parse
+  if (!cachePath.empty())
+  {
+    MeshCache::Contents contents{subMeshes, vertices.data(), vertices.size(), indices.data(), indices.size(),
+                                 stats.acmrBefore, stats.acmrAfter};
+    contents.positionMap = geometry.positionMap.empty() ? nullptr : geometry.positionMap.data();
+    contents.sourcePositionCount = geometry.sourcePositionCount;
+    MeshCache::write(cachePath, sources, cacheFlags(options), contents, options.compressCache);
+  }
+}
+
+bool OBJMesh::loadStreaming(const std::string &path, const OBJLoadOptions &options)
+{
+  MappedFile file;
+  if (!file.open(path))
+  {
+    m_error = "Failed to open file: " + path;
+    return false;
+  }
+
+  std::string directory = getDirectory(path);
+  std::unordered_map<std::string, Material> materials;
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> texCoords;
+
+  // Built off to the side so a failed load leaves the current mesh alone
+  Mesh mesh;
+  std::vector<SubMesh> subMeshes;
+  std::vector<unsigned int> positionMap;
+  OBJLoadStats stats;
+  size_t vertexTotal = 0;
+  size_t indexTotal = 0;
+
+  // The current usemtl run. A run spanning several batches stays one
+  // submesh, so the result matches the regular loader's grouping.
+  std::string runMaterial;
+  bool runOpen = false;
+  bool runHasSubMesh = false;
+
+  // A batch only holds part of a submesh, so there is nothing whole to simplify
+  OBJLoadOptions batchOptions = options;
+  batchOptions.lodCount = 0;
+
+  size_t batchBytes = std::max(MIN_STREAM_BATCH_BYTES, options.streamingBudget / STREAM_HEAP_PER_TEXT_BYTE);
+  const char *cursor = file.data();
+  const char *fileEnd = cursor + file.size();
+  while (cursor < fileEnd)
+  {
+    const char *batchEnd = fileEnd;
+    if (static_cast<size_t>(fileEnd - cursor) > batchBytes)
+    {
+      const char *newline = static_cast<const char *>(std::memchr(cursor + batchBytes, '\n', fileEnd - cursor - batchBytes));
+      batchEnd = newline ? newline + 1 : fileEnd;
+    }
+
+    OBJChunk chunk;
+    parseChunk(cursor, batchEnd, chunk);
+    cursor = batchEnd;
+
+    // Same rebasing as the parallel merge, against everything read so far
+    const std::array<int, 3> offset = {static_cast<int>(positions.size()), static_cast<int>(texCoords.size()),
+                                       static_cast<int>(normals.size())};
+    positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+    texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+    normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+    for (const auto &mtlFile : chunk.mtlLibs)
+      loadMTL(directory + mtlFile, materials);
+
+    std::vector<FaceList *> faceLists;
+    for (auto &group : chunk.groups)
+    {
+      for (auto &tri : group.faces)
+      {
+        for (int k = 0; k < 9; ++k)
+        {
+          if (tri[k] < 0)
+            tri[k] += RELATIVE_BIAS + offset[k % 3];
+        }
+      }
+      faceLists.push_back(&group.faces);
+    }
+
+    // Generated normals only live until the batch is built, so smoothing
+    // does not reach across batch boundaries
+    size_t fileNormalCount = normals.size();
+    if (options.generateNormals)
+      generateBatchNormals(positions, normals, faceLists, options.creaseAngle);
+
+    for (auto &group : chunk.groups)
+    {
+      if (!group.continuesPrevious || !runOpen)
+      {
+        runMaterial = group.material;
+        runOpen = true;
+        runHasSubMesh = false;
+      }
+      if (group.faces.empty())
+        continue;
+
+      BuiltGroup built;
+      buildGroup(group.faces, positions, normals, texCoords, batchOptions, built);
+      group.faces = std::vector<std::array<int, 9>>();
+
+      if (!runHasSubMesh)
+      {
+        SubMesh subMesh;
+        subMesh.indexOffset = indexTotal;
+        subMesh.baseVertex = static_cast<int>(vertexTotal);
+        auto it = materials.find(runMaterial);
+        if (it != materials.end())
+          subMesh.material = it->second;
+        else
+          subMesh.material.name = runMaterial;
+        subMeshes.push_back(std::move(subMesh));
+        runHasSubMesh = true;
+      }
+      else
+      {
+        // Indices of the run's submesh are relative to its first vertex
+        unsigned int rebase = static_cast<unsigned int>(vertexTotal - subMeshes.back().baseVertex);
+        for (auto &index : built.indices)
+          index += rebase;
+      }
+      SubMesh &subMesh = subMeshes.back();
+      subMesh.vertexCount += built.vertices.size();
+      subMesh.indexCount += built.indices.size();
+      subMesh.bounds.expand(built.bounds);
+
+      // Geometric growth keeps the GPU-side copies amortized
+      size_t vertexCapacity = mesh.getVertexCapacity();
+      size_t indexCapacity = mesh.getIndexCapacity();
+      if (vertexTotal + built.vertices.size() > vertexCapacity)
+        vertexCapacity = std::max(vertexTotal + built.vertices.size(), vertexCapacity + vertexCapacity / 2);
+      if (indexTotal + built.indices.size() > indexCapacity)
+        indexCapacity = std::max(indexTotal + built.indices.size(), indexCapacity + indexCapacity / 2);
+      if (vertexCapacity != mesh.getVertexCapacity() || indexCapacity != mesh.getIndexCapacity())
+        mesh.resize(vertexCapacity, indexCapacity);
+      mesh.uploadRange(vertexTotal, built.vertices.data(), built.vertices.size(),
+                       indexTotal, built.indices.data(), built.indices.size());
+      positionMap.insert(positionMap.end(), built.positionMap.begin(), built.positionMap.end());
+
+      size_t triangles = built.indices.size() / 3;
+      stats.acmrBefore += built.acmrBefore * triangles;
+      stats.acmrAfter += built.acmrAfter * triangles;
+      vertexTotal += built.vertices.size();
+      indexTotal += built.indices.size();
+    }
+    normals.resize(fileNormalCount);
+  }
+
+  if (positions.empty())
+  {
+    m_error = "No vertices found in file";
+    return false;
+  }
+
+  // Drop the growth slack
+  mesh.resize(vertexTotal, indexTotal);
+
+  // The vertices are gone by now, so spheres only enclose the boxes
+  for (auto &subMesh : subMeshes)
+    subMesh.sphere = BoundingSphere::around(subMesh.bounds);
+
+  stats.triangleCount = indexTotal / 3;
+  stats.vertexCount = vertexTotal;
+  if (stats.triangleCount > 0)
+  {
+    stats.acmrBefore /= stats.triangleCount;
+    stats.acmrAfter /= stats.triangleCount;
+  }
+  std::vector<TextureLayers> textures;
+  decodeTextures(subMeshes, textures, stats);
+
+  m_loadJob = {};
+  m_upload.reset();
+  m_mesh = std::move(mesh);
+  m_subMeshes = std::move(subMeshes);
+  m_readyCount = m_subMeshes.size();
+  m_stats = stats;
+  updateBounds();
+  m_lodReduction = options.lodReduction;
+  m_positionMap = std::move(positionMap);
+  m_sourcePositionCount = positions.size();
+  uploadTextures(textures);
+  uploadMaterials();
+  return true;
+}
+
+void OBJMesh::beginUpload(std::shared_ptr<Geometry> geometry)
+{
+  m_subMeshes = std::move(geometry->subMeshes);
+  m_stats = geometry->stats;
+  updateBounds();
+  m_lodReduction = geometry->lodReduction;
+  m_positionMap = std::move(geometry->positionMap);
+  m_sourcePositionCount = geometry->sourcePositionCount;
+  m_readyCount = 0;
+  m_mesh.allocate(geometry->vertexCount, geometry->indexCount);
+  uploadTextures(geometry->textures);
+  uploadMaterials();
+  m_upload = std::move(geometry);
+}
+
+void OBJMesh::unpack(Geometry &geometry)
+{
+  if (!geometry.packedVertices)
+    return;
+
+  geometry.vertexStorage.resize(geometry.vertexCount);
+  geometry.indexStorage.resize(geometry.indexCount);
+  MeshCodec::decodeVertices(geometry.packedVertices, geometry.packedVertexBytes, geometry.vertexStorage.data(),
+                            geometry.vertexCount);
+  MeshCodec::decodeIndices(geometry.packedIndices, geometry.packedIndexBytes, geometry.indexStorage.data(),
+                           geometry.indexCount);
+  geometry.vertices = geometry.vertexStorage.data();
+  geometry.indices = geometry.indexStorage.data();
+  geometry.packedVertices = geometry.packedIndices = nullptr;
+  geometry.cacheFile.close();
+}
+
+void OBJMesh::uploadPacked()
+{
+  Geometry &geometry = *m_upload;
+  Vertex *vertices;
+  unsigned int *indices;
+  if (m_mesh.mapStorage(vertices, indices))
+  {
+    MeshCodec::decodeVertices(geometry.packedVertices, geometry.packedVertexBytes, vertices, geometry.vertexCount);
+    MeshCodec::decodeIndices(geometry.packedIndices, geometry.packedIndexBytes, indices, geometry.indexCount);
+    if (m_mesh.unmapStorage())
+    {
+      m_readyCount = m_subMeshes.size();
+      m_upload.reset();
+      return;
+    }
+  }
+  unpack(geometry);
+}
+
+bool OBJMesh::finishLoading()
+{
+  if (m_loadJob.valid())
+    m_loadJob.wait();
+  uploadPending(SIZE_MAX);
+  return m_error.empty();
+}
+
+size_t OBJMesh::uploadPending(size_t byteBudget)
+{
+  if (m_loadJob.valid())
+  {
+    if (m_loadJob.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      return 0;
+
+    std::shared_ptr<Geometry> geometry = m_loadJob.get();
+    if (!geometry->ok)
+    {
+      m_error = geometry->error;
+      return 0;
+    }
+    beginUpload(std::move(geometry));
+  }
+  if (!m_upload)
+    return 0;
+
+  // Submeshes are packed in order, so each one becomes drawable once its
+  // vertex range and then its index range (LOD levels included) are fully
+  // copied
+  Geometry &geometry = *m_upload;
+  size_t uploaded = 0;
+  while (m_readyCount < m_subMeshes.size())
+  {
+    const SubMesh &subMesh = m_subMeshes[m_readyCount];
+    size_t indexSpan = subMesh.lods.empty() ? subMesh.indexCount
+                                            : subMesh.lods.back().indexOffset + subMesh.lods.back().indexCount -
+                                                  subMesh.indexOffset;
+    size_t room = byteBudget - uploaded;
+    size_t vertexCount = std::min(subMesh.vertexCount - geometry.verticesDone, room / sizeof(Vertex));
+    room -= vertexCount * sizeof(Vertex);
+    size_t indexCount = 0;
+    if (geometry.verticesDone + vertexCount == subMesh.vertexCount)
+      indexCount = std::min(indexSpan - geometry.indicesDone, room / sizeof(unsigned int));
+    if (vertexCount == 0 && indexCount == 0)
+      break;
+
+    size_t firstVertex = subMesh.baseVertex + geometry.verticesDone;
+    size_t firstIndex = subMesh.indexOffset + geometry.indicesDone;
+    m_mesh.uploadRange(firstVertex, geometry.vertices + firstVertex, vertexCount,
+                       firstIndex, geometry.indices + firstIndex, indexCount);
+    uploaded += vertexCount * sizeof(Vertex) + indexCount * sizeof(unsigned int);
+    geometry.verticesDone += vertexCount;
+    geometry.indicesDone += indexCount;
+
+    if (geometry.indicesDone == indexSpan)
+    {
+      ++m_readyCount;
+      geometry.verticesDone = geometry.indicesDone = 0;
+    }
+  }
+
+  // Done: drop the CPU copy (or unmap the cache file)
+  if (m_readyCount == m_subMeshes.size())
+    m_upload.reset();
+  return uploaded;
+}
+
+void OBJMesh::updateBounds()
+{
+  m_bounds = AABB{};
+  for (const auto &subMesh : m_subMeshes)
+    m_bounds.expand(subMesh.bounds);
+
+  // Around the box center, reaching the far side of every submesh sphere
+  m_sphere = BoundingSphere{};
+  if (m_bounds.isEmpty())
+    return;
+  m_sphere.center = m_bounds.getCenter();
+  m_sphere.radius = 0.0f;
+  for (const auto &subMesh : m_subMeshes)
+  {
+    if (!subMesh.sphere.isEmpty())
+      m_sphere.radius = std::max(m_sphere.radius, glm::length(subMesh.sphere.center - m_sphere.center) + subMesh.sphere.radius);
+  }
+}
+
+void OBJMesh::decodeTextures(std::vector<SubMesh> &subMeshes, std::vector<TextureLayers> &arrays,
+                             OBJLoadStats &stats)
+{
+  arrays.clear();
+  stats.textureCount = stats.textureFailures = stats.texturesResized = 0;
+  stats.textureMessages.clear();
+
+  // Distinct images in order of first use; materials often share one
+  std::vector<std::string> paths;
+  std::unordered_map<std::string, size_t> pathIndex;
+  for (auto &subMesh : subMeshes)
+  {
+    subMesh.textureArray = -1;
+    subMesh.textureLayer = 0;
+    if (!subMesh.material.diffuseMap.empty() && pathIndex.emplace(subMesh.material.diffuseMap, paths.size()).second)
+      paths.push_back(subMesh.material.diffuseMap);
+  }
+  if (paths.empty())
+    return;
+
+  std::vector<ImageFile::Image> images(paths.size());
+  std::vector<std::string> errors(paths.size());
+  ThreadPool::shared().parallelFor(paths.size(), [&](size_t i)
+                                   { ImageFile::read(paths[i], images[i], errors[i]); });
+
+  // One array per size, the sizes with the most images first. Past
+  // MAX_TEXTURE_ARRAYS the remaining images join the first array.
+  std::map<std::pair<int, int>, std::vector<size_t>> bySize;
+  for (size_t i = 0; i < images.size(); ++i)
+  {
+    if (images[i].pixels.empty())
+    {
+      ++stats.textureFailures;
+      stats.textureMessages.push_back(errors[i]); // already "<path>: <reason>"
+      continue;
+    }
+    ++stats.textureCount;
+    bySize[{images[i].width, images[i].height}].push_back(i);
+  }
+  if (bySize.empty())
+    return;
+
+  std::vector<std::vector<size_t>> groups;
+  for (auto &entry : bySize)
+    groups.push_back(std::move(entry.second));
+  std::stable_sort(groups.begin(), groups.end(), [](const std::vector<size_t> &a, const std::vector<size_t> &b)
+                   { return a.size() > b.size(); });
+  for (size_t g = MAX_TEXTURE_ARRAYS; g < groups.size(); ++g)
+    groups[0].insert(groups[0].end(), groups[g].begin(), groups[g].end());
+  groups.resize(std::min(groups.size(), MAX_TEXTURE_ARRAYS));
+
+  for (size_t i : groups[0])
+  {
+    const ImageFile::Image &image = images[i];
+    const ImageFile::Image &first = images[groups[0].front()];
+    if (image.width == first.width && image.height == first.height)
+      continue;
+    ++stats.texturesResized;
+    stats.textureMessages.push_back(paths[i] + ": resized from " + std::to_string(image.width) + "x" +
+                                    std::to_string(image.height) + " to " + std::to_string(first.width) + "x" +
+                                    std::to_string(first.height) + " (more than " +
+                                    std::to_string(MAX_TEXTURE_ARRAYS) + " image sizes)");
+  }
+
+  constexpr size_t NO_LAYER = ~size_t(0);
+  std::vector<size_t> imageArray(images.size(), NO_LAYER);
+  std::vector<size_t> imageLayer(images.size(), 0);
+  arrays.resize(groups.size());
+  for (size_t g = 0; g < groups.size(); ++g)
+  {
+    const ImageFile::Image &first = images[groups[g].front()];
+    TextureLayers &array = arrays[g];
+    array.width = first.width;
+    array.height = first.height;
+    array.layerCount = groups[g].size();
+    array.pixels.resize(array.layerCount * array.width * array.height * 4);
+    for (size_t layer = 0; layer < groups[g].size(); ++layer)
+    {
+      imageArray[groups[g][layer]] = g;
+      imageLayer[groups[g][layer]] = layer;
+    }
+  }
+
+  // Copied into place in parallel too, since an image may need resizing
+  ThreadPool::shared().parallelFor(images.size(), [&](size_t i)
+                                   {
+    if (imageArray[i] == NO_LAYER)
+      return;
+    TextureLayers &array = arrays[imageArray[i]];
+    ImageFile::Image &image = images[i];
+    if (image.width != array.width || image.height != array.height)
+      image = ImageFile::resized(image, array.width, array.height);
+    std::copy(image.pixels.begin(), image.pixels.end(), array.pixels.begin() + imageLayer[i] * image.pixels.size());
+    image = ImageFile::Image{}; });
+
+  for (auto &subMesh : subMeshes)
+  {
+    if (subMesh.material.diffuseMap.empty())
+      continue;
+    size_t image = pathIndex[subMesh.material.diffuseMap];
+    if (imageArray[image] == NO_LAYER)
+      continue;
+    subMesh.textureArray = static_cast<int>(imageArray[image]);
+    subMesh.textureLayer = static_cast<int>(imageLayer[image]);
+  }
+}
+
+void OBJMesh::uploadTextures(std::vector<TextureLayers> &arrays)
+{
+  if (!m_textureArrays.empty())
+    glDeleteTextures(static_cast<GLsizei>(m_textureArrays.size()), m_textureArrays.data());
+  m_textureArrays.assign(arrays.size(), 0);
+  m_textureBytes = 0;
+  if (arrays.empty())
+    return;
+
+  glGenTextures(static_cast<GLsizei>(m_textureArrays.size()), m_textureArrays.data());
+  for (size_t i = 0; i < arrays.size(); ++i)
+  {
+    TextureLayers &array = arrays[i];
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrays[i]);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, array.width, array.height, static_cast<GLsizei>(array.layerCount),
+                 0, GL_RGBA, GL_UNSIGNED_BYTE, array.pixels.data());
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    // The mip chain adds about a third
+    m_textureBytes += array.pixels.size() + array.pixels.size() / 3;
+    array.pixels = std::vector<unsigned char>();
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void OBJMesh::bindTextures(unsigned int firstUnit) const
+{
+  for (size_t i = 0; i < m_textureArrays.size(); ++i)
+  {
+    glActiveTexture(GL_TEXTURE0 + firstUnit + static_cast<unsigned int>(i));
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrays[i]);
+  }
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void OBJMesh::uploadMaterials()
+{
+  std::vector<glm::vec4> colors;
+  colors.reserve(m_subMeshes.size() * 2);
+  for (const auto &subMesh : m_subMeshes)
+  {
+    colors.push_back(glm::vec4(subMesh.material.diffuse, 1.0f));
+    colors.push_back(glm::vec4(static_cast<float>(subMesh.textureArray), static_cast<float>(subMesh.textureLayer),
+                               0.0f, 0.0f));
+  }
+
+  if (!m_materialBuffer)
+  {
+    glGenBuffers(1, &m_materialBuffer);
+    glGenTextures(1, &m_materialTexture);
+  }
+
+  glBindBuffer(GL_TEXTURE_BUFFER, m_materialBuffer);
+  glBufferData(GL_TEXTURE_BUFFER, colors.size() * sizeof(glm::vec4), colors.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  glBindTexture(GL_TEXTURE_BUFFER, m_materialTexture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_materialBuffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void OBJMesh::bindMaterials(unsigned int unit) const
+{
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_BUFFER, m_materialTexture);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+size_t OBJMesh::getLODCount() const
+{
+  size_t count = 1;
+  for (const auto &subMesh : m_subMeshes)
+    count = std::max(count, subMesh.lods.size() + 1);
+  return count;
+}
+
+unsigned int OBJMesh::selectLOD(float pixelSize, float fullDetailSize) const
+{
+  size_t levels = getLODCount();
+  if (levels == 1 || pixelSize >= fullDetailSize || m_lodReduction <= 0.0f || m_lodReduction >= 1.0f)
+    return 0;
+  if (pixelSize <= 0.0f)
+    return static_cast<unsigned int>(levels - 1);
+
+  // Area goes with the square of the size
+  float steps = 2.0f * std::log(pixelSize / fullDetailSize) / std::log(m_lodReduction);
+  return static_cast<unsigned int>(std::min<float>(1.0f + std::floor(steps), static_cast<float>(levels - 1)));
+}
+
+bool OBJMesh::updateScalars(const float *values, size_t count)
+{
+  if (m_positionMap.empty() || m_positionMap.size() != m_mesh.getVertexCapacity())
+    return false;
+  float *scalars = m_mesh.mapScalars();
+  if (!scalars)
+    return false;
+
+  // Gathered from file order straight into the mapped buffer
+  const unsigned int *map = m_positionMap.data();
+  size_t vertexCount = m_positionMap.size();
+  size_t batches = (vertexCount + SCALAR_GATHER_BATCH - 1) / SCALAR_GATHER_BATCH;
+  ThreadPool::shared().parallelFor(batches, [&](size_t batch)
+                                   {
+    size_t end = std::min(vertexCount, (batch + 1) * SCALAR_GATHER_BATCH);
+    for (size_t i = batch * SCALAR_GATHER_BATCH; i < end; ++i)
+      scalars[i] = map[i] < count ? values[map[i]] : 0.0f; });
+
+  m_mesh.unmapScalars();
+  return true;
+}
+
+void OBJMesh::draw(GLint materialIndexLocation, unsigned int lod)
+{
+  // The OBJ shader reads its model transform from the instance attributes,
+  // which are undefined without an instance buffer
+  OBJInstance identity;
+  identity.transform = glm::mat4(1.0f);
+  identity.color = glm::vec4(0.0f);
+  drawInstanced(&identity, 1, materialIndexLocation, lod);
+}
+
+void OBJMesh::drawInstanced(const OBJInstance *instances, size_t count, GLint materialIndexLocation, unsigned int lod,
+                            const unsigned char *subMeshVisible)
+{
+  if (m_readyCount == 0 || count == 0)
+    return;
+  uploadInstances(instances, count);
+  drawInstanceRange(0, count, materialIndexLocation, lod, subMeshVisible);
+}
+
+void OBJMesh::uploadInstances(const OBJInstance *instances, size_t count)
+{
+  if (!m_instanceBuffer)
+    glGenBuffers(1, &m_instanceBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+  glBufferData(GL_ARRAY_BUFFER, count * sizeof(OBJInstance), instances, GL_STREAM_DRAW);
+}
+
+void OBJMesh::drawInstanceRange(size_t first, size_t count, GLint materialIndexLocation, unsigned int lod,
+                                const unsigned char *subMeshVisible)
+{
+  if (m_readyCount == 0 || count == 0 || !m_instanceBuffer)
+    return;
+
+  // Every load replaces the mesh's VAO, so the instance attributes are
+  // attached on each call rather than once per buffer. Without base
+  // instance draws (GL 4.2), the offset of first selects the range.
+  m_mesh.bind();
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+  size_t base = first * sizeof(OBJInstance);
+  for (int column = 0; column < 4; ++column)
+  {
+    glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(OBJInstance),
+                          (void *)(base + offsetof(OBJInstance, transform) + column * sizeof(glm::vec4)));
+    glEnableVertexAttribArray(3 + column);
+    glVertexAttribDivisor(3 + column, 1);
+  }
+  glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(OBJInstance), (void *)(base + offsetof(OBJInstance, color)));
+  glEnableVertexAttribArray(7);
+  glVertexAttribDivisor(7, 1);
+
+  for (size_t i = 0; i < m_readyCount; ++i)
+  {
+    if (subMeshVisible && !subMeshVisible[i])
+      continue;
+    const SubMesh &subMesh = m_subMeshes[i];
+    if (materialIndexLocation >= 0)
+      glUniform1i(materialIndexLocation, static_cast<GLint>(i));
+    SubMeshLOD range = subMesh.getLevel(lod);
+    m_mesh.drawRange(range.indexOffset, range.indexCount, subMesh.baseVertex, count);
   }
+  Mesh::unbind();
 }
@@ -74,11 +74,31 @@ void Shader::setBool(const std::string &name, bool value) const
   glUniform1i(glGetUniformLocation(m_id, name.c_str()), (int)value);
 }
 
+void Shader::setInt(const std::string &name, int value) const
+{
+  glUniform1i(glGetUniformLocation(m_id, name.c_str()), value);
+}
+
+void Shader::setIVec2(const std::string &name, const glm::ivec2 &value) const
+{
+  glUniform2iv(glGetUniformLocation(m_id, name.c_str()), 1, glm::value_ptr(value));
+}
+
+void Shader::setIVec3(const std::string &name, const glm::ivec3 &value) const
+{
+  glUniform3iv(glGetUniformLocation(m_id, name.c_str()), 1, glm::value_ptr(value));
+}
+
 void Shader::setFloat(const std::string &name, float value) const
 {
   glUniform1f(glGetUniformLocation(m_id, name.c_str()), value);
 }
 
+void Shader::setVec2(const std::string &name, const glm::vec2 &value) const
+{
+  glUniform2fv(glGetUniformLocation(m_id, name.c_str()), 1, glm::value_ptr(value));
+}
+
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
 {
   glUniform3fv(glGetUniformLocation(m_id, name.c_str()), 1, glm::value_ptr(value));
@@ -0,0 +1,12 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// SSE2 is part of every x86-64 target (and of 32-bit builds that ask for
+// it), so kernels use it unconditionally there and keep a scalar loop for
+// everything else. Internal to the library.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VGL_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#endif
@@ -0,0 +1,582 @@
+#include <vgl/SpatialIndex.h>
+#include <vgl/ThreadPool.h>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // An item fits a cell when its half size is at most FIT times the
+  // cell's; the slack absorbs rounding in the cell computations, which can
+  // put a center just outside its cell
+  constexpr float FIT = 0.99f;
+
+  // Items per job of the parallel build
+  constexpr size_t BUILD_CHUNK = 16384;
+
+  // A cell holding this many items is split: built runs this small are
+  // kept in one cell, and inserts create a missing child only below a
+  // cell this full
+  constexpr size_t LEAF_ITEMS = 16;
+
+  struct BuildEntry
+  {
+    // Cell code left-aligned to MAX_DEPTH levels, then the depth in the low
+    // four bits: sorted, cells come in depth-first order with each parent
+    // before its children
+    uint64_t key;
+    SpatialIndex::Handle handle;
+
+    bool operator<(const BuildEntry &other) const
+    {
+      return key != other.key ? key < other.key : handle < other.handle;
+    }
+  };
+
+  float largestExtent(const AABB &box)
+  {
+    glm::vec3 extent = box.getExtent();
+    return std::max({extent.x, extent.y, extent.z});
+  }
+
+  bool isPlaceable(const AABB &box)
+  {
+    if (box.isEmpty())
+      return false;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      if (!std::isfinite(box.min[axis]) || !std::isfinite(box.max[axis]))
+        return false;
+    }
+    return true;
+  }
+
+  // Child index: bit 0 set on the +x side, bit 1 on +y, bit 2 on +z
+  int octant(glm::vec3 point, glm::vec3 center)
+  {
+    return (point.x >= center.x ? 1 : 0) | (point.y >= center.y ? 2 : 0) | (point.z >= center.z ? 4 : 0);
+  }
+
+  glm::vec3 octantOffset(int octant, float distance)
+  {
+    return glm::vec3(octant & 1 ? distance : -distance, octant & 2 ? distance : -distance,
+                     octant & 4 ? distance : -distance);
+  }
+
+  bool encloses(const AABB &outer, const AABB &inner)
+  {
+    return inner.min.x >= outer.min.x && inner.min.y >= outer.min.y && inner.min.z >= outer.min.z &&
+           inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+  }
+
+  Containment testSphere(glm::vec3 center, float radiusSquared, const AABB &box)
+  {
+    float nearest = 0.0f;
+    float farthest = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      float below = box.min[axis] - center[axis];
+      float above = center[axis] - box.max[axis];
+      float gap = std::max({below, above, 0.0f});
+      float reach = std::max(std::fabs(below), std::fabs(above));
+      nearest += gap * gap;
+      farthest += reach * reach;
+    }
+    if (nearest > radiusSquared)
+      return Containment::Outside;
+    return farthest <= radiusSquared ? Containment::Inside : Containment::Intersects;
+  }
+
+  Containment testBox(const AABB &query, const AABB &box)
+  {
+    if (box.min.x > query.max.x || box.min.y > query.max.y || box.min.z > query.max.z || box.max.x < query.min.x ||
+        box.max.y < query.min.y || box.max.z < query.min.z)
+      return Containment::Outside;
+    return encloses(query, box) ? Containment::Inside : Containment::Intersects;
+  }
+}
+
+void SpatialIndex::build(const AABB *bounds, size_t count)
+{
+  clear();
+  m_items.resize(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    m_items[i].bounds = bounds[i];
+    m_items[i].node = UNPLACED;
+  }
+  m_itemCount = count;
+  rebuild();
+}
+
+void SpatialIndex::rebuild()
+{
+  m_nodes.clear();
+  m_unplaced.clear();
+  m_root = NONE;
+
+  std::vector<Handle> placed;
+  placed.reserve(m_itemCount);
+  for (Handle handle = 0; handle < m_items.size(); ++handle)
+  {
+    Item &item = m_items[handle];
+    if (item.node == FREE)
+      continue;
+    if (isPlaceable(item.bounds))
+    {
+      placed.push_back(handle);
+    }
+    else
+    {
+      item.node = UNPLACED;
+      item.slot = static_cast<uint32_t>(m_unplaced.size());
+      m_unplaced.push_back(handle);
+    }
+  }
+  if (placed.empty())
+    return;
+
+  // The root cell is fitted around the item centers and made large enough
+  // for the largest item
+  ThreadPool &pool = ThreadPool::shared();
+  size_t count = placed.size();
+  size_t chunkCount = (count + BUILD_CHUNK - 1) / BUILD_CHUNK;
+  std::vector<AABB> chunkCenters(chunkCount);
+  std::vector<float> chunkExtents(chunkCount, 0.0f);
+  pool.parallelFor(chunkCount, [&](size_t c)
+  {
+    size_t end = std::min(count, (c + 1) * BUILD_CHUNK);
+    for (size_t i = c * BUILD_CHUNK; i < end; ++i)
+    {
+      const AABB &bounds = m_items[placed[i]].bounds;
+      chunkCenters[c].expand(bounds.getCenter());
+      chunkExtents[c] = std::max(chunkExtents[c], largestExtent(bounds));
+    }
+  });
+  AABB centers;
+  float largest = 0.0f;
+  for (size_t c = 0; c < chunkCount; ++c)
+  {
+    centers.expand(chunkCenters[c]);
+    largest = std::max(largest, chunkExtents[c]);
+  }
+  glm::vec3 rootCenter = centers.getCenter();
+  float rootHalf = std::max(largestExtent(centers), largest / FIT);
+  if (rootHalf <= 0.0f)
+    rootHalf = 1.0f;
+  m_minHalfSize = rootHalf / static_cast<float>(1 << MAX_DEPTH);
+
+  // Every item's cell follows from its bounds alone: the depth from its
+  // size, the cell at that depth from its center. Sorting by cell then
+  // groups the items and orders the cells depth first.
+  std::vector<BuildEntry> entries(count);
+  glm::vec3 rootMin = rootCenter - glm::vec3(rootHalf);
+  pool.parallelFor(chunkCount, [&](size_t c)
+  {
+    size_t end = std::min(count, (c + 1) * BUILD_CHUNK);
+    for (size_t i = c * BUILD_CHUNK; i < end; ++i)
+    {
+      const AABB &bounds = m_items[placed[i]].bounds;
+      float extent = largestExtent(bounds);
+      int depth = 0;
+      float half = rootHalf;
+      while (depth < MAX_DEPTH && extent <= half * 0.5f * FIT)
+      {
+        half *= 0.5f;
+        ++depth;
+      }
+
+      int cells = 1 << depth;
+      glm::vec3 cell = (bounds.getCenter() - rootMin) * (cells / (2.0f * rootHalf));
+      uint32_t coords[3];
+      for (int axis = 0; axis < 3; ++axis)
+        coords[axis] = static_cast<uint32_t>(std::min(std::max(std::floor(cell[axis]), 0.0f), cells - 1.0f));
+
+      uint64_t code = 0;
+      for (int bit = depth - 1; bit >= 0; --bit)
+        code = (code << 3) | ((coords[0] >> bit) & 1) | (((coords[1] >> bit) & 1) << 1) | (((coords[2] >> bit) & 1) << 2);
+      entries[i].key = ((code << (3 * (MAX_DEPTH - depth))) << 4) | static_cast<uint64_t>(depth);
+      entries[i].handle = placed[i];
+    }
+  });
+
+  // Sorted chunk by chunk, then merged pairwise
+  pool.parallelFor(chunkCount, [&](size_t c)
+  {
+    std::sort(entries.begin() + c * BUILD_CHUNK, entries.begin() + std::min(count, (c + 1) * BUILD_CHUNK));
+  });
+  for (size_t width = BUILD_CHUNK; width < count; width *= 2)
+  {
+    pool.parallelFor((count + 2 * width - 1) / (2 * width), [&](size_t pair)
+    {
+      size_t begin = pair * 2 * width;
+      size_t middle = std::min(count, begin + width);
+      size_t end = std::min(count, begin + 2 * width);
+      std::inplace_merge(entries.begin() + begin, entries.begin() + middle, entries.begin() + end);
+    });
+  }
+
+  // Split top down: a cell's items are a contiguous run of the sorted
+  // entries, starting with those that belong to the cell itself, and each
+  // child's run follows from a binary search on the key. Runs of at most
+  // LEAF_ITEMS stay together in one cell instead of each item going down
+  // to its own.
+  struct Range
+  {
+    uint32_t node;
+    size_t begin;
+    size_t end;
+  };
+  struct Split
+  {
+    uint32_t node;
+    int depth;
+    uint64_t code;
+    size_t begin;
+    size_t end;
+  };
+  std::vector<Range> ranges;
+  m_root = newNode(rootCenter, rootHalf, NONE);
+  std::vector<Split> splits{{m_root, 0, 0, 0, count}};
+  auto keyBefore = [](const BuildEntry &entry, uint64_t key) { return entry.key < key; };
+  while (!splits.empty())
+  {
+    Split split = splits.back();
+    splits.pop_back();
+    if (split.end - split.begin <= LEAF_ITEMS || split.depth == MAX_DEPTH)
+    {
+      ranges.push_back({split.node, split.begin, split.end});
+      continue;
+    }
+
+    uint64_t own = ((split.code << (3 * (MAX_DEPTH - split.depth))) << 4) | static_cast<uint64_t>(split.depth);
+    size_t begin = std::partition_point(entries.begin() + split.begin, entries.begin() + split.end,
+                                        [&](const BuildEntry &entry) { return entry.key == own; }) -
+                   entries.begin();
+    if (begin > split.begin)
+      ranges.push_back({split.node, split.begin, begin});
+
+    int shift = 3 * (MAX_DEPTH - split.depth - 1);
+    for (int child = 0; child < 8; ++child)
+    {
+      uint64_t code = split.code * 8 + child;
+      uint64_t limit = ((code + 1) << shift) << 4;
+      size_t end = std::lower_bound(entries.begin() + begin, entries.begin() + split.end, limit, keyBefore) -
+                   entries.begin();
+      if (end > begin)
+      {
+        float half = m_nodes[split.node].halfSize * 0.5f;
+        uint32_t node = newNode(m_nodes[split.node].center + octantOffset(child, half), half, split.node);
+        m_nodes[split.node].children[child] = node;
+        splits.push_back({node, split.depth + 1, code, begin, end});
+      }
+      begin = end;
+    }
+  }
+
+  // Cells get their items in parallel (each range is a different cell)
+  pool.parallelFor((ranges.size() + 255) / 256, [&](size_t c)
+  {
+    size_t end = std::min(ranges.size(), (c + 1) * 256);
+    for (size_t r = c * 256; r < end; ++r)
+    {
+      const Range &range = ranges[r];
+      std::vector<Handle> &items = m_nodes[range.node].items;
+      items.resize(range.end - range.begin);
+      for (size_t i = range.begin; i < range.end; ++i)
+      {
+        Handle handle = entries[i].handle;
+        items[i - range.begin] = handle;
+        m_items[handle].node = range.node;
+        m_items[handle].slot = static_cast<uint32_t>(i - range.begin);
+      }
+    }
+  });
+
+  // Children were created after their parents
+  for (size_t n = m_nodes.size(); n-- > 0;)
+  {
+    Node &node = m_nodes[n];
+    node.subtreeCount += node.items.size();
+    if (node.parent != NONE)
+      m_nodes[node.parent].subtreeCount += node.subtreeCount;
+  }
+}
+
+SpatialIndex::Handle SpatialIndex::insert(const AABB &bounds)
+{
+  Handle handle = allocate(bounds);
+  place(handle);
+  return handle;
+}
+
+void SpatialIndex::insert(const AABB *bounds, size_t count, Handle *handles)
+{
+  bool rebuildAll = count * 2 >= m_itemCount;
+  for (size_t i = 0; i < count; ++i)
+  {
+    Handle handle = allocate(bounds[i]);
+    if (handles)
+      handles[i] = handle;
+    if (!rebuildAll)
+      place(handle);
+  }
+  if (rebuildAll)
+    rebuild();
+}
+
+void SpatialIndex::move(Handle handle, const AABB &bounds)
+{
+  Item &item = m_items[handle];
+  if (item.node != UNPLACED && isPlaceable(bounds) && encloses(looseBounds(m_nodes[item.node]), bounds))
+  {
+    item.bounds = bounds;
+    return;
+  }
+  unplace(handle);
+  item.bounds = bounds;
+  place(handle);
+}
+
+void SpatialIndex::move(const Handle *handles, const AABB *bounds, size_t count)
+{
+  if (count * 2 < m_itemCount)
+  {
+    for (size_t i = 0; i < count; ++i)
+      move(handles[i], bounds[i]);
+    return;
+  }
+  for (size_t i = 0; i < count; ++i)
+    m_items[handles[i]].bounds = bounds[i];
+  rebuild();
+}
+
+void SpatialIndex::remove(Handle handle)
+{
+  unplace(handle);
+  Item &item = m_items[handle];
+  item.bounds = AABB{};
+  item.node = FREE;
+  m_freeHandles.push_back(handle);
+  --m_itemCount;
+}
+
+void SpatialIndex::clear()
+{
+  m_items.clear();
+  m_freeHandles.clear();
+  m_unplaced.clear();
+  m_nodes.clear();
+  m_root = NONE;
+  m_minHalfSize = 0.0f;
+  m_itemCount = 0;
+}
+
+SpatialIndex::Handle SpatialIndex::allocate(const AABB &bounds)
+{
+  Handle handle;
+  if (!m_freeHandles.empty())
+  {
+    handle = m_freeHandles.back();
+    m_freeHandles.pop_back();
+  }
+  else
+  {
+    handle = static_cast<Handle>(m_items.size());
+    m_items.emplace_back();
+  }
+  m_items[handle].bounds = bounds;
+  m_items[handle].node = UNPLACED;
+  ++m_itemCount;
+  return handle;
+}
+
+void SpatialIndex::place(Handle handle)
+{
+  Item &item = m_items[handle];
+  if (!isPlaceable(item.bounds))
+  {
+    item.node = UNPLACED;
+    item.slot = static_cast<uint32_t>(m_unplaced.size());
+    m_unplaced.push_back(handle);
+    return;
+  }
+
+  growRoot(item.bounds);
+  glm::vec3 center = item.bounds.getCenter();
+  float extent = largestExtent(item.bounds);
+  uint32_t node = m_root;
+  for (;;)
+  {
+    float childHalf = m_nodes[node].halfSize * 0.5f;
+    if (childHalf < m_minHalfSize || extent > childHalf * FIT)
+      break;
+    int child = octant(center, m_nodes[node].center);
+    if (m_nodes[node].children[child] == NONE)
+    {
+      if (m_nodes[node].items.size() < LEAF_ITEMS)
+        break;
+      uint32_t created = newNode(m_nodes[node].center + octantOffset(child, childHalf), childHalf, node);
+      m_nodes[node].children[child] = created;
+    }
+    node = m_nodes[node].children[child];
+  }
+
+  item.node = node;
+  item.slot = static_cast<uint32_t>(m_nodes[node].items.size());
+  m_nodes[node].items.push_back(handle);
+  addCount(node, 1);
+}
+
+void SpatialIndex::unplace(Handle handle)
+{
+  Item &item = m_items[handle];
+  std::vector<Handle> &list = item.node == UNPLACED ? m_unplaced : m_nodes[item.node].items;
+  Handle last = list.back();
+  list[item.slot] = last;
+  m_items[last].slot = item.slot;
+  list.pop_back();
+  if (item.node != UNPLACED)
+    addCount(item.node, -1);
+  item.node = UNPLACED;
+}
+
+uint32_t SpatialIndex::newNode(glm::vec3 center, float halfSize, uint32_t parent)
+{
+  m_nodes.emplace_back();
+  Node &node = m_nodes.back();
+  node.center = center;
+  node.halfSize = halfSize;
+  node.parent = parent;
+  return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+void SpatialIndex::growRoot(const AABB &bounds)
+{
+  glm::vec3 center = bounds.getCenter();
+  float extent = largestExtent(bounds);
+  if (m_root == NONE)
+  {
+    float half = extent > 0.0f ? extent / FIT : 1.0f;
+    m_minHalfSize = half / static_cast<float>(1 << MAX_DEPTH);
+    m_root = newNode(center, half, NONE);
+    return;
+  }
+
+  // Double the root toward the item until it fits; the old root becomes
+  // the child on the far side
+  for (;;)
+  {
+    const Node &root = m_nodes[m_root];
+    glm::vec3 offset = glm::abs(center - root.center);
+    if (std::max({offset.x, offset.y, offset.z}) <= root.halfSize && extent <= root.halfSize * FIT)
+      return;
+
+    int oldOctant = 7 ^ octant(center, root.center);
+    glm::vec3 grownCenter = root.center - octantOffset(oldOctant, root.halfSize);
+    uint32_t oldRoot = m_root;
+    size_t subtreeCount = root.subtreeCount;
+    m_root = newNode(grownCenter, root.halfSize * 2.0f, NONE);
+    m_nodes[m_root].children[oldOctant] = oldRoot;
+    m_nodes[m_root].subtreeCount = subtreeCount;
+    m_nodes[oldRoot].parent = m_root;
+  }
+}
+
+void SpatialIndex::addCount(uint32_t node, ptrdiff_t delta)
+{
+  for (; node != NONE; node = m_nodes[node].parent)
+    m_nodes[node].subtreeCount += delta;
+}
+
+AABB SpatialIndex::looseBounds(const Node &node) const
+{
+  AABB box;
+  box.min = node.center - glm::vec3(2.0f * node.halfSize);
+  box.max = node.center + glm::vec3(2.0f * node.halfSize);
+  return box;
+}
+
+template <typename Classify>
+void SpatialIndex::query(const Classify &classify, std::vector<Handle> &out) const
+{
+  if (m_root == NONE)
+    return;
+
+  std::vector<uint32_t> stack{m_root};
+  while (!stack.empty())
+  {
+    uint32_t index = stack.back();
+    stack.pop_back();
+    const Node &node = m_nodes[index];
+    if (node.subtreeCount == 0)
+      continue;
+
+    Containment containment = classify(looseBounds(node));
+    if (containment == Containment::Outside)
+      continue;
+    if (containment == Containment::Inside)
+    {
+      appendSubtree(index, out);
+      continue;
+    }
+
+    for (Handle handle : node.items)
+    {
+      if (classify(m_items[handle].bounds) != Containment::Outside)
+        out.push_back(handle);
+    }
+    for (uint32_t child : node.children)
+    {
+      if (child != NONE)
+        stack.push_back(child);
+    }
+  }
+}
+
+void SpatialIndex::appendSubtree(uint32_t node, std::vector<Handle> &out) const
+{
+  std::vector<uint32_t> stack{node};
+  while (!stack.empty())
+  {
+    const Node &current = m_nodes[stack.back()];
+    stack.pop_back();
+    if (current.subtreeCount == 0)
+      continue;
+    out.insert(out.end(), current.items.begin(), current.items.end());
+    for (uint32_t child : current.children)
+    {
+      if (child != NONE)
+        stack.push_back(child);
+    }
+  }
+}
+
+void SpatialIndex::queryFrustum(const Frustum &frustum, std::vector<Handle> &out) const
+{
+  query([&](const AABB &box) { return frustum.test(box); }, out);
+}
+
+void SpatialIndex::queryFrustum(const Frustum &frustum, glm::vec3 eye, float maxDistance,
+                                std::vector<Handle> &out) const
+{
+  float radiusSquared = maxDistance * maxDistance;
+  query([&](const AABB &box)
+  {
+    Containment near = testSphere(eye, radiusSquared, box);
+    if (near == Containment::Outside)
+      return near;
+    Containment visible = frustum.test(box);
+    return near == Containment::Inside ? visible : std::min(visible, Containment::Intersects);
+  }, out);
+}
+
+void SpatialIndex::queryRadius(glm::vec3 center, float radius, std::vector<Handle> &out) const
+{
+  float radiusSquared = radius * radius;
+  query([&](const AABB &box) { return testSphere(center, radiusSquared, box); }, out);
+}
+
+void SpatialIndex::queryBox(const AABB &box, std::vector<Handle> &out) const
+{
+  query([&](const AABB &other) { return testBox(box, other); }, out);
+}
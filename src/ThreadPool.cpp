@@ -0,0 +1,129 @@
+#include <vgl/ThreadPool.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  m_workers.reserve(threadCount);
+  for (unsigned int i = 0; i < threadCount; ++i)
+  {
+    m_workers.emplace_back([this]()
+                           { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_condition.notify_all();
+  for (auto &worker : m_workers)
+    worker.join();
+}
+
+ThreadPool &ThreadPool::shared()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> job)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back(std::move(job));
+  }
+  m_condition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+  while (true)
+  {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(lock, [this]()
+                       { return m_stopping || !m_jobs.empty(); });
+      if (m_stopping && m_jobs.empty())
+        return;
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+    job();
+  }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &body)
+{
+  if (count == 0)
+    return;
+  if (count == 1 || m_workers.empty())
+  {
+    for (size_t i = 0; i < count; ++i)
+      body(i);
+    return;
+  }
+
+  // Shared with helper jobs, which may start after every index was claimed
+  // (or even after this call returned), so it must outlive the caller's frame.
+  struct State
+  {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    size_t count = 0;
+    const std::function<void(size_t)> *body = nullptr;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable finished;
+  };
+
+  auto state = std::make_shared<State>();
+  state->count = count;
+  state->body = &body;
+
+  auto run = [](State &s)
+  {
+    size_t i;
+    while ((i = s.next.fetch_add(1)) < s.count)
+    {
+      try
+      {
+        (*s.body)(i);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (!s.error)
+          s.error = std::current_exception();
+      }
+
+      if (s.done.fetch_add(1) + 1 == s.count)
+      {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.finished.notify_all();
+      }
+    }
+  };
+
+  size_t helpers = std::min<size_t>(m_workers.size(), count - 1);
+  for (size_t h = 0; h < helpers; ++h)
+  {
+    enqueue([state, run]()
+            { run(*state); });
+  }
+
+  run(*state);
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->finished.wait(lock, [&]()
+                       { return state->done.load() == count; });
+  if (state->error)
+    std::rethrow_exception(state->error);
+}
@@ -0,0 +1,132 @@
+#include <vgl/Trail.h>
+#include <algorithm>
+
+// The buffer holds capacity + 1 slots. Slot `capacity` mirrors slot 0 so the
+// segment joining the end of the ring back to its start is part of the first
+// strip when the trail has wrapped.
+
+Trail::Trail(unsigned int capacity) : m_capacity(std::max(capacity, 2u)) {}
+
+Trail::~Trail() { cleanup(); }
+
+Trail::Trail(Trail &&other) noexcept
+    : m_vao(other.m_vao), m_vbo(other.m_vbo), m_capacity(other.m_capacity),
+      m_head(other.m_head), m_count(other.m_count)
+{
+  other.m_vao = other.m_vbo = 0;
+  other.m_head = other.m_count = 0;
+}
+
+Trail &Trail::operator=(Trail &&other) noexcept
+{
+  if (this != &other)
+  {
+    cleanup();
+    m_vao = other.m_vao;
+    m_vbo = other.m_vbo;
+    m_capacity = other.m_capacity;
+    m_head = other.m_head;
+    m_count = other.m_count;
+    other.m_vao = other.m_vbo = 0;
+    other.m_head = other.m_count = 0;
+  }
+  return *this;
+}
+
+void Trail::cleanup()
+{
+  if (m_vao)
+    glDeleteVertexArrays(1, &m_vao);
+  if (m_vbo)
+    glDeleteBuffers(1, &m_vbo);
+  m_vao = m_vbo = 0;
+}
+
+void Trail::init()
+{
+  glGenVertexArrays(1, &m_vao);
+  glGenBuffers(1, &m_vbo);
+
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  glBufferData(GL_ARRAY_BUFFER, (m_capacity + 1) * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+  glEnableVertexAttribArray(0);
+  glBindVertexArray(0);
+}
+
+void Trail::write(unsigned int slot, const glm::vec3 *points, unsigned int count)
+{
+  glBufferSubData(GL_ARRAY_BUFFER, slot * sizeof(glm::vec3), count * sizeof(glm::vec3), points);
+  if (slot == 0)
+  {
+    glBufferSubData(GL_ARRAY_BUFFER, m_capacity * sizeof(glm::vec3), sizeof(glm::vec3), points);
+  }
+}
+
+void Trail::append(glm::vec3 point)
+{
+  append(&point, 1);
+}
+
+void Trail::append(const std::vector<glm::vec3> &points)
+{
+  append(points.data(), points.size());
+}
+
+void Trail::append(const glm::vec3 *points, size_t count)
+{
+  if (count == 0)
+    return;
+  if (!m_vao)
+    init();
+
+  // Only the newest `capacity` samples can survive
+  if (count > m_capacity)
+  {
+    points += count - m_capacity;
+    count = m_capacity;
+  }
+  unsigned int n = static_cast<unsigned int>(count);
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+  // Split at the end of the ring
+  unsigned int first = std::min(n, m_capacity - m_head);
+  write(m_head, points, first);
+  if (first < n)
+  {
+    write(0, points + first, n - first);
+  }
+
+  m_head = (m_head + n) % m_capacity;
+  m_count = std::min(m_count + n, m_capacity);
+}
+
+void Trail::clear()
+{
+  m_head = 0;
+  m_count = 0;
+}
+
+void Trail::draw() const
+{
+  if (!m_vao || m_count < 2)
+    return;
+
+  unsigned int oldest = (m_head + m_capacity - m_count) % m_capacity;
+
+  glBindVertexArray(m_vao);
+  if (oldest + m_count <= m_capacity)
+  {
+    glDrawArrays(GL_LINE_STRIP, oldest, m_count);
+  }
+  else
+  {
+    // Oldest samples run up to and including the mirrored slot, the rest wrap to the start
+    glDrawArrays(GL_LINE_STRIP, oldest, m_capacity - oldest + 1);
+    if (m_head >= 2)
+      glDrawArrays(GL_LINE_STRIP, 0, m_head);
+  }
+  glBindVertexArray(0);
+}
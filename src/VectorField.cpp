@@ -0,0 +1,130 @@
+#include <vgl/VectorField.h>
+#include <vgl/Mesh.h>
+#include <algorithm>
+
+VectorField::~VectorField() { cleanup(); }
+
+VectorField::VectorField(VectorField &&other) noexcept
+    : m_vao(other.m_vao), m_glyphVbo(other.m_glyphVbo), m_glyphEbo(other.m_glyphEbo),
+      m_instanceVbo(other.m_instanceVbo), m_glyphIndexCount(other.m_glyphIndexCount),
+      m_uploadedCount(other.m_uploadedCount), m_dims(other.m_dims), m_origin(other.m_origin),
+      m_spacing(other.m_spacing), m_scale(other.m_scale), m_maxLength(other.m_maxLength),
+      m_glyphWidth(other.m_glyphWidth), m_minMagnitude(other.m_minMagnitude), m_rangeMin(other.m_rangeMin), m_rangeMax(other.m_rangeMax)
+{
+  other.m_vao = other.m_glyphVbo = other.m_glyphEbo = other.m_instanceVbo = 0;
+  other.m_glyphIndexCount = 0;
+  other.m_uploadedCount = 0;
+}
+
+VectorField &VectorField::operator=(VectorField &&other) noexcept
+{
+  if (this != &other)
+  {
+    cleanup();
+    m_vao = other.m_vao;
+    m_glyphVbo = other.m_glyphVbo;
+    m_glyphEbo = other.m_glyphEbo;
+    m_instanceVbo = other.m_instanceVbo;
+    m_glyphIndexCount = other.m_glyphIndexCount;
+    m_uploadedCount = other.m_uploadedCount;
+    m_dims = other.m_dims;
+    m_origin = other.m_origin;
+    m_spacing = other.m_spacing;
+    m_scale = other.m_scale;
+    m_maxLength = other.m_maxLength;
+    m_glyphWidth = other.m_glyphWidth;
+    m_minMagnitude = other.m_minMagnitude;
+    m_rangeMin = other.m_rangeMin;
+    m_rangeMax = other.m_rangeMax;
+    other.m_vao = other.m_glyphVbo = other.m_glyphEbo = other.m_instanceVbo = 0;
+    other.m_glyphIndexCount = 0;
+    other.m_uploadedCount = 0;
+  }
+  return *this;
+}
+
+void VectorField::cleanup()
+{
+  if (m_vao)
+    glDeleteVertexArrays(1, &m_vao);
+
+  GLuint buffers[] = {m_glyphVbo, m_glyphEbo, m_instanceVbo};
+  for (GLuint buffer : buffers)
+  {
+    if (buffer)
+      glDeleteBuffers(1, &buffer);
+  }
+  m_vao = m_glyphVbo = m_glyphEbo = m_instanceVbo = 0;
+}
+
+void VectorField::init()
+{
+  std::vector<Vertex> vertices;
+  std::vector<unsigned int> indices;
+  MeshGen::arrow(vertices, indices, 8);
+  m_glyphIndexCount = indices.size();
+
+  glGenVertexArrays(1, &m_vao);
+  glGenBuffers(1, &m_glyphVbo);
+  glGenBuffers(1, &m_glyphEbo);
+  glGenBuffers(1, &m_instanceVbo);
+
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, m_glyphVbo);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_glyphEbo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+  glEnableVertexAttribArray(1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+  glEnableVertexAttribArray(3);
+  glVertexAttribDivisor(3, 1);
+  glBindVertexArray(0);
+}
+
+VectorField &VectorField::setGrid(glm::ivec3 dims, glm::vec3 origin, glm::vec3 spacing)
+{
+  m_dims = glm::max(dims, glm::ivec3(0));
+  m_origin = origin;
+  m_spacing = spacing;
+  return *this;
+}
+
+float VectorField::getGlyphWidth() const
+{
+  if (m_glyphWidth > 0.0f)
+    return m_glyphWidth;
+  return 0.3f * std::min(m_spacing.x, std::min(m_spacing.y, m_spacing.z));
+}
+
+void VectorField::update(const std::vector<glm::vec3> &vectors)
+{
+  update(vectors.data(), vectors.size());
+}
+
+void VectorField::update(const glm::vec3 *vectors, size_t count)
+{
+  if (count == 0)
+    return;
+  if (!m_vao)
+    init();
+
+  // Respecifying the store lets the driver orphan last frame's field
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+  glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::vec3), vectors, GL_STREAM_DRAW);
+  m_uploadedCount = count;
+}
+
+void VectorField::draw() const
+{
+  size_t count = std::min(m_uploadedCount, getSampleCount());
+  if (!m_vao || count == 0)
+    return;
+  glBindVertexArray(m_vao);
+  glDrawElementsInstanced(GL_TRIANGLES, m_glyphIndexCount, GL_UNSIGNED_INT, 0, count);
+  glBindVertexArray(0);
+}
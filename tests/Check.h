@@ -0,0 +1,30 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+// Minimal harness shared by the tests, each a single file with a plain
+// main: check() prints and counts failed conditions, and main ends with
+// return finish("name_test").
+#include <cstdio>
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool condition, const char *what)
+  {
+    if (!condition)
+    {
+      std::printf("FAIL: %s\n", what);
+      ++failures;
+    }
+  }
+
+  int finish(const char *test)
+  {
+    if (failures == 0)
+      std::printf("%s passed\n", test);
+    return failures == 0 ? 0 : 1;
+  }
+}
+
+#endif
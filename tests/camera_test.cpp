@@ -0,0 +1,98 @@
+// Camera::project and unproject against glm::project and glm::unProject
+// applied point by point, for batch sizes that end in every possible tail
+// of the vectorized loops (1 to 7 points past a whole group).
+#include "Check.h"
+#include <vgl/Camera.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+  std::mt19937 rng(2024);
+
+  float uniform(float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng); }
+
+  // Largest error over the batch: pixels for xy, relative for depth, and
+  // the distance between unit ray directions
+  struct Errors
+  {
+    float pixel = 0.0f;
+    float depth = 0.0f;
+    float ray = 0.0f;
+  };
+
+  Errors compare(const Camera &camera, glm::vec2 viewport, size_t count)
+  {
+    glm::mat4 view = glm::lookAt(camera.position, camera.target, camera.up);
+    glm::mat4 projection = glm::perspective(glm::radians(camera.fov), viewport.x / viewport.y, camera.nearPlane,
+                                            camera.farPlane);
+    glm::vec4 window(0.0f, 0.0f, viewport.x, viewport.y);
+
+    // Points in front of the camera, some outside the view
+    std::vector<glm::vec3> points(count);
+    std::vector<glm::vec2> pixels(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      glm::vec3 offset(uniform(-1.5f, 1.5f), uniform(-1.5f, 1.5f), 1.0f);
+      float distance = uniform(1.0f, 50.0f);
+      glm::vec3 right = camera.getRight(), up = camera.getUpVector(), forward = camera.getDirection();
+      points[i] = camera.position + (right * offset.x + up * offset.y + forward) * distance;
+      pixels[i] = glm::vec2(uniform(-20.0f, viewport.x + 20.0f), uniform(-20.0f, viewport.y + 20.0f));
+    }
+
+    std::vector<glm::vec3> projected(count), rays(count);
+    camera.project(points.data(), count, projected.data(), viewport);
+    camera.unproject(pixels.data(), count, rays.data(), viewport);
+
+    Errors errors;
+    for (size_t i = 0; i < count; ++i)
+    {
+      // glm's window origin is the bottom left, the camera's the top left
+      glm::vec3 expected = glm::project(points[i], view, projection, window);
+      expected.y = viewport.y - expected.y;
+      float depth = (projection * view * glm::vec4(points[i], 1.0f)).w;
+      errors.pixel = std::max({errors.pixel, std::abs(projected[i].x - expected.x), std::abs(projected[i].y - expected.y)});
+      errors.depth = std::max(errors.depth, std::abs(projected[i].z - depth) / depth);
+
+      glm::vec3 nearPoint = glm::unProject(glm::vec3(pixels[i].x, viewport.y - pixels[i].y, 0.0f), view, projection, window);
+      glm::vec3 ray = glm::normalize(nearPoint - camera.position);
+      errors.ray = std::max(errors.ray, glm::length(rays[i] - ray));
+    }
+    return errors;
+  }
+}
+
+int main()
+{
+  Camera camera;
+  const glm::vec2 viewports[] = {glm::vec2(800.0f, 600.0f), glm::vec2(333.0f, 1021.0f)};
+  Errors worst;
+  for (glm::vec2 viewport : viewports)
+  {
+    for (size_t count : {1, 2, 3, 4, 5, 6, 7, 8, 9, 11, 12, 13, 15, 16, 17, 23, 100, 1003})
+    {
+      camera.lookAt(glm::vec3(uniform(-20.0f, 20.0f), uniform(-5.0f, 15.0f), uniform(-20.0f, 20.0f)),
+                    glm::vec3(uniform(-2.0f, 2.0f), uniform(-2.0f, 2.0f), uniform(-2.0f, 2.0f)));
+      camera.setFOV(uniform(30.0f, 90.0f)).setClipPlanes(uniform(0.05f, 0.5f), uniform(60.0f, 500.0f));
+      Errors errors = compare(camera, viewport, count);
+      worst.pixel = std::max(worst.pixel, errors.pixel);
+      worst.depth = std::max(worst.depth, errors.depth);
+      worst.ray = std::max(worst.ray, errors.ray);
+    }
+  }
+  check(worst.pixel < 0.01f, "project matches glm::project");
+  check(worst.depth < 1e-5f, "project depth matches clip w");
+  check(worst.ray < 1e-4f, "unproject matches glm::unProject");
+
+  // Without a viewport nothing is written
+  glm::vec3 point(1.0f, 2.0f, 3.0f), untouched(7.0f);
+  glm::vec2 pixel(10.0f, 10.0f);
+  camera.project(&point, 1, &untouched, glm::vec2(0.0f, 600.0f));
+  camera.unproject(&pixel, 1, &untouched, glm::vec2(800.0f, 0.0f));
+  check(untouched == glm::vec3(7.0f), "empty viewport leaves the output alone");
+
+  return finish("camera_test");
+}
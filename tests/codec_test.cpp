@@ -0,0 +1,102 @@
+// MeshCodec round trip: indices come back exactly, vertices within the
+// quantization step, and copies of one position in different blocks (as
+// at normal and uv seams) decode to the same value.
+#include "Check.h"
+#include "MeshCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  // A wavy grid in row order, then copies of some of its vertices with
+  // flipped normals at the end of the buffer, several blocks away
+  std::vector<Vertex> makeVertices(int side, int seamCopies)
+  {
+    std::vector<Vertex> vertices;
+    for (int z = 0; z < side; ++z)
+      for (int x = 0; x < side; ++x)
+      {
+        Vertex v;
+        v.position = glm::vec3(x * 0.25f, std::sin(x * 0.3f) * std::cos(z * 0.2f), z * -0.25f);
+        v.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        v.uv = glm::vec2(float(x) / side, float(z) / side);
+        vertices.push_back(v);
+      }
+    for (int i = 0; i < seamCopies; ++i)
+    {
+      Vertex v = vertices[(i * 7919) % (side * side)];
+      v.normal = glm::vec3(0.0f, -1.0f, 0.0f);
+      vertices.push_back(v);
+    }
+    return vertices;
+  }
+}
+
+int main()
+{
+  // 10201 + 37 vertices: three blocks, and a tail that is not a whole group
+  const int side = 101, seamCopies = 37;
+  std::vector<Vertex> vertices = makeVertices(side, seamCopies);
+  std::vector<unsigned int> indices;
+  for (int z = 0; z + 1 < side; ++z)
+    for (int x = 0; x + 1 < side; ++x)
+    {
+      unsigned int a = z * side + x, b = a + 1, c = a + side, d = c + 1;
+      indices.insert(indices.end(), {a, c, b, b, c, d});
+    }
+  indices.push_back(0xFFFFFFFFu); // a large jump must survive the deltas
+
+  std::vector<char> packedVertices = MeshCodec::encodeVertices(vertices.data(), vertices.size());
+  std::vector<char> packedIndices = MeshCodec::encodeIndices(indices.data(), indices.size());
+  check(packedVertices.size() < vertices.size() * sizeof(Vertex) / 2, "vertices pack to under half");
+  check(packedIndices.size() < indices.size() * sizeof(unsigned int) / 2, "indices pack to under half");
+
+  check(MeshCodec::checkVertices(packedVertices.data(), packedVertices.size(), vertices.size()), "vertex check");
+  check(MeshCodec::checkIndices(packedIndices.data(), packedIndices.size(), indices.size()), "index check");
+  check(!MeshCodec::checkVertices(packedVertices.data(), packedVertices.size() - 1, vertices.size()),
+        "truncated vertices rejected");
+  check(!MeshCodec::checkVertices(packedVertices.data(), packedVertices.size(), vertices.size() + 1),
+        "wrong vertex count rejected");
+  check(!MeshCodec::checkIndices(packedIndices.data(), packedIndices.size() / 2, indices.size()),
+        "truncated indices rejected");
+
+  std::vector<Vertex> decodedVertices(vertices.size());
+  std::vector<unsigned int> decodedIndices(indices.size());
+  MeshCodec::decodeVertices(packedVertices.data(), packedVertices.size(), decodedVertices.data(), vertices.size());
+  MeshCodec::decodeIndices(packedIndices.data(), packedIndices.size(), decodedIndices.data(), indices.size());
+  check(decodedIndices == indices, "indices round-trip exactly");
+
+  // Half a step of the grid spanning the whole mesh, with some slack for rounding
+  glm::vec3 extent(25.0f, 2.0f, 25.0f);
+  float maxPositionError = 0.0f, maxNormalError = 0.0f, maxUVError = 0.0f;
+  for (size_t i = 0; i < vertices.size(); ++i)
+    for (int c = 0; c < 3; ++c)
+    {
+      maxPositionError = std::max(maxPositionError, std::abs(decodedVertices[i].position[c] - vertices[i].position[c]) / extent[c]);
+      maxNormalError = std::max(maxNormalError, std::abs(decodedVertices[i].normal[c] - vertices[i].normal[c]));
+      if (c < 2)
+        maxUVError = std::max(maxUVError, std::abs(decodedVertices[i].uv[c] - vertices[i].uv[c]));
+    }
+  check(maxPositionError < 0.6f / 65535.0f, "positions within half a step");
+  check(maxNormalError < 1.0f / 32767.0f, "normals within one step");
+  check(maxUVError < 0.6f / 65535.0f, "uvs within half a step");
+
+  bool seamsClosed = true;
+  for (int i = 0; i < seamCopies; ++i)
+  {
+    const Vertex &original = decodedVertices[(i * 7919) % (side * side)];
+    const Vertex &copy = decodedVertices[side * side + i];
+    seamsClosed = seamsClosed && std::memcmp(&original.position, &copy.position, sizeof(copy.position)) == 0 &&
+                  std::memcmp(&original.uv, &copy.uv, sizeof(copy.uv)) == 0;
+  }
+  check(seamsClosed, "seam copies decode to the same position and uv");
+
+  // Nothing to encode still gives a buffer that checks and decodes
+  std::vector<char> empty = MeshCodec::encodeVertices(nullptr, 0);
+  check(MeshCodec::checkVertices(empty.data(), empty.size(), 0), "empty vertex buffer");
+
+  return finish("codec_test");
+}
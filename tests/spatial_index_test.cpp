@@ -0,0 +1,230 @@
+// SpatialIndex queries against a brute-force scan of the same boxes, after
+// a build and after inserts (growing the root), moves, batch moves,
+// removals, a batch insert and a rebuild.
+#include "Check.h"
+#include <vgl/SpatialIndex.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+  struct Scene
+  {
+    SpatialIndex index;
+    // Expected contents: bounds per handle, live or not
+    std::vector<AABB> bounds;
+    std::vector<bool> live;
+  };
+
+  std::mt19937 rng(12345);
+
+  float uniform(float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng); }
+
+  AABB randomBox(float spread)
+  {
+    glm::vec3 center(uniform(-spread, spread), uniform(-spread, spread), uniform(-spread, spread));
+    // Mostly small, some large items
+    float size = uniform(0.0f, 1.0f) < 0.05f ? uniform(5.0f, 40.0f) : uniform(0.05f, 2.0f);
+    AABB box;
+    box.min = center - glm::vec3(size * uniform(0.2f, 1.0f), size * uniform(0.2f, 1.0f), size * uniform(0.2f, 1.0f));
+    box.max = center + glm::vec3(size * uniform(0.2f, 1.0f), size * uniform(0.2f, 1.0f), size * uniform(0.2f, 1.0f));
+    return box;
+  }
+
+  bool reportable(const AABB &box)
+  {
+    return !box.isEmpty() && std::isfinite(box.min.x + box.min.y + box.min.z + box.max.x + box.max.y + box.max.z);
+  }
+
+  bool overlaps(const AABB &a, const AABB &b)
+  {
+    return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z && a.max.x >= b.min.x &&
+           a.max.y >= b.min.y && a.max.z >= b.min.z;
+  }
+
+  bool touchesSphere(const AABB &box, glm::vec3 center, float radius)
+  {
+    glm::vec3 nearest = glm::clamp(center, box.min, box.max) - center;
+    return glm::dot(nearest, nearest) <= radius * radius;
+  }
+
+  template <typename Accept>
+  std::vector<SpatialIndex::Handle> bruteForce(const Scene &scene, Accept accept)
+  {
+    std::vector<SpatialIndex::Handle> found;
+    for (SpatialIndex::Handle h = 0; h < scene.bounds.size(); ++h)
+    {
+      if (scene.live[h] && reportable(scene.bounds[h]) && accept(scene.bounds[h]))
+        found.push_back(h);
+    }
+    return found;
+  }
+
+  bool sameHandles(std::vector<SpatialIndex::Handle> found, const std::vector<SpatialIndex::Handle> &expected)
+  {
+    std::sort(found.begin(), found.end());
+    return found == expected;
+  }
+
+  void checkQueries(const Scene &scene, const char *phase)
+  {
+    size_t liveCount = std::count(scene.live.begin(), scene.live.end(), true);
+    if (scene.index.size() != liveCount)
+    {
+      std::printf("FAIL: %s: size %zu, expected %zu\n", phase, scene.index.size(), liveCount);
+      ++failures;
+    }
+
+    int mismatches = 0;
+    std::vector<SpatialIndex::Handle> found;
+    for (int q = 0; q < 40; ++q)
+    {
+      AABB box = randomBox(60.0f);
+      found.clear();
+      scene.index.queryBox(box, found);
+      mismatches += !sameHandles(found, bruteForce(scene, [&](const AABB &b) { return overlaps(box, b); }));
+
+      glm::vec3 center(uniform(-60.0f, 60.0f), uniform(-60.0f, 60.0f), uniform(-60.0f, 60.0f));
+      float radius = uniform(0.5f, 30.0f);
+      found.clear();
+      scene.index.queryRadius(center, radius, found);
+      mismatches += !sameHandles(found, bruteForce(scene, [&](const AABB &b) { return touchesSphere(b, center, radius); }));
+
+      glm::vec3 eye = center * 1.5f;
+      glm::mat4 view = glm::lookAt(eye, glm::vec3(uniform(-10.0f, 10.0f), 0.0f, uniform(-10.0f, 10.0f)), glm::vec3(0, 1, 0));
+      Frustum frustum(glm::perspective(glm::radians(uniform(20.0f, 90.0f)), 1.5f, 0.1f, uniform(20.0f, 200.0f)) * view);
+      found.clear();
+      scene.index.queryFrustum(frustum, found);
+      mismatches += !sameHandles(found, bruteForce(scene, [&](const AABB &b) { return frustum.test(b) != Containment::Outside; }));
+
+      float maxDistance = uniform(5.0f, 80.0f);
+      found.clear();
+      scene.index.queryFrustum(frustum, eye, maxDistance, found);
+      mismatches += !sameHandles(found, bruteForce(scene, [&](const AABB &b)
+                                                   { return touchesSphere(b, eye, maxDistance) &&
+                                                            frustum.test(b) != Containment::Outside; }));
+    }
+    if (mismatches)
+    {
+      std::printf("FAIL: %s: %d of 160 queries differ from a brute-force scan\n", phase, mismatches);
+      ++failures;
+    }
+  }
+
+  void insertOne(Scene &scene, const AABB &box)
+  {
+    SpatialIndex::Handle handle = scene.index.insert(box);
+    if (handle >= scene.bounds.size())
+    {
+      scene.bounds.resize(handle + 1);
+      scene.live.resize(handle + 1, false);
+    }
+    check(!scene.live[handle], "insert returns a free handle");
+    scene.bounds[handle] = box;
+    scene.live[handle] = true;
+  }
+}
+
+int main()
+{
+  Scene scene;
+  const size_t count = 3000;
+  for (size_t i = 0; i < count; ++i)
+    scene.bounds.push_back(randomBox(50.0f));
+  // Never reported until moved to real bounds
+  scene.bounds[7] = AABB{};
+  scene.bounds[8].max.x = NAN;
+  scene.live.assign(count, true);
+  scene.index.build(scene.bounds.data(), count);
+  checkQueries(scene, "build");
+
+  // Far outside the root, which has to grow
+  for (int i = 0; i < 20; ++i)
+  {
+    AABB box = randomBox(5.0f);
+    glm::vec3 offset(uniform(200.0f, 400.0f), 0.0f, uniform(-400.0f, -200.0f));
+    box.min += offset;
+    box.max += offset;
+    insertOne(scene, box);
+  }
+  checkQueries(scene, "insert outside the root");
+
+  // Small moves (staying in their cell's loose bounds) and large ones
+  for (SpatialIndex::Handle h = 0; h < count; h += 3)
+  {
+    AABB box = scene.bounds[h];
+    glm::vec3 offset = h % 2 ? glm::vec3(0.01f, -0.02f, 0.01f) : glm::vec3(uniform(-60.0f, 60.0f), 0.0f, uniform(-60.0f, 60.0f));
+    if (h == 7 || h == 8)
+      box = randomBox(10.0f);
+    else
+    {
+      box.min += offset;
+      box.max += offset;
+    }
+    scene.index.move(h, box);
+    scene.bounds[h] = box;
+  }
+  checkQueries(scene, "move");
+
+  // Batch moves: a few are moved one by one, half the items rebuild the tree
+  for (size_t batchSize : {size_t(50), count / 2 + 10})
+  {
+    std::vector<SpatialIndex::Handle> moved;
+    std::vector<AABB> boxes;
+    for (SpatialIndex::Handle h = 0; moved.size() < batchSize; h += 2)
+    {
+      moved.push_back(h);
+      boxes.push_back(randomBox(60.0f));
+      scene.bounds[h] = boxes.back();
+    }
+    scene.index.move(moved.data(), boxes.data(), moved.size());
+    checkQueries(scene, batchSize < 100 ? "small batch move" : "large batch move");
+  }
+
+  for (SpatialIndex::Handle h = 1; h < count; h += 4)
+  {
+    scene.index.remove(h);
+    scene.live[h] = false;
+    check(!scene.index.contains(h), "removed handle is gone");
+  }
+  checkQueries(scene, "remove");
+
+  // Reuses the removed handles
+  for (int i = 0; i < 100; ++i)
+    insertOne(scene, randomBox(50.0f));
+  checkQueries(scene, "insert into freed handles");
+
+  // At least half the current size: rebuilds the tree
+  std::vector<AABB> batch;
+  for (size_t i = 0; i < scene.index.size(); ++i)
+    batch.push_back(randomBox(70.0f));
+  std::vector<SpatialIndex::Handle> handles(batch.size());
+  scene.index.insert(batch.data(), batch.size(), handles.data());
+  for (size_t i = 0; i < batch.size(); ++i)
+  {
+    if (handles[i] >= scene.bounds.size())
+    {
+      scene.bounds.resize(handles[i] + 1);
+      scene.live.resize(handles[i] + 1, false);
+    }
+    scene.bounds[handles[i]] = batch[i];
+    scene.live[handles[i]] = true;
+  }
+  checkQueries(scene, "batch insert");
+
+  size_t nodesBefore = scene.index.getNodeCount();
+  scene.index.rebuild();
+  checkQueries(scene, "rebuild");
+  check(scene.index.getNodeCount() <= nodesBefore, "rebuild does not add cells");
+
+  scene.index.clear();
+  std::vector<SpatialIndex::Handle> found;
+  scene.index.queryBox(randomBox(50.0f), found);
+  check(scene.index.size() == 0 && found.empty(), "clear empties the index");
+
+  return finish("spatial_index_test");
+}